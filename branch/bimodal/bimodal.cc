@@ -1,4 +1,4 @@
-#include <map>
+#include <array>
 
 #include "ooo_cpu.h"
 
@@ -6,27 +6,32 @@ constexpr std::size_t BIMODAL_TABLE_SIZE = 16384;
 constexpr std::size_t BIMODAL_PRIME = 16381;
 constexpr std::size_t COUNTER_BITS = 2;
 
-std::map<O3_CPU*, std::array<int, BIMODAL_TABLE_SIZE>> bimodal_table;
+namespace
+{
+using bimodal_table = std::array<int, BIMODAL_TABLE_SIZE>;
+}
 
 void O3_CPU::initialize_branch_predictor()
 {
   std::cout << "CPU " << cpu << " Bimodal branch predictor" << std::endl;
-  bimodal_table[this] = {};
+  bpred_state.emplace<bimodal_table>();
 }
 
 uint8_t O3_CPU::predict_branch(uint64_t ip, uint64_t predicted_target, uint8_t always_taken, uint8_t branch_type)
 {
+  auto& table = *bpred_state.get<bimodal_table>();
   uint32_t hash = ip % BIMODAL_PRIME;
 
-  return bimodal_table[this][hash] >= (1 << (COUNTER_BITS - 1));
+  return table[hash] >= (1 << (COUNTER_BITS - 1));
 }
 
 void O3_CPU::last_branch_result(uint64_t ip, uint64_t branch_target, uint8_t taken, uint8_t branch_type)
 {
+  auto& table = *bpred_state.get<bimodal_table>();
   uint32_t hash = ip % BIMODAL_PRIME;
 
   if (taken)
-    bimodal_table[this][hash] = std::min(bimodal_table[this][hash] + 1, ((1 << COUNTER_BITS) - 1));
+    table[hash] = std::min(table[hash] + 1, ((1 << COUNTER_BITS) - 1));
   else
-    bimodal_table[this][hash] = std::max(bimodal_table[this][hash] - 1, 0);
+    table[hash] = std::max(table[hash] - 1, 0);
 }
@@ -2,21 +2,25 @@
 
 #define GLOBAL_HISTORY_LENGTH 14
 #define GLOBAL_HISTORY_MASK (1 << GLOBAL_HISTORY_LENGTH) - 1
-int branch_history_vector[NUM_CPUS];
 
 #define GS_HISTORY_TABLE_SIZE 16384
-int gs_history_table[NUM_CPUS][GS_HISTORY_TABLE_SIZE];
-int my_last_prediction[NUM_CPUS];
+
+namespace
+{
+struct gshare_state {
+  int branch_history_vector = 0;
+  int gs_history_table[GS_HISTORY_TABLE_SIZE];
+  int my_last_prediction = 0;
+};
+} // namespace
 
 void O3_CPU::initialize_branch_predictor()
 {
   cout << "CPU " << cpu << " GSHARE branch predictor" << endl;
 
-  branch_history_vector[cpu] = 0;
-  my_last_prediction[cpu] = 0;
-
+  auto& st = *bpred_state.emplace<gshare_state>();
   for (int i = 0; i < GS_HISTORY_TABLE_SIZE; i++)
-    gs_history_table[cpu][i] = 2; // 2 is slightly taken
+    st.gs_history_table[i] = 2; // 2 is slightly taken
 }
 
 unsigned int gs_table_hash(uint64_t ip, int bh_vector)
@@ -31,34 +35,36 @@ unsigned int gs_table_hash(uint64_t ip, int bh_vector)
 
 uint8_t O3_CPU::predict_branch(uint64_t ip, uint64_t predicted_target, uint8_t always_taken, uint8_t branch_type)
 {
+  auto& st = *bpred_state.get<gshare_state>();
   int prediction = 1;
 
-  int gs_hash = gs_table_hash(ip, branch_history_vector[cpu]);
+  int gs_hash = gs_table_hash(ip, st.branch_history_vector);
 
-  if (gs_history_table[cpu][gs_hash] >= 2)
+  if (st.gs_history_table[gs_hash] >= 2)
     prediction = 1;
   else
     prediction = 0;
 
-  my_last_prediction[cpu] = prediction;
+  st.my_last_prediction = prediction;
 
   return prediction;
 }
 
 void O3_CPU::last_branch_result(uint64_t ip, uint64_t branch_target, uint8_t taken, uint8_t branch_type)
 {
-  int gs_hash = gs_table_hash(ip, branch_history_vector[cpu]);
+  auto& st = *bpred_state.get<gshare_state>();
+  int gs_hash = gs_table_hash(ip, st.branch_history_vector);
 
   if (taken == 1) {
-    if (gs_history_table[cpu][gs_hash] < 3)
-      gs_history_table[cpu][gs_hash]++;
+    if (st.gs_history_table[gs_hash] < 3)
+      st.gs_history_table[gs_hash]++;
   } else {
-    if (gs_history_table[cpu][gs_hash] > 0)
-      gs_history_table[cpu][gs_hash]--;
+    if (st.gs_history_table[gs_hash] > 0)
+      st.gs_history_table[gs_hash]--;
   }
 
   // update branch history vector
-  branch_history_vector[cpu] <<= 1;
-  branch_history_vector[cpu] &= GLOBAL_HISTORY_MASK;
-  branch_history_vector[cpu] |= taken;
+  st.branch_history_vector <<= 1;
+  st.branch_history_vector &= GLOBAL_HISTORY_MASK;
+  st.branch_history_vector |= taken;
 }
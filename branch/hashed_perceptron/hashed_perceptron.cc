@@ -83,49 +83,43 @@ int history_lengths[NTABLES] = {0, 3, 4, 6, 8, 10, 14, 19, 26, 36, 49, 67, 91, 1
 
 #define NGHIST_WORDS (MAXHIST / LOG_TABLE_SIZE + 1)
 
-// tables of 8-bit weights
-
-int tables[NUM_CPUS][NTABLES][TABLE_SIZE];
-
-// words that store the global history
-
-unsigned int ghist_words[NUM_CPUS][NGHIST_WORDS];
+namespace
+{
+struct hashed_perceptron_state {
+  // tables of 8-bit weights
+  int tables[NTABLES][TABLE_SIZE] = {};
 
-// remember the indices into the tables from prediction to update
+  // words that store the global history
+  unsigned int ghist_words[NGHIST_WORDS] = {};
 
-unsigned int indices[NUM_CPUS][NTABLES];
+  // remember the indices into the tables from prediction to update
+  unsigned int indices[NTABLES] = {};
 
-// initialize theta to something reasonable,
-int theta[NUM_CPUS],
+  // initialize theta to something reasonable,
+  int theta = 10,
 
-    // initialize counter for threshold setting algorithm
-    tc[NUM_CPUS],
+      // initialize counter for threshold setting algorithm
+      tc = 0,
 
-    // perceptron sum
-    yout[NUM_CPUS];
+      // perceptron sum
+      yout = 0;
+};
+} // namespace
 
 void O3_CPU::initialize_branch_predictor()
 {
-  // zero out the weights tables
-
-  memset(tables, 0, sizeof(tables));
-
-  // zero out the global history
-
-  memset(ghist_words, 0, sizeof(ghist_words));
-
-  // make a reasonable theta
+  // zero out the weights tables and the global history, and make a reasonable theta
 
-  for (int i = 0; i < NUM_CPUS; i++)
-    theta[i] = 10;
+  bpred_state.emplace<hashed_perceptron_state>();
 }
 
 uint8_t O3_CPU::predict_branch(uint64_t pc, uint64_t predicted_target, uint8_t always_taken, uint8_t branch_type)
 {
+  auto& [tables, ghist_words, indices, theta, tc, yout] = *bpred_state.get<hashed_perceptron_state>();
 
   // initialize perceptron sum
 
-  yout[cpu] = 0;
+  yout = 0;
 
   // for each table...
 
@@ -152,11 +146,11 @@ uint8_t O3_CPU::predict_branch(uint64_t pc, uint64_t predicted_target, uint8_t a
 
     int j;
     for (j = 0; j < most_words; j++)
-      x ^= ghist_words[cpu][j];
+      x ^= ghist_words[j];
 
     // XOR in the last word
 
-    x ^= ghist_words[cpu][j] & ((1 << last_word) - 1);
+    x ^= ghist_words[j] & ((1 << last_word) - 1);
 
     // XOR in the PC to spread accesses around (like gshare)
 
@@ -168,21 +162,22 @@ uint8_t O3_CPU::predict_branch(uint64_t pc, uint64_t predicted_target, uint8_t a
 
     // remember this index for update
 
-    indices[cpu][i] = x;
+    indices[i] = x;
 
     // add the selected weight to the perceptron sum
 
-    yout[cpu] += tables[cpu][i][x];
+    yout += tables[i][x];
   }
-  return yout[cpu] >= 1;
+  return yout >= 1;
 }
 
 void O3_CPU::last_branch_result(uint64_t pc, uint64_t branch_target, uint8_t taken, uint8_t branch_type)
 {
+  auto& [tables, ghist_words, indices, theta, tc, yout] = *bpred_state.get<hashed_perceptron_state>();
 
   // was this prediction correct?
 
-  bool correct = taken == (yout[cpu] >= 1);
+  bool correct = taken == (yout >= 1);
 
   // insert this branch outcome into the global history
 
@@ -191,27 +186,27 @@ void O3_CPU::last_branch_result(uint64_t pc, uint64_t branch_target, uint8_t tak
 
     // shift b into the lsb of the current word
 
-    ghist_words[cpu][i] <<= 1;
-    ghist_words[cpu][i] |= b;
+    ghist_words[i] <<= 1;
+    ghist_words[i] |= b;
 
     // get b as the previous msb of the current word
 
-    b = !!(ghist_words[cpu][i] & TABLE_SIZE);
-    ghist_words[cpu][i] &= TABLE_SIZE - 1;
+    b = !!(ghist_words[i] & TABLE_SIZE);
+    ghist_words[i] &= TABLE_SIZE - 1;
   }
 
   // get the magnitude of yout
 
-  int a = (yout[cpu] < 0) ? -yout[cpu] : yout[cpu];
+  int a = (yout < 0) ? -yout : yout;
 
   // perceptron learning rule: train if misprediction or weak correct prediction
 
-  if (!correct || a < theta[cpu]) {
+  if (!correct || a < theta) {
     // update weights
     for (int i = 0; i < NTABLES; i++) {
       // which weight did we use to compute yout?
 
-      int* c = &tables[cpu][i][indices[cpu][i]];
+      int* c = &tables[i][indices[i]];
 
       // increment if taken, decrement if not, saturating at 127/-128
 
@@ -230,19 +225,19 @@ void O3_CPU::last_branch_result(uint64_t pc, uint64_t branch_target, uint8_t tak
 
       // increase theta after enough mispredictions
 
-      tc[cpu]++;
-      if (tc[cpu] >= SPEED) {
-        theta[cpu]++;
-        tc[cpu] = 0;
+      tc++;
+      if (tc >= SPEED) {
+        theta++;
+        tc = 0;
       }
-    } else if (a < theta[cpu]) {
+    } else if (a < theta) {
 
       // decrease theta after enough weak but correct predictions
 
-      tc[cpu]--;
-      if (tc[cpu] <= -SPEED) {
-        theta[cpu]--;
-        tc[cpu] = 0;
+      tc--;
+      if (tc <= -SPEED) {
+        theta--;
+        tc = 0;
       }
     }
   }
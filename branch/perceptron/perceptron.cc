@@ -40,10 +40,11 @@
 #include <array>
 #include <bitset>
 #include <deque>
-#include <map>
 
 #include "ooo_cpu.h"
 
+namespace
+{
 template <typename T, std::size_t HISTLEN, std::size_t BITS>
 class perceptron
 {
@@ -112,57 +113,62 @@ struct perceptron_state {
   std::bitset<PERCEPTRON_HISTORY> history = 0; // value of the history register yielding this prediction
 };
 
-std::map<O3_CPU*, std::array<perceptron<int, PERCEPTRON_HISTORY, PERCEPTRON_BITS>,
-                             NUM_PERCEPTRONS>> perceptrons;             // table of perceptrons
-std::map<O3_CPU*, std::deque<perceptron_state>> perceptron_state_buf;   // state for updating perceptron predictor
-std::map<O3_CPU*, std::bitset<PERCEPTRON_HISTORY>> spec_global_history; // speculative global history - updated by predictor
-std::map<O3_CPU*, std::bitset<PERCEPTRON_HISTORY>> global_history;      // real global history - updated when the predictor is
-                                                                        // updated
+struct perceptron_predictor_state {
+  std::array<perceptron<int, PERCEPTRON_HISTORY, PERCEPTRON_BITS>, NUM_PERCEPTRONS> perceptrons; // table of perceptrons
+  std::deque<perceptron_state> perceptron_state_buf;                                              // state for updating perceptron predictor
+  std::bitset<PERCEPTRON_HISTORY> spec_global_history;                                            // speculative global history - updated by predictor
+  std::bitset<PERCEPTRON_HISTORY> global_history; // real global history - updated when the predictor is updated
+};
+} // namespace
 
-void O3_CPU::initialize_branch_predictor() {}
+void O3_CPU::initialize_branch_predictor() { bpred_state.emplace<perceptron_predictor_state>(); }
 
 uint8_t O3_CPU::predict_branch(uint64_t ip, uint64_t predicted_target, uint8_t always_taken, uint8_t branch_type)
 {
+  auto& [perceptrons, perceptron_state_buf, spec_global_history, global_history] = *bpred_state.get<perceptron_predictor_state>();
+
   // hash the address to get an index into the table of perceptrons
   auto index = ip % NUM_PERCEPTRONS;
-  auto output = perceptrons[this][index].predict(spec_global_history[this]);
+  auto output = perceptrons[index].predict(spec_global_history);
 
   bool prediction = (output >= 0);
 
   // record the various values needed to update the predictor
-  perceptron_state_buf[this].push_back({ip, prediction, output, spec_global_history[this]});
-  if (std::size(perceptron_state_buf[this]) > NUM_UPDATE_ENTRIES)
-    perceptron_state_buf[this].pop_front();
+  perceptron_state_buf.push_back({ip, prediction, output, spec_global_history});
+  if (std::size(perceptron_state_buf) > NUM_UPDATE_ENTRIES)
+    perceptron_state_buf.pop_front();
 
   // update the speculative global history register
-  spec_global_history[this] <<= 1;
-  spec_global_history[this].set(0, prediction);
+  spec_global_history <<= 1;
+  spec_global_history.set(0, prediction);
   return prediction;
 }
 
 void O3_CPU::last_branch_result(uint64_t ip, uint64_t branch_target, uint8_t taken, uint8_t branch_type)
 {
-  auto state = std::find_if(std::begin(perceptron_state_buf[this]), std::end(perceptron_state_buf[this]), [ip](auto x) { return x.ip == ip; });
-  if (state == std::end(perceptron_state_buf[this]))
+  auto& [perceptrons, perceptron_state_buf, spec_global_history, global_history] = *bpred_state.get<perceptron_predictor_state>();
+
+  auto state = std::find_if(std::begin(perceptron_state_buf), std::end(perceptron_state_buf), [ip](auto x) { return x.ip == ip; });
+  if (state == std::end(perceptron_state_buf))
     return; // Skip update because state was lost
 
   auto [_ip, prediction, output, history] = *state;
-  perceptron_state_buf[this].erase(state);
+  perceptron_state_buf.erase(state);
 
   auto index = ip % NUM_PERCEPTRONS;
 
   // update the real global history shift register
-  global_history[this] <<= 1;
-  global_history[this].set(0, taken);
+  global_history <<= 1;
+  global_history.set(0, taken);
 
   // if this branch was mispredicted, restore the speculative history to the
   // last known real history
   if (prediction != taken)
-    spec_global_history[this] = global_history[this];
+    spec_global_history = global_history;
 
   // if the output of the perceptron predictor is outside of the range
   // [-THETA,THETA] *and* the prediction was correct, then we don't need to
   // adjust the weights
   if ((output <= THETA && output >= -THETA) || (prediction != taken))
-    perceptrons[this][index].update(taken, history);
+    perceptrons[index].update(taken, history);
 }
@@ -0,0 +1,548 @@
+/*
+ * A TAGE-SC-L conditional branch predictor, after Seznec, "TAGE-SC-L Branch
+ * Predictors Again," CBP-5, 2016.
+ *
+ * - TAGE: a bimodal base predictor and NHIST tagged tables indexed with
+ *   geometrically increasing lengths of global and path history. The longest
+ *   matching table provides the prediction.
+ *
+ * - L: a loop predictor that recognizes branches with a constant trip count
+ *   and predicts their exits.
+ *
+ * - SC: a statistical corrector that reverts the TAGE prediction when TAGE
+ *   has been statistically wrong in similar circumstances. It sums bias
+ *   tables, global history tables, local history tables indexed with a
+ *   per-branch history, and an IMLI table indexed with the inner most loop
+ *   iteration counter, the number of times the last backward conditional
+ *   branch has been taken in a row (Seznec et al., "The Inner Most Loop
+ *   Iteration Counter," HPCA 2016). Of the two IMLI components, only the
+ *   IMLI-SIC table is modeled.
+ *
+ * The storage budget is set at compile time with TAGE_SC_L_KB (64 by default,
+ * any power of two from 8 to 1024), for example by adding
+ * -DTAGE_SC_L_KB=32 to the CXXFLAGS of the configuration. The table sizes
+ * scale with the budget, and the storage actually used is printed when the
+ * predictor is initialized.
+ *
+ * History hashes are kept in folded (circular shift) registers, updated in
+ * constant time per branch. Each tagged entry is packed into four bytes, and
+ * each tagged table is contiguous, so a prediction touches one cache line per
+ * table.
+ */
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+
+#include "ooo_cpu.h"
+#include "util.h"
+
+#ifndef TAGE_SC_L_KB
+#define TAGE_SC_L_KB 64
+#endif
+
+namespace
+{
+static_assert(TAGE_SC_L_KB >= 8 && TAGE_SC_L_KB <= 1024 && (TAGE_SC_L_KB & (TAGE_SC_L_KB - 1)) == 0, "TAGE_SC_L_KB must be a power of two from 8 to 1024");
+
+// log2 of the number of entries in each tagged table, the bimodal table, and each statistical corrector table
+constexpr unsigned LOGG = 11 + lg2(TAGE_SC_L_KB) - lg2(64);
+constexpr unsigned LOGB = LOGG + 2;
+constexpr unsigned LOGSC = LOGG - 1;
+
+constexpr std::size_t NHIST = 12;
+constexpr unsigned MINHIST = 4;
+constexpr unsigned MAXHIST = 640;
+constexpr std::array<unsigned, NHIST> TAG_BITS = {8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+constexpr int CTR_MAX = 3, CTR_MIN = -4; // 3-bit prediction counters
+constexpr uint8_t U_MAX = 3;             // 2-bit useful counters
+constexpr uint64_t U_RESET_PERIOD = 1 << 18;
+
+// the global history is a ring of bits, newest at ghist_ptr
+constexpr std::size_t GHIST_SIZE = 1024;
+static_assert(GHIST_SIZE > MAXHIST);
+
+// loop predictor: NLOOP entries in sets of LOOP_WAYS
+constexpr std::size_t NLOOP = 64, LOOP_WAYS = 4;
+constexpr unsigned LOOP_TAG_BITS = 10, LOOP_ITER_BITS = 10;
+constexpr uint8_t LOOP_CONF_MAX = 15, LOOP_AGE_MAX = 15;
+
+// statistical corrector: global history GEHL tables, and bias tables indexed by the TAGE prediction and its confidence
+constexpr std::array<unsigned, 5> SC_HIST_LENGTHS = {4, 8, 13, 21, 34};
+constexpr std::size_t NBIAS = 2;
+constexpr int SC_CTR_MAX = 31, SC_CTR_MIN = -32; // 6-bit counters
+
+// statistical corrector: local history GEHL tables, over NLOCAL per-branch histories of LOCAL_HIST_BITS
+constexpr std::array<unsigned, 3> SC_LOCAL_LENGTHS = {3, 6, 11};
+constexpr std::size_t NLOCAL = 256;
+constexpr unsigned LOCAL_HIST_BITS = 11;
+
+// statistical corrector: the IMLI table, indexed with a saturating IMLI_BITS counter
+constexpr unsigned IMLI_BITS = 6;
+
+struct folded_history {
+  uint32_t comp = 0;
+  unsigned clength = 0, olength = 0, outpoint = 0;
+
+  folded_history() = default;
+  folded_history(unsigned olength, unsigned clength) : clength(clength), olength(olength), outpoint(olength % clength) {}
+
+  // after a bit has been pushed at ghist[ptr], bring it in and take out the bit that has left this history length
+  void update(const std::array<uint8_t, GHIST_SIZE>& ghist, std::size_t ptr)
+  {
+    comp = (comp << 1) ^ ghist[ptr];
+    comp ^= static_cast<uint32_t>(ghist[(ptr + olength) % GHIST_SIZE]) << outpoint;
+    comp ^= comp >> clength;
+    comp &= (1u << clength) - 1;
+  }
+};
+
+struct tage_entry {
+  int8_t ctr = 0;
+  uint8_t u = 0;
+  uint16_t tag = 0;
+};
+static_assert(sizeof(tage_entry) == 4);
+
+struct loop_entry {
+  bool valid = false;
+  uint16_t tag = 0, past_iter = 0, current_iter = 0;
+  uint8_t confidence = 0, age = 0;
+  bool dir = false; // the direction of the branch within the loop; the exit goes the other way
+};
+
+template <typename T>
+void saturating_update(T& ctr, bool up, int min, int max)
+{
+  if (up && ctr < max)
+    ctr++;
+  else if (!up && ctr > min)
+    ctr--;
+}
+
+struct tage_sc_l_state {
+  std::array<unsigned, NHIST> history_lengths = {};
+
+  // the tagged tables, table i at offset i << LOGG
+  std::vector<tage_entry> tagged = std::vector<tage_entry>(NHIST << LOGG);
+
+  // the bimodal base predictor, with one hysteresis bit shared by four prediction bits
+  std::vector<uint8_t> base_pred = std::vector<uint8_t>(1 << LOGB), base_hyst = std::vector<uint8_t>(1 << (LOGB - 2), 1);
+
+  std::array<uint8_t, GHIST_SIZE> ghist = {};
+  std::size_t ghist_ptr = 0;
+  uint64_t phist = 0;
+
+  std::array<folded_history, NHIST> index_fold, tag_fold0, tag_fold1;
+  std::array<folded_history, std::size(SC_HIST_LENGTHS)> sc_fold;
+
+  int use_alt_on_na = 0;
+  uint64_t branches = 0;
+  uint64_t rng = 0x2545f4914f6cdd1dull;
+
+  std::array<loop_entry, NLOOP> loops = {};
+  int8_t with_loop = -1;
+
+  std::array<std::vector<int8_t>, std::size(SC_HIST_LENGTHS)> sc_gehl;
+  std::array<std::vector<int8_t>, NBIAS> sc_bias;
+  std::array<std::vector<int8_t>, std::size(SC_LOCAL_LENGTHS)> sc_local;
+  std::vector<int8_t> sc_imli = std::vector<int8_t>(1 << LOGSC);
+  std::array<uint16_t, NLOCAL> local_hist = {};
+  unsigned imli_count = 0;
+
+  // whether each conditional branch jumps backward, as learned from its taken target. A real front end reads this from the
+  // decoded offset, so it is not counted in the storage budget.
+  std::unordered_map<uint64_t, bool> backward;
+
+  int sc_threshold = 35, sc_tc = 0;
+  int8_t first_h = 0, second_h = 0;
+
+  // everything computed by the prediction and needed again for the update
+  struct {
+    std::array<uint32_t, NHIST> index = {};
+    std::array<uint16_t, NHIST> tag = {};
+    std::size_t hit_bank = 0, alt_bank = 0; // 0 is the bimodal table, i + 1 is tagged table i
+    bool longest_pred = false, alt_pred = false, tage_pred = false;
+    bool high_conf = false, med_conf = false, low_conf = false;
+
+    bool loop_hit = false, loop_valid = false, loop_pred = false;
+    std::size_t loop_idx = 0;
+    uint16_t loop_tag = 0;
+
+    std::array<uint32_t, std::size(SC_HIST_LENGTHS)> sc_index = {};
+    std::array<uint32_t, NBIAS> bias_index = {};
+    std::array<uint32_t, std::size(SC_LOCAL_LENGTHS)> local_index = {};
+    uint32_t imli_index = 0;
+    int sc_sum = 0;
+    bool pred_inter = false, sc_pred = false, final_pred = false;
+  } last;
+
+  tage_sc_l_state()
+  {
+    // geometric history lengths from MINHIST to MAXHIST
+    for (std::size_t i = 0; i < NHIST; i++) {
+      history_lengths[i] = static_cast<unsigned>(MINHIST * std::pow(double(MAXHIST) / MINHIST, double(i) / (NHIST - 1)) + 0.5);
+      index_fold[i] = folded_history{history_lengths[i], LOGG};
+      tag_fold0[i] = folded_history{history_lengths[i], TAG_BITS[i]};
+      tag_fold1[i] = folded_history{history_lengths[i], TAG_BITS[i] - 1};
+    }
+
+    for (std::size_t i = 0; i < std::size(SC_HIST_LENGTHS); i++) {
+      sc_fold[i] = folded_history{SC_HIST_LENGTHS[i], LOGSC};
+      sc_gehl[i].assign(1 << LOGSC, 0);
+    }
+    for (auto& table : sc_bias)
+      table.assign(1 << LOGSC, 0);
+    for (auto& table : sc_local)
+      table.assign(1 << LOGSC, 0);
+  }
+
+  uint64_t random()
+  {
+    rng ^= rng << 13;
+    rng ^= rng >> 7;
+    rng ^= rng << 17;
+    return rng;
+  }
+
+  uint64_t storage_bits() const
+  {
+    uint64_t bits = (1ull << LOGB) + (1ull << (LOGB - 2));
+    for (auto tag_bits : TAG_BITS)
+      bits += (1ull << LOGG) * (3 + 2 + tag_bits);
+    bits += NLOOP * (LOOP_TAG_BITS + 2 * LOOP_ITER_BITS + 4 + 4 + 1);
+    bits += (std::size(SC_HIST_LENGTHS) + NBIAS + std::size(SC_LOCAL_LENGTHS) + 1) * (1ull << LOGSC) * 6;
+    bits += NLOCAL * LOCAL_HIST_BITS + IMLI_BITS;
+    bits += MAXHIST + 16;
+    return bits;
+  }
+
+  // the path history is folded into the index of the tables with the shortest histories
+  uint32_t path_hash(std::size_t bank) const
+  {
+    unsigned size = std::min<unsigned>(history_lengths[bank], 16);
+    uint32_t a = phist & bitmask(size);
+    uint32_t a1 = a & bitmask(LOGG);
+    uint32_t a2 = (a >> LOGG) & bitmask(LOGG);
+    unsigned shift = bank % LOGG;
+    a2 = ((a2 << shift) & bitmask(LOGG)) + (a2 >> (LOGG - shift));
+    return (a1 ^ a2) & bitmask(LOGG);
+  }
+
+  uint32_t tage_index(uint64_t pc, std::size_t bank) const
+  {
+    unsigned shift = (bank > LOGG - 2) ? 1 : LOGG - bank;
+    return (pc ^ (pc >> shift) ^ index_fold[bank].comp ^ path_hash(bank)) & bitmask(LOGG);
+  }
+
+  // a history longer than a corrector index, folded onto it
+  static uint32_t sc_fold_bits(uint64_t history)
+  {
+    uint32_t folded = 0;
+    for (; history != 0; history >>= LOGSC)
+      folded ^= history & bitmask(LOGSC);
+    return folded;
+  }
+
+  static std::size_t local_slot(uint64_t pc) { return (pc ^ (pc >> 2)) % NLOCAL; }
+
+  uint16_t tage_tag(uint64_t pc, std::size_t bank) const { return (pc ^ tag_fold0[bank].comp ^ (tag_fold1[bank].comp << 1)) & bitmask(TAG_BITS[bank]); }
+
+  tage_entry& entry(std::size_t bank) { return tagged[(bank << LOGG) + last.index[bank]]; }
+
+  bool base_prediction(uint64_t pc) const { return base_pred[pc & bitmask(LOGB)]; }
+
+  void base_update(uint64_t pc, bool taken)
+  {
+    auto idx = pc & bitmask(LOGB);
+    int ctr = (base_pred[idx] << 1) + base_hyst[idx >> 2];
+    saturating_update(ctr, taken, 0, 3);
+    base_pred[idx] = ctr >> 1;
+    base_hyst[idx >> 2] = ctr & 1;
+  }
+
+  void predict(uint64_t pc);
+  void update(uint64_t pc, bool taken);
+  void update_history(uint64_t pc, uint64_t target, bool taken, bool conditional);
+};
+
+void tage_sc_l_state::predict(uint64_t pc)
+{
+  // TAGE
+  for (std::size_t i = 0; i < NHIST; i++) {
+    last.index[i] = tage_index(pc, i);
+    last.tag[i] = tage_tag(pc, i);
+  }
+
+  last.hit_bank = last.alt_bank = 0;
+  for (std::size_t i = NHIST; i > 0; i--) {
+    if (entry(i - 1).tag == last.tag[i - 1]) {
+      if (last.hit_bank == 0)
+        last.hit_bank = i;
+      else {
+        last.alt_bank = i;
+        break;
+      }
+    }
+  }
+
+  last.alt_pred = (last.alt_bank > 0) ? (entry(last.alt_bank - 1).ctr >= 0) : base_prediction(pc);
+  if (last.hit_bank > 0) {
+    auto& provider = entry(last.hit_bank - 1);
+    last.longest_pred = provider.ctr >= 0;
+
+    // a newly allocated entry is weak, and may be less reliable than the alternate prediction
+    bool weak = (provider.ctr == 0 || provider.ctr == -1) && provider.u == 0;
+    last.tage_pred = (use_alt_on_na < 0 || !weak) ? last.longest_pred : last.alt_pred;
+
+    int strength = std::abs(2 * provider.ctr + 1);
+    last.high_conf = strength >= 7;
+    last.med_conf = strength == 5;
+    last.low_conf = strength == 1;
+  } else {
+    last.longest_pred = last.tage_pred = last.alt_pred;
+    last.high_conf = true;
+    last.med_conf = last.low_conf = false;
+  }
+
+  // loop predictor
+  last.loop_idx = (pc >> 2) % (NLOOP / LOOP_WAYS) * LOOP_WAYS;
+  last.loop_tag = (pc >> (2 + lg2(NLOOP / LOOP_WAYS))) & bitmask(LOOP_TAG_BITS);
+  last.loop_hit = last.loop_valid = false;
+  for (std::size_t i = 0; i < LOOP_WAYS; i++) {
+    auto& loop = loops[last.loop_idx + i];
+    if (loop.valid && loop.tag == last.loop_tag) {
+      last.loop_idx += i;
+      last.loop_hit = true;
+      last.loop_valid = loop.confidence == LOOP_CONF_MAX;
+      last.loop_pred = (loop.current_iter + 1 == loop.past_iter) ? !loop.dir : loop.dir;
+      break;
+    }
+  }
+  last.pred_inter = (last.loop_valid && with_loop >= 0) ? last.loop_pred : last.tage_pred;
+
+  // statistical corrector
+  uint32_t conf = last.high_conf ? 2 : (last.med_conf ? 1 : 0);
+  last.bias_index[0] = ((pc ^ (pc >> 2)) << 1 | last.pred_inter) & bitmask(LOGSC);
+  last.bias_index[1] = ((pc ^ (pc >> (LOGSC - 2))) << 3 | conf << 1 | last.pred_inter) & bitmask(LOGSC);
+
+  last.sc_sum = 0;
+  for (std::size_t i = 0; i < NBIAS; i++)
+    last.sc_sum += 2 * sc_bias[i][last.bias_index[i]] + 1;
+  for (std::size_t i = 0; i < std::size(SC_HIST_LENGTHS); i++) {
+    last.sc_index[i] = (pc ^ (pc >> (LOGSC - i)) ^ sc_fold[i].comp ^ (last.pred_inter << (i + 1))) & bitmask(LOGSC);
+    last.sc_sum += 2 * sc_gehl[i][last.sc_index[i]] + 1;
+  }
+  for (std::size_t i = 0; i < std::size(SC_LOCAL_LENGTHS); i++) {
+    uint64_t history = local_hist[local_slot(pc)] & bitmask(SC_LOCAL_LENGTHS[i]);
+    last.local_index[i] = (pc ^ (pc >> (LOGSC - i - 1)) ^ sc_fold_bits(history) ^ (last.pred_inter << (i + 1))) & bitmask(LOGSC);
+    last.sc_sum += 2 * sc_local[i][last.local_index[i]] + 1;
+  }
+  last.imli_index = ((imli_count ^ (pc << IMLI_BITS) ^ (pc >> 4)) << 1 | last.pred_inter) & bitmask(LOGSC);
+  last.sc_sum += 2 * sc_imli[last.imli_index] + 1;
+  last.sc_pred = last.sc_sum >= 0;
+
+  // revert the TAGE or loop prediction only when the corrector is confident enough, given the confidence of TAGE
+  last.final_pred = last.pred_inter;
+  if (last.pred_inter != last.sc_pred) {
+    int sum = std::abs(last.sc_sum);
+    last.final_pred = last.sc_pred;
+    if (last.high_conf) {
+      if (sum < sc_threshold / 4)
+        last.final_pred = last.pred_inter;
+      else if (sum < sc_threshold / 2)
+        last.final_pred = (second_h < 0) ? last.sc_pred : last.pred_inter;
+    } else if (last.med_conf && sum < sc_threshold / 4) {
+      last.final_pred = (first_h < 0) ? last.sc_pred : last.pred_inter;
+    }
+  }
+}
+
+void tage_sc_l_state::update(uint64_t pc, bool taken)
+{
+  // statistical corrector
+  if (last.pred_inter != last.sc_pred) {
+    int sum = std::abs(last.sc_sum);
+    if (last.high_conf && sum >= sc_threshold / 4 && sum < sc_threshold / 2)
+      saturating_update(second_h, last.pred_inter == taken, -64, 63);
+    if (last.med_conf && sum < sc_threshold / 4)
+      saturating_update(first_h, last.pred_inter == taken, -64, 63);
+  }
+
+  if (last.sc_pred != taken || std::abs(last.sc_sum) < sc_threshold) {
+    // adapt the threshold so that updates on mispredictions and on low-confidence correct predictions stay in balance
+    if (last.sc_pred != taken) {
+      if (++sc_tc >= 32) {
+        sc_threshold++;
+        sc_tc = 0;
+      }
+    } else if (--sc_tc <= -32) {
+      sc_threshold = std::max(sc_threshold - 1, 6);
+      sc_tc = 0;
+    }
+
+    for (std::size_t i = 0; i < NBIAS; i++)
+      saturating_update(sc_bias[i][last.bias_index[i]], taken, SC_CTR_MIN, SC_CTR_MAX);
+    for (std::size_t i = 0; i < std::size(SC_HIST_LENGTHS); i++)
+      saturating_update(sc_gehl[i][last.sc_index[i]], taken, SC_CTR_MIN, SC_CTR_MAX);
+    for (std::size_t i = 0; i < std::size(SC_LOCAL_LENGTHS); i++)
+      saturating_update(sc_local[i][last.local_index[i]], taken, SC_CTR_MIN, SC_CTR_MAX);
+    saturating_update(sc_imli[last.imli_index], taken, SC_CTR_MIN, SC_CTR_MAX);
+  }
+
+  // loop predictor
+  if (last.loop_hit) {
+    auto& loop = loops[last.loop_idx];
+    if (last.loop_valid && last.tage_pred != last.loop_pred)
+      saturating_update(with_loop, last.loop_pred == taken, -64, 63);
+
+    if (last.loop_valid && last.loop_pred != taken) {
+      // the trip count has changed
+      loop = {};
+    } else {
+      if (last.loop_pred != last.tage_pred)
+        loop.age = std::min<uint8_t>(loop.age + 1, LOOP_AGE_MAX);
+
+      loop.current_iter = (loop.current_iter + 1) & bitmask(LOOP_ITER_BITS);
+      if (loop.past_iter > 0 && loop.current_iter > loop.past_iter) {
+        // more iterations than before: this is not a loop with a constant trip count
+        loop.confidence = 0;
+        loop.past_iter = 0;
+      }
+
+      if (taken != loop.dir) {
+        if (loop.current_iter == loop.past_iter) {
+          loop.confidence = std::min<uint8_t>(loop.confidence + 1, LOOP_CONF_MAX);
+        } else if (loop.past_iter == 0) {
+          // the first complete trip
+          loop.past_iter = loop.current_iter;
+          loop.confidence = 0;
+        } else {
+          loop = {};
+        }
+        loop.current_iter = 0;
+      }
+    }
+  } else if (last.tage_pred != taken && random() % 4 == 0) {
+    // allocate an entry for a branch TAGE mispredicted, on the assumption that this was a loop exit
+    auto set_begin = std::next(std::begin(loops), last.loop_idx);
+    auto set_end = std::next(set_begin, LOOP_WAYS);
+    auto victim = std::min_element(set_begin, set_end, [](const loop_entry& x, const loop_entry& y) { return !x.valid || (y.valid && x.age < y.age); });
+    if (!victim->valid || victim->age == 0) {
+      *victim = {true, last.loop_tag, 0, 0, 0, LOOP_AGE_MAX, !taken};
+    } else {
+      std::for_each(set_begin, set_end, [](loop_entry& x) { x.age = (x.age > 0) ? x.age - 1 : 0; });
+    }
+  }
+
+  // TAGE: allocate longer entries on a misprediction
+  if (last.tage_pred != taken && last.hit_bank < NHIST) {
+    // skip a table at random, to spread allocations
+    std::size_t start = last.hit_bank + ((random() & 1) ? 1 : 0);
+    std::size_t allocated = 0;
+    for (std::size_t i = std::min(start, NHIST - 1); i < NHIST && allocated < 2; i++) {
+      auto& e = tagged[(i << LOGG) + last.index[i]];
+      if (e.u == 0) {
+        e = {static_cast<int8_t>(taken ? 0 : -1), 0, last.tag[i]};
+        allocated++;
+        i++; // leave a gap between allocations
+      }
+    }
+    if (allocated == 0) {
+      for (std::size_t i = last.hit_bank; i < NHIST; i++) {
+        auto& e = tagged[(i << LOGG) + last.index[i]];
+        if (e.u > 0)
+          e.u--;
+      }
+    }
+  }
+
+  // TAGE: train the provider
+  if (last.hit_bank > 0) {
+    auto& provider = entry(last.hit_bank - 1);
+    bool weak = (provider.ctr == 0 || provider.ctr == -1) && provider.u == 0;
+    if (weak && last.longest_pred != last.alt_pred)
+      saturating_update(use_alt_on_na, last.alt_pred == taken, -8, 7);
+
+    // the alternate prediction is trained along with a weak provider
+    if (weak) {
+      if (last.alt_bank > 0)
+        saturating_update(entry(last.alt_bank - 1).ctr, taken, CTR_MIN, CTR_MAX);
+      else
+        base_update(pc, taken);
+    }
+
+    saturating_update(provider.ctr, taken, CTR_MIN, CTR_MAX);
+    if (last.longest_pred != last.alt_pred)
+      saturating_update(provider.u, last.longest_pred == taken, 0, U_MAX);
+  } else {
+    base_update(pc, taken);
+  }
+
+  // graceful aging of the useful counters
+  if (++branches % U_RESET_PERIOD == 0) {
+    for (auto& e : tagged)
+      e.u >>= 1;
+  }
+}
+
+void tage_sc_l_state::update_history(uint64_t pc, uint64_t target, bool taken, bool conditional)
+{
+  if (conditional) {
+    auto& lhist = local_hist[local_slot(pc)];
+    lhist = ((lhist << 1) | taken) & bitmask(LOCAL_HIST_BITS);
+
+    // the IMLI counter counts the taken iterations of the inner most loop, and restarts when it exits
+    if (taken)
+      backward[pc] = target < pc;
+    if (auto found = backward.find(pc); found != std::end(backward) && found->second) {
+      if (!taken)
+        imli_count = 0;
+      else if (imli_count < bitmask(IMLI_BITS))
+        imli_count++;
+    }
+  }
+
+  ghist_ptr = (ghist_ptr + GHIST_SIZE - 1) % GHIST_SIZE;
+  ghist[ghist_ptr] = taken;
+  phist = ((phist << 1) ^ ((pc >> 2) & 1)) & bitmask(16);
+
+  for (std::size_t i = 0; i < NHIST; i++) {
+    index_fold[i].update(ghist, ghist_ptr);
+    tag_fold0[i].update(ghist, ghist_ptr);
+    tag_fold1[i].update(ghist, ghist_ptr);
+  }
+  for (auto& fold : sc_fold)
+    fold.update(ghist, ghist_ptr);
+}
+} // namespace
+
+void O3_CPU::initialize_branch_predictor()
+{
+  auto& st = *bpred_state.emplace<tage_sc_l_state>();
+  std::cout << "CPU " << cpu << " TAGE-SC-L branch predictor, " << (st.storage_bits() + 4095) / 8192 << " KiB" << std::endl;
+}
+
+uint8_t O3_CPU::predict_branch(uint64_t ip, uint64_t predicted_target, uint8_t always_taken, uint8_t branch_type)
+{
+  if (branch_type != BRANCH_CONDITIONAL)
+    return 1;
+
+  auto& st = *bpred_state.get<tage_sc_l_state>();
+  st.predict(ip);
+  return st.last.final_pred;
+}
+
+void O3_CPU::last_branch_result(uint64_t ip, uint64_t branch_target, uint8_t taken, uint8_t branch_type)
+{
+  auto& st = *bpred_state.get<tage_sc_l_state>();
+  if (branch_type == BRANCH_CONDITIONAL)
+    st.update(ip, taken);
+  st.update_history(ip, branch_target, taken, branch_type == BRANCH_CONDITIONAL);
+}
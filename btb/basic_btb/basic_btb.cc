@@ -14,6 +14,8 @@
 #define BASIC_BTB_RAS_SIZE 64
 #define BASIC_BTB_CALL_INSTR_SIZE_TRACKERS 1024
 
+namespace
+{
 struct BASIC_BTB_ENTRY {
   uint64_t ip_tag;
   uint64_t target;
@@ -21,24 +23,6 @@ struct BASIC_BTB_ENTRY {
   uint64_t lru;
 };
 
-BASIC_BTB_ENTRY basic_btb[NUM_CPUS][BASIC_BTB_SETS][BASIC_BTB_WAYS];
-uint64_t basic_btb_lru_counter[NUM_CPUS];
-
-uint64_t basic_btb_indirect[NUM_CPUS][BASIC_BTB_INDIRECT_SIZE];
-uint64_t basic_btb_conditional_history[NUM_CPUS];
-
-uint64_t basic_btb_ras[NUM_CPUS][BASIC_BTB_RAS_SIZE];
-int basic_btb_ras_index[NUM_CPUS];
-/*
- * The following two variables are used to automatically identify the
- * size of call instructions, in bytes, which tells us the appropriate
- * target for a call's corresponding return.
- * They exist because ChampSim does not model a specific ISA, and
- * different ISAs could use different sizes for call instructions,
- * and even within the same ISA, calls can have different sizes.
- */
-uint64_t basic_btb_call_instr_sizes[NUM_CPUS][BASIC_BTB_CALL_INSTR_SIZE_TRACKERS];
-
 uint64_t basic_btb_abs_addr_dist(uint64_t addr1, uint64_t addr2)
 {
   if (addr1 > addr2) {
@@ -50,109 +34,108 @@ uint64_t basic_btb_abs_addr_dist(uint64_t addr1, uint64_t addr2)
 
 uint64_t basic_btb_set_index(uint64_t ip) { return ((ip >> 2) & (BASIC_BTB_SETS - 1)); }
 
-BASIC_BTB_ENTRY* basic_btb_find_entry(uint8_t cpu, uint64_t ip)
-{
-  uint64_t set = basic_btb_set_index(ip);
-  for (uint32_t i = 0; i < BASIC_BTB_WAYS; i++) {
-    if (basic_btb[cpu][set][i].ip_tag == ip) {
-      return &(basic_btb[cpu][set][i]);
+uint64_t basic_btb_call_size_tracker_hash(uint64_t ip) { return (ip & (BASIC_BTB_CALL_INSTR_SIZE_TRACKERS - 1)); }
+
+struct basic_btb_state {
+  BASIC_BTB_ENTRY btb[BASIC_BTB_SETS][BASIC_BTB_WAYS] = {};
+  uint64_t lru_counter = 0;
+
+  uint64_t indirect[BASIC_BTB_INDIRECT_SIZE] = {};
+  uint64_t conditional_history = 0;
+
+  uint64_t ras[BASIC_BTB_RAS_SIZE] = {};
+  int ras_index = 0;
+  /*
+   * The following variable is used to automatically identify the
+   * size of call instructions, in bytes, which tells us the appropriate
+   * target for a call's corresponding return.
+   * It exists because ChampSim does not model a specific ISA, and
+   * different ISAs could use different sizes for call instructions,
+   * and even within the same ISA, calls can have different sizes.
+   */
+  uint64_t call_instr_sizes[BASIC_BTB_CALL_INSTR_SIZE_TRACKERS];
+
+  BASIC_BTB_ENTRY* find_entry(uint64_t ip)
+  {
+    uint64_t set = basic_btb_set_index(ip);
+    for (uint32_t i = 0; i < BASIC_BTB_WAYS; i++) {
+      if (btb[set][i].ip_tag == ip) {
+        return &(btb[set][i]);
+      }
     }
-  }
 
-  return NULL;
-}
+    return NULL;
+  }
 
-BASIC_BTB_ENTRY* basic_btb_get_lru_entry(uint8_t cpu, uint64_t set)
-{
-  uint32_t lru_way = 0;
-  uint64_t lru_value = basic_btb[cpu][set][lru_way].lru;
-  for (uint32_t i = 0; i < BASIC_BTB_WAYS; i++) {
-    if (basic_btb[cpu][set][i].lru < lru_value) {
-      lru_way = i;
-      lru_value = basic_btb[cpu][set][lru_way].lru;
+  BASIC_BTB_ENTRY* get_lru_entry(uint64_t set)
+  {
+    uint32_t lru_way = 0;
+    uint64_t lru_value = btb[set][lru_way].lru;
+    for (uint32_t i = 0; i < BASIC_BTB_WAYS; i++) {
+      if (btb[set][i].lru < lru_value) {
+        lru_way = i;
+        lru_value = btb[set][lru_way].lru;
+      }
     }
+
+    return &(btb[set][lru_way]);
   }
 
-  return &(basic_btb[cpu][set][lru_way]);
-}
+  void update_lru(BASIC_BTB_ENTRY* btb_entry)
+  {
+    btb_entry->lru = lru_counter;
+    lru_counter++;
+  }
 
-void basic_btb_update_lru(uint8_t cpu, BASIC_BTB_ENTRY* btb_entry)
-{
-  btb_entry->lru = basic_btb_lru_counter[cpu];
-  basic_btb_lru_counter[cpu]++;
-}
+  uint64_t indirect_hash(uint64_t ip)
+  {
+    uint64_t hash = (ip >> 2) ^ conditional_history;
+    return (hash & (BASIC_BTB_INDIRECT_SIZE - 1));
+  }
 
-uint64_t basic_btb_indirect_hash(uint8_t cpu, uint64_t ip)
-{
-  uint64_t hash = (ip >> 2) ^ (basic_btb_conditional_history[cpu]);
-  return (hash & (BASIC_BTB_INDIRECT_SIZE - 1));
-}
+  void push_ras(uint64_t ip)
+  {
+    ras_index++;
+    if (ras_index == BASIC_BTB_RAS_SIZE) {
+      ras_index = 0;
+    }
 
-void push_basic_btb_ras(uint8_t cpu, uint64_t ip)
-{
-  basic_btb_ras_index[cpu]++;
-  if (basic_btb_ras_index[cpu] == BASIC_BTB_RAS_SIZE) {
-    basic_btb_ras_index[cpu] = 0;
+    ras[ras_index] = ip;
   }
 
-  basic_btb_ras[cpu][basic_btb_ras_index[cpu]] = ip;
-}
+  uint64_t peek_ras() { return ras[ras_index]; }
 
-uint64_t peek_basic_btb_ras(uint8_t cpu) { return basic_btb_ras[cpu][basic_btb_ras_index[cpu]]; }
+  uint64_t pop_ras()
+  {
+    uint64_t target = ras[ras_index];
+    ras[ras_index] = 0;
 
-uint64_t pop_basic_btb_ras(uint8_t cpu)
-{
-  uint64_t target = basic_btb_ras[cpu][basic_btb_ras_index[cpu]];
-  basic_btb_ras[cpu][basic_btb_ras_index[cpu]] = 0;
+    ras_index--;
+    if (ras_index == -1) {
+      ras_index += BASIC_BTB_RAS_SIZE;
+    }
 
-  basic_btb_ras_index[cpu]--;
-  if (basic_btb_ras_index[cpu] == -1) {
-    basic_btb_ras_index[cpu] += BASIC_BTB_RAS_SIZE;
+    return target;
   }
 
-  return target;
-}
-
-uint64_t basic_btb_call_size_tracker_hash(uint64_t ip) { return (ip & (BASIC_BTB_CALL_INSTR_SIZE_TRACKERS - 1)); }
-
-uint64_t basic_btb_get_call_size(uint8_t cpu, uint64_t ip)
-{
-  uint64_t size = basic_btb_call_instr_sizes[cpu][basic_btb_call_size_tracker_hash(ip)];
-
-  return size;
-}
+  uint64_t get_call_size(uint64_t ip) { return call_instr_sizes[basic_btb_call_size_tracker_hash(ip)]; }
+};
+} // namespace
 
 void O3_CPU::initialize_btb()
 {
   std::cout << "Basic BTB sets: " << BASIC_BTB_SETS << " ways: " << BASIC_BTB_WAYS << " indirect buffer size: " << BASIC_BTB_INDIRECT_SIZE
             << " RAS size: " << BASIC_BTB_RAS_SIZE << std::endl;
 
-  for (uint32_t i = 0; i < BASIC_BTB_SETS; i++) {
-    for (uint32_t j = 0; j < BASIC_BTB_WAYS; j++) {
-      basic_btb[cpu][i][j].ip_tag = 0;
-      basic_btb[cpu][i][j].target = 0;
-      basic_btb[cpu][i][j].always_taken = 0;
-      basic_btb[cpu][i][j].lru = 0;
-    }
-  }
-  basic_btb_lru_counter[cpu] = 0;
-
-  for (uint32_t i = 0; i < BASIC_BTB_INDIRECT_SIZE; i++) {
-    basic_btb_indirect[cpu][i] = 0;
-  }
-  basic_btb_conditional_history[cpu] = 0;
-
-  for (uint32_t i = 0; i < BASIC_BTB_RAS_SIZE; i++) {
-    basic_btb_ras[cpu][i] = 0;
-  }
-  basic_btb_ras_index[cpu] = 0;
+  auto& st = *btb_state.emplace<basic_btb_state>();
   for (uint32_t i = 0; i < BASIC_BTB_CALL_INSTR_SIZE_TRACKERS; i++) {
-    basic_btb_call_instr_sizes[cpu][i] = 4;
+    st.call_instr_sizes[i] = 4;
   }
 }
 
 std::pair<uint64_t, uint8_t> O3_CPU::btb_prediction(uint64_t ip, uint8_t branch_type)
 {
+  auto& st = *btb_state.get<basic_btb_state>();
   uint8_t always_taken = false;
   if (branch_type != BRANCH_CONDITIONAL) {
     always_taken = true;
@@ -160,21 +143,21 @@ std::pair<uint64_t, uint8_t> O3_CPU::btb_prediction(uint64_t ip, uint8_t branch_
 
   if ((branch_type == BRANCH_DIRECT_CALL) || (branch_type == BRANCH_INDIRECT_CALL)) {
     // add something to the RAS
-    push_basic_btb_ras(cpu, ip);
+    st.push_ras(ip);
   }
 
   if (branch_type == BRANCH_RETURN) {
     // peek at the top of the RAS
-    uint64_t target = peek_basic_btb_ras(cpu);
+    uint64_t target = st.peek_ras();
     // and adjust for the size of the call instr
-    target += basic_btb_get_call_size(cpu, target);
+    target += st.get_call_size(target);
 
     return std::make_pair(target, always_taken);
   } else if ((branch_type == BRANCH_INDIRECT) || (branch_type == BRANCH_INDIRECT_CALL)) {
-    return std::make_pair(basic_btb_indirect[cpu][basic_btb_indirect_hash(cpu, ip)], always_taken);
+    return std::make_pair(st.indirect[st.indirect_hash(ip)], always_taken);
   } else {
     // use BTB for all other branches + direct calls
-    auto btb_entry = basic_btb_find_entry(cpu, ip);
+    auto btb_entry = st.find_entry(ip);
 
     if (btb_entry == NULL) {
       // no prediction for this IP
@@ -183,7 +166,7 @@ std::pair<uint64_t, uint8_t> O3_CPU::btb_prediction(uint64_t ip, uint8_t branch_
     }
 
     always_taken = btb_entry->always_taken;
-    basic_btb_update_lru(cpu, btb_entry);
+    st.update_lru(btb_entry);
 
     return std::make_pair(btb_entry->target, always_taken);
   }
@@ -193,14 +176,16 @@ std::pair<uint64_t, uint8_t> O3_CPU::btb_prediction(uint64_t ip, uint8_t branch_
 
 void O3_CPU::update_btb(uint64_t ip, uint64_t branch_target, uint8_t taken, uint8_t branch_type)
 {
+  auto& st = *btb_state.get<basic_btb_state>();
+
   // updates for indirect branches
   if ((branch_type == BRANCH_INDIRECT) || (branch_type == BRANCH_INDIRECT_CALL)) {
-    basic_btb_indirect[cpu][basic_btb_indirect_hash(cpu, ip)] = branch_target;
+    st.indirect[st.indirect_hash(ip)] = branch_target;
   }
   if (branch_type == BRANCH_CONDITIONAL) {
-    basic_btb_conditional_history[cpu] <<= 1;
+    st.conditional_history <<= 1;
     if (taken) {
-      basic_btb_conditional_history[cpu] |= 1;
+      st.conditional_history |= 1;
     }
   }
 
@@ -208,25 +193,25 @@ void O3_CPU::update_btb(uint64_t ip, uint64_t branch_target, uint8_t taken, uint
     // recalibrate call-return offset
     // if our return prediction got us into the right ball park, but not the
     // exactly correct byte target, then adjust our call instr size tracker
-    uint64_t call_ip = pop_basic_btb_ras(cpu);
+    uint64_t call_ip = st.pop_ras();
     uint64_t estimated_call_instr_size = basic_btb_abs_addr_dist(call_ip, branch_target);
     if (estimated_call_instr_size <= 10) {
-      basic_btb_call_instr_sizes[cpu][basic_btb_call_size_tracker_hash(call_ip)] = estimated_call_instr_size;
+      st.call_instr_sizes[basic_btb_call_size_tracker_hash(call_ip)] = estimated_call_instr_size;
     }
   } else if ((branch_type != BRANCH_INDIRECT) && (branch_type != BRANCH_INDIRECT_CALL)) {
     // use BTB
-    auto btb_entry = basic_btb_find_entry(cpu, ip);
+    auto btb_entry = st.find_entry(ip);
 
     if (btb_entry == NULL) {
       if ((branch_target != 0) && taken) {
         // no prediction for this entry so far, so allocate one
         uint64_t set = basic_btb_set_index(ip);
-        auto repl_entry = basic_btb_get_lru_entry(cpu, set);
+        auto repl_entry = st.get_lru_entry(set);
 
         repl_entry->ip_tag = ip;
         repl_entry->target = branch_target;
         repl_entry->always_taken = 1;
-        basic_btb_update_lru(cpu, repl_entry);
+        st.update_lru(repl_entry);
       }
     } else {
       // update an existing entry
@@ -0,0 +1,291 @@
+/*
+ * A two-level Branch Target Buffer, for code footprints that thrash a single
+ * BTB of a few thousand entries.
+ *
+ * - A small L1 BTB provides targets without a fetch bubble. It is backed by a
+ *   large L2 BTB whose hits are moved into the L1 and cost L2_LATENCY cycles,
+ *   charged to fetch through fetch_resume_cycle when the branch is taken.
+ *
+ * - Indirect branches and calls get their targets from an ITTAGE-style
+ *   predictor: an untagged base table and tagged tables indexed with
+ *   increasing lengths of global history, where the longest match provides
+ *   the target.
+ *
+ * - Returns are predicted with a return address stack.
+ *
+ * Each BTB level is kept as structure-of-arrays, so a set's tags are
+ * contiguous and the tag match is a branch-free loop over them that the
+ * compiler vectorizes.
+ */
+
+#include <array>
+#include <cstdint>
+#include <iostream>
+
+#include "ooo_cpu.h"
+
+namespace
+{
+constexpr std::size_t L1_SETS = 128;
+constexpr std::size_t L1_WAYS = 8;
+constexpr std::size_t L2_SETS = 4096;
+constexpr std::size_t L2_WAYS = 8;
+constexpr uint64_t L2_LATENCY = 2;
+
+constexpr std::size_t RAS_SIZE = 64;
+constexpr std::size_t CALL_SIZE_TRACKERS = 1024;
+
+// a set-associative array of branch targets with LRU replacement
+template <std::size_t SETS, std::size_t WAYS>
+struct btb_array {
+  static_assert(WAYS <= 32);
+
+  std::array<uint64_t, SETS * WAYS> tags = {}, targets = {};
+  std::array<uint8_t, SETS * WAYS> always_taken = {}, age = {};
+
+  static std::size_t set_begin(uint64_t ip) { return ((ip >> 2) & (SETS - 1)) * WAYS; }
+
+  // the index of the entry for this ip, or SETS * WAYS if there is none
+  std::size_t find(uint64_t ip) const
+  {
+    auto begin = set_begin(ip);
+    uint32_t match = 0;
+    for (std::size_t i = 0; i < WAYS; i++)
+      match |= static_cast<uint32_t>(tags[begin + i] == ip) << i;
+    return match ? begin + __builtin_ctz(match) : SETS * WAYS;
+  }
+
+  void touch(std::size_t idx)
+  {
+    auto begin = idx - (idx % WAYS);
+    for (std::size_t i = begin; i < begin + WAYS; i++)
+      age[i] += (age[i] < age[idx]);
+    age[idx] = 0;
+  }
+
+  std::size_t fill(uint64_t ip, uint64_t target, uint8_t taken)
+  {
+    auto begin = set_begin(ip);
+    auto victim = begin;
+    for (std::size_t i = begin; i < begin + WAYS; i++) {
+      if (tags[i] == 0) {
+        victim = i;
+        break;
+      }
+      if (age[i] > age[victim])
+        victim = i;
+    }
+
+    tags[victim] = ip;
+    targets[victim] = target;
+    always_taken[victim] = taken;
+    age[victim] = WAYS;
+    touch(victim);
+    return victim;
+  }
+};
+
+// the indirect target predictor
+constexpr std::size_t IT_NTABLES = 4;
+constexpr std::size_t IT_LOG_BASE = 10;
+constexpr std::size_t IT_LOG_TABLE = 9;
+constexpr std::size_t IT_TAG_BITS = 12;
+constexpr std::array<unsigned, IT_NTABLES> it_history_lengths = {4, 10, 24, 60};
+
+struct ittage_entry {
+  uint64_t target = 0;
+  uint16_t tag = 0;
+  uint8_t ctr = 0, u = 0;
+};
+
+uint64_t fold(uint64_t x, unsigned length, unsigned bits)
+{
+  if (length < 64)
+    x &= (uint64_t{1} << length) - 1;
+  uint64_t result = 0;
+  for (; x != 0; x >>= bits)
+    result ^= x;
+  return result & ((uint64_t{1} << bits) - 1);
+}
+
+struct two_level_btb_state {
+  btb_array<L1_SETS, L1_WAYS> l1;
+  btb_array<L2_SETS, L2_WAYS> l2;
+
+  // where the last direct branch was found, remembered from prediction to update
+  std::size_t l1_idx = L1_SETS * L1_WAYS, l2_idx = L2_SETS * L2_WAYS;
+
+  std::array<uint64_t, 1 << IT_LOG_BASE> it_base = {};
+  std::array<std::array<ittage_entry, 1 << IT_LOG_TABLE>, IT_NTABLES> it_tables = {};
+  std::array<std::size_t, IT_NTABLES> it_indices = {};
+  std::array<uint16_t, IT_NTABLES> it_tags = {};
+  int it_provider = -1;
+  uint64_t ghist = 0;
+  unsigned it_alloc_tick = 0;
+
+  std::array<uint64_t, RAS_SIZE> ras = {};
+  std::size_t ras_index = 0;
+
+  // the size of call instructions, learned from the distance between calls and their returns, since ChampSim does not model an ISA
+  std::array<uint64_t, CALL_SIZE_TRACKERS> call_instr_sizes = {};
+
+  void it_compute(uint64_t ip)
+  {
+    for (std::size_t i = 0; i < IT_NTABLES; i++) {
+      it_indices[i] = ((ip >> 2) ^ (ip >> (2 + IT_LOG_TABLE)) ^ fold(ghist, it_history_lengths[i], IT_LOG_TABLE)) & ((1 << IT_LOG_TABLE) - 1);
+      it_tags[i] = ((ip >> 2) ^ fold(ghist, it_history_lengths[i], IT_TAG_BITS - 1) * 2) & ((1 << IT_TAG_BITS) - 1);
+    }
+
+    it_provider = -1;
+    for (int i = IT_NTABLES - 1; i >= 0 && it_provider < 0; i--)
+      if (it_tables[i][it_indices[i]].tag == it_tags[i])
+        it_provider = i;
+  }
+
+  uint64_t it_predict(uint64_t ip)
+  {
+    it_compute(ip);
+    if (it_provider >= 0)
+      return it_tables[it_provider][it_indices[it_provider]].target;
+    return it_base[(ip >> 2) & ((1 << IT_LOG_BASE) - 1)];
+  }
+
+  void it_update(uint64_t ip, uint64_t target)
+  {
+    auto& base = it_base[(ip >> 2) & ((1 << IT_LOG_BASE) - 1)];
+    bool correct;
+    if (it_provider >= 0) {
+      auto& entry = it_tables[it_provider][it_indices[it_provider]];
+      correct = (entry.target == target);
+      if (correct) {
+        entry.ctr += (entry.ctr < 3);
+        entry.u += (entry.u < 3 && base != target);
+      } else if (entry.ctr > 0) {
+        entry.ctr--;
+      } else {
+        entry.target = target;
+      }
+    } else {
+      correct = (base == target);
+    }
+    base = target;
+
+    // on a misprediction, allocate in a table with longer history, aging the entries that could not be replaced
+    if (!correct) {
+      bool allocated = false;
+      for (std::size_t i = it_provider + 1; i < IT_NTABLES && !allocated; i++) {
+        auto& entry = it_tables[i][it_indices[i]];
+        if (entry.u == 0) {
+          entry = {target, it_tags[i], 0, 0};
+          allocated = true;
+        }
+      }
+      if (!allocated)
+        for (std::size_t i = it_provider + 1; i < IT_NTABLES; i++)
+          it_tables[i][it_indices[i]].u -= (it_tables[i][it_indices[i]].u > 0);
+    }
+
+    // periodically clear the useful bits so that stale entries can be replaced
+    if (++it_alloc_tick == (1 << 16)) {
+      it_alloc_tick = 0;
+      for (auto& table : it_tables)
+        for (auto& entry : table)
+          entry.u >>= 1;
+    }
+  }
+
+  std::size_t call_size_idx(uint64_t ip) const { return ip & (CALL_SIZE_TRACKERS - 1); }
+};
+} // namespace
+
+void O3_CPU::initialize_btb()
+{
+  auto& st = *btb_state.emplace<two_level_btb_state>();
+  st.call_instr_sizes.fill(4);
+
+  std::cout << "CPU " << cpu << " two-level BTB L1: " << L1_SETS * L1_WAYS << " entries L2: " << L2_SETS * L2_WAYS << " entries (" << L2_LATENCY
+            << " cycle bubble) indirect tables: " << IT_NTABLES << " RAS size: " << RAS_SIZE << std::endl;
+}
+
+std::pair<uint64_t, uint8_t> O3_CPU::btb_prediction(uint64_t ip, uint8_t branch_type)
+{
+  auto& st = *btb_state.get<two_level_btb_state>();
+
+  if (branch_type == BRANCH_RETURN) {
+    uint64_t call_ip = st.ras[st.ras_index];
+    return std::make_pair(call_ip + st.call_instr_sizes[st.call_size_idx(call_ip)], true);
+  }
+
+  if ((branch_type == BRANCH_DIRECT_CALL) || (branch_type == BRANCH_INDIRECT_CALL)) {
+    st.ras_index = (st.ras_index + 1) % RAS_SIZE;
+    st.ras[st.ras_index] = ip;
+  }
+
+  if ((branch_type == BRANCH_INDIRECT) || (branch_type == BRANCH_INDIRECT_CALL))
+    return std::make_pair(st.it_predict(ip), true);
+
+  st.l1_idx = st.l1.find(ip);
+  st.l2_idx = (st.l1_idx == L1_SETS * L1_WAYS) ? st.l2.find(ip) : L2_SETS * L2_WAYS;
+
+  if (st.l1_idx != L1_SETS * L1_WAYS) {
+    st.l1.touch(st.l1_idx);
+    return std::make_pair(st.l1.targets[st.l1_idx], st.l1.always_taken[st.l1_idx]);
+  }
+
+  if (st.l2_idx != L2_SETS * L2_WAYS) {
+    st.l2.touch(st.l2_idx);
+    return std::make_pair(st.l2.targets[st.l2_idx], st.l2.always_taken[st.l2_idx]);
+  }
+
+  // no prediction for this IP
+  return std::make_pair(0, true);
+}
+
+void O3_CPU::update_btb(uint64_t ip, uint64_t branch_target, uint8_t taken, uint8_t branch_type)
+{
+  auto& st = *btb_state.get<two_level_btb_state>();
+
+  if (branch_type == BRANCH_RETURN) {
+    // recalibrate the call-return offset if the return landed near the call
+    uint64_t call_ip = st.ras[st.ras_index];
+    st.ras[st.ras_index] = 0;
+    st.ras_index = (st.ras_index + RAS_SIZE - 1) % RAS_SIZE;
+
+    uint64_t distance = (call_ip > branch_target) ? call_ip - branch_target : branch_target - call_ip;
+    if (distance <= 10)
+      st.call_instr_sizes[st.call_size_idx(call_ip)] = distance;
+  } else if ((branch_type == BRANCH_INDIRECT) || (branch_type == BRANCH_INDIRECT_CALL)) {
+    st.it_update(ip, branch_target);
+  } else if (st.l1_idx != L1_SETS * L1_WAYS) {
+    st.l1.targets[st.l1_idx] = branch_target;
+    st.l1.always_taken[st.l1_idx] &= taken;
+
+    // keep the L2 copy, if any, in step
+    if (auto l2_idx = st.l2.find(ip); l2_idx != L2_SETS * L2_WAYS) {
+      st.l2.targets[l2_idx] = branch_target;
+      st.l2.always_taken[l2_idx] &= taken;
+    }
+  } else if (st.l2_idx != L2_SETS * L2_WAYS) {
+    st.l2.targets[st.l2_idx] = branch_target;
+    st.l2.always_taken[st.l2_idx] &= taken;
+    st.l1.fill(ip, branch_target, st.l2.always_taken[st.l2_idx]);
+
+    // The target came from the L2, so a taken branch that was predicted correctly waits for it. A mispredicted branch has
+    // already stopped fetch.
+    if (taken && fetch_stall == 0 && warmup_complete[cpu]) {
+      fetch_stall = 1;
+      fetch_resume_cycle = current_cycle + L2_LATENCY;
+      instrs_to_read_this_cycle = 0;
+    }
+  } else if ((branch_target != 0) && taken) {
+    // no prediction for this entry so far, so allocate one in both levels
+    st.l2.fill(ip, branch_target, 1);
+    st.l1.fill(ip, branch_target, 1);
+  }
+
+  // the global history for the indirect predictor: conditional outcomes, and a few bits of each indirect target
+  if (branch_type == BRANCH_CONDITIONAL)
+    st.ghist = (st.ghist << 1) | taken;
+  else if ((branch_type == BRANCH_INDIRECT) || (branch_type == BRANCH_INDIRECT_CALL))
+    st.ghist = (st.ghist << 2) ^ ((branch_target >> 2) & 0xf);
+}
@@ -20,13 +20,14 @@ def norm_fname(fname):
 # Begin format strings
 ###
 
-cache_fmtstr = 'CACHE {name}("{name}", {frequency}, {fill_level}, {sets}, {ways}, {wq_size}, {rq_size}, {pq_size}, {mshr_size}, {hit_latency}, {fill_latency}, {max_read}, {max_write}, {offset_bits}, {prefetch_as_load:b}, {wq_check_full_addr:b}, {virtual_prefetch:b}, {prefetch_activate_mask}, {lower_level}, CACHE::pref_t::{prefetcher_name}, CACHE::repl_t::{replacement_name});\n'
+cache_fmtstr = 'CACHE {name}("{name}", {frequency}, {fill_level}, {sets}, {ways}, {wq_size}, {rq_size}, {pq_size}, {mshr_size}, {hit_latency}, {fill_latency}, {max_read}, {max_write}, {offset_bits}, {prefetch_as_load:b}, {wq_check_full_addr:b}, {virtual_prefetch:b}, {prefetch_activate_mask}, {lower_level}, CACHE::pref_t::{prefetcher_name}, CACHE::repl_t::{replacement_name}, {set_sample_rate}, {unsampled_latency}, CACHE::inclusion_t::{inclusion_name}, {profile:b}, {record:b}, {prefetch_throttle:b}, {huge_sets}, {huge_ways}, {va_translator_ptr}, {va_translate_latency}, {va_translate_width});\n'
 ptw_fmtstr = 'PageTableWalker {name}("{name}", {cpu}, {fill_level}, {pscl5_set}, {pscl5_way}, {pscl4_set}, {pscl4_way}, {pscl3_set}, {pscl3_way}, {pscl2_set}, {pscl2_way}, {ptw_rq_size}, {ptw_mshr_size}, {ptw_max_read}, {ptw_max_write}, 0, {lower_level});\n'
 
-cpu_fmtstr = 'O3_CPU {name}({index}, {frequency}, {DIB[sets]}, {DIB[ways]}, {DIB[window_size]}, {ifetch_buffer_size}, {dispatch_buffer_size}, {decode_buffer_size}, {rob_size}, {lq_size}, {sq_size}, {fetch_width}, {decode_width}, {dispatch_width}, {scheduler_size}, {execute_width}, {lq_width}, {sq_width}, {retire_width}, {mispredict_penalty}, {decode_latency}, {dispatch_latency}, {schedule_latency}, {execute_latency}, &{ITLB}, &{DTLB}, &{L1I}, &{L1D}, O3_CPU::bpred_t::{bpred_name}, O3_CPU::btb_t::{btb_name}, O3_CPU::ipref_t::{iprefetcher_name});\n'
+cpu_fmtstr = 'O3_CPU {name}({index}, {frequency}, {DIB[sets]}, {DIB[ways]}, {DIB[window_size]}, {ifetch_buffer_size}, {ftq_size}, {dispatch_buffer_size}, {decode_buffer_size}, {rob_size}, {lq_size}, {sq_size}, {fetch_width}, {decode_width}, {dispatch_width}, {scheduler_size}, {execute_width}, {lq_width}, {sq_width}, {retire_width}, {mispredict_penalty}, {decode_latency}, {dispatch_latency}, {schedule_latency}, {execute_latency}, &{ITLB}, &{DTLB}, &{L1I}, &{L1D}, O3_CPU::bpred_t::{bpred_name}, O3_CPU::btb_t::{btb_name}, O3_CPU::ipref_t::{iprefetcher_name});\n'
 
-pmem_fmtstr = 'MEMORY_CONTROLLER {attrs[name]}({attrs[frequency]});\n'
-vmem_fmtstr = 'VirtualMemory vmem({attrs[size]}, 1 << 12, {attrs[num_levels]}, 1, {attrs[minor_fault_penalty]});\n'
+pmem_fmtstr = 'MEMORY_CONTROLLER {name}({attrs[frequency]}, MEMORY_CONTROLLER::sched_t::{attrs[scheduler_name]}, {node});\n'
+router_fmtstr = 'MEMORY_ROUTER {attrs[name]}(memory_controllers);\n'
+vmem_fmtstr = 'VirtualMemory vmem({attrs[size]}, 1 << 12, {attrs[num_levels]}, 1, {attrs[minor_fault_penalty]}, VirtualMemory::placement_t::{attrs[placement_name]}, {{{affinity_list}}}, VirtualMemory::huge_page_t::{attrs[huge_pages_name]}, {attrs[huge_page_fraction]}, {attrs[promotion_threshold]});\n'
 
 module_make_fmtstr = '{1}/%.o: CFLAGS += -I{1}\n{1}/%.o: CXXFLAGS += -I{1}\n{1}/%.o: CXXFLAGS += {2}\nobj/{0}: $(patsubst %.cc,%.o,$(wildcard {1}/*.cc)) $(patsubst %.c,%.o,$(wildcard {1}/*.c))\n\t@mkdir -p $(dir $@)\n\tar -rcs $@ $^\n\n'
 
@@ -56,7 +57,22 @@ const_names = {
         'tRP': 'tRP_DRAM_NANOSECONDS',
         'tRCD': 'tRCD_DRAM_NANOSECONDS',
         'tCAS': 'tCAS_DRAM_NANOSECONDS',
-        'turn_around_time': 'DBUS_TURN_AROUND_NANOSECONDS'
+        'turn_around_time': 'DBUS_TURN_AROUND_NANOSECONDS',
+        'bank_groups': 'DRAM_BANK_GROUPS',
+        'tRAS': 'tRAS_DRAM_NANOSECONDS',
+        'tCCD_S': 'tCCD_S_DRAM_NANOSECONDS',
+        'tCCD_L': 'tCCD_L_DRAM_NANOSECONDS',
+        'tRRD_S': 'tRRD_S_DRAM_NANOSECONDS',
+        'tRRD_L': 'tRRD_L_DRAM_NANOSECONDS',
+        'tFAW': 'tFAW_DRAM_NANOSECONDS',
+        'tWR': 'tWR_DRAM_NANOSECONDS',
+        'tWTR': 'tWTR_DRAM_NANOSECONDS',
+        'tREFI': 'tREFI_DRAM_NANOSECONDS',
+        'tRFC': 'tRFC_DRAM_NANOSECONDS',
+        'refresh_name': 'DRAM_REFRESH',
+        'controllers': 'NUM_MEMORY_CONTROLLERS',
+        'remote_latency': 'REMOTE_LATENCY_NANOSECONDS',
+        'remote_bandwidth': 'REMOTE_BANDWIDTH_GBPS'
     }
 }
 
@@ -74,7 +90,7 @@ else:
     print("No configuration specified. Building default ChampSim with no prefetching.")
     config_file = ChainMap(default_root)
 
-default_core = { 'frequency' : 4000, 'ifetch_buffer_size': 64, 'decode_buffer_size': 32, 'dispatch_buffer_size': 32, 'rob_size': 352, 'lq_size': 128, 'sq_size': 72, 'fetch_width' : 6, 'decode_width' : 6, 'dispatch_width' : 6, 'execute_width' : 4, 'lq_width' : 2, 'sq_width' : 2, 'retire_width' : 5, 'mispredict_penalty' : 1, 'scheduler_size' : 128, 'decode_latency' : 1, 'dispatch_latency' : 1, 'schedule_latency' : 0, 'execute_latency' : 0, 'branch_predictor': 'bimodal', 'btb': 'basic_btb' }
+default_core = { 'frequency' : 4000, 'ifetch_buffer_size': 64, 'ftq_size': 0, 'decode_buffer_size': 32, 'dispatch_buffer_size': 32, 'rob_size': 352, 'lq_size': 128, 'sq_size': 72, 'fetch_width' : 6, 'decode_width' : 6, 'dispatch_width' : 6, 'execute_width' : 4, 'lq_width' : 2, 'sq_width' : 2, 'retire_width' : 5, 'mispredict_penalty' : 1, 'scheduler_size' : 128, 'decode_latency' : 1, 'dispatch_latency' : 1, 'schedule_latency' : 0, 'execute_latency' : 0, 'branch_predictor': 'bimodal', 'btb': 'basic_btb' }
 default_dib  = { 'window_size': 16,'sets': 32, 'ways': 8 }
 default_l1i  = { 'sets': 64, 'ways': 8, 'rq_size': 64, 'wq_size': 64, 'pq_size': 32, 'mshr_size': 8, 'latency': 4, 'fill_latency': 1, 'max_read': 2, 'max_write': 2, 'prefetch_as_load': False, 'virtual_prefetch': True, 'wq_check_full_addr': True, 'prefetch_activate': 'LOAD,PREFETCH', 'prefetcher': 'no_instr', 'replacement': 'lru'}
 default_l1d  = { 'sets': 64, 'ways': 12, 'rq_size': 64, 'wq_size': 64, 'pq_size': 8, 'mshr_size': 16, 'latency': 5, 'fill_latency': 1, 'max_read': 2, 'max_write': 2, 'prefetch_as_load': False, 'virtual_prefetch': False, 'wq_check_full_addr': True, 'prefetch_activate': 'LOAD,PREFETCH', 'prefetcher': 'no', 'replacement': 'lru'}
@@ -83,8 +99,14 @@ default_itlb = { 'sets': 16, 'ways': 4, 'rq_size': 16, 'wq_size': 16, 'pq_size':
 default_dtlb = { 'sets': 16, 'ways': 4, 'rq_size': 16, 'wq_size': 16, 'pq_size': 0, 'mshr_size': 8, 'latency': 1, 'fill_latency': 1, 'max_read': 2, 'max_write': 2, 'prefetch_as_load': False, 'virtual_prefetch': False, 'wq_check_full_addr': True, 'prefetch_activate': 'LOAD,PREFETCH', 'prefetcher': 'no', 'replacement': 'lru'}
 default_stlb = { 'sets': 128, 'ways': 12, 'rq_size': 32, 'wq_size': 32, 'pq_size': 0, 'mshr_size': 16, 'latency': 8, 'fill_latency': 1, 'max_read': 1, 'max_write': 1, 'prefetch_as_load': False, 'virtual_prefetch': False, 'wq_check_full_addr': False, 'prefetch_activate': 'LOAD,PREFETCH', 'prefetcher': 'no', 'replacement': 'lru'}
 default_llc  = { 'sets': 2048*config_file['num_cores'], 'ways': 16, 'rq_size': 32*config_file['num_cores'], 'wq_size': 32*config_file['num_cores'], 'pq_size': 32*config_file['num_cores'], 'mshr_size': 64*config_file['num_cores'], 'latency': 20, 'fill_latency': 1, 'max_read': config_file['num_cores'], 'max_write': config_file['num_cores'], 'prefetch_as_load': False, 'virtual_prefetch': False, 'wq_check_full_addr': False, 'prefetch_activate': 'LOAD,PREFETCH', 'prefetcher': 'no', 'replacement': 'lru', 'name': 'LLC', 'lower_level': 'DRAM' }
-default_pmem = { 'name': 'DRAM', 'frequency': 3200, 'channels': 1, 'ranks': 1, 'banks': 8, 'rows': 65536, 'columns': 128, 'lines_per_column': 8, 'channel_width': 8, 'wq_size': 64, 'rq_size': 64, 'tRP': 12.5, 'tRCD': 12.5, 'tCAS': 12.5, 'turn_around_time': 7.5 }
-default_vmem = { 'size': 8589934592, 'num_levels': 5, 'minor_fault_penalty': 200 }
+default_pmem = { 'name': 'DRAM', 'frequency': 3200, 'channels': 1, 'ranks': 1, 'banks': 8, 'rows': 65536, 'columns': 128, 'lines_per_column': 8, 'channel_width': 8, 'wq_size': 64, 'rq_size': 64, 'tRP': 12.5, 'tRCD': 12.5, 'tCAS': 12.5, 'turn_around_time': 7.5, 'scheduler': 'fcfs', 'address_mapping': 'RoRaCoBaCh', 'channel_hash': [], 'bank_hash': [], 'bank_groups': 1, 'tRAS': 0, 'tCCD_S': 0, 'tCCD_L': 0, 'tRRD_S': 0, 'tRRD_L': 0, 'tFAW': 0, 'tWR': 0, 'tWTR': 0, 'refresh': 'none', 'tREFI': 0, 'tRFC': 0, 'controllers': 1, 'remote_latency': 0, 'remote_bandwidth': 0 }
+
+# Timing presets, selected with "preset" in the physical_memory block. Timings are in nanoseconds.
+pmem_presets = {
+    'DDR4-3200': { 'frequency': 3200, 'channel_width': 8, 'ranks': 1, 'banks': 16, 'bank_groups': 4, 'rows': 65536, 'columns': 128, 'tRP': 13.75, 'tRCD': 13.75, 'tCAS': 13.75, 'tRAS': 32, 'tCCD_S': 2.5, 'tCCD_L': 5, 'tRRD_S': 2.5, 'tRRD_L': 4.9, 'tFAW': 21, 'tWR': 15, 'tWTR': 7.5, 'refresh': 'all_bank', 'tREFI': 7800, 'tRFC': 350 },
+    'DDR5-4800': { 'frequency': 4800, 'channel_width': 4, 'ranks': 1, 'banks': 32, 'bank_groups': 8, 'rows': 65536, 'columns': 128, 'tRP': 16, 'tRCD': 16, 'tCAS': 16.67, 'tRAS': 32, 'tCCD_S': 3.33, 'tCCD_L': 5, 'tRRD_S': 3.33, 'tRRD_L': 5, 'tFAW': 13.33, 'tWR': 30, 'tWTR': 10, 'refresh': 'per_bank', 'tREFI': 3900, 'tRFC': 130 }
+}
+default_vmem = { 'size': 8589934592, 'num_levels': 5, 'minor_fault_penalty': 200, 'placement': 'first_touch', 'huge_pages': 'none', 'huge_page_size': 2097152, 'huge_page_fraction': 0.5, 'promotion_threshold': 256 }
 default_ptw = { 'pscl5_set' : 1, 'pscl5_way' : 2, 'pscl4_set' : 1, 'pscl4_way': 4, 'pscl3_set' : 2, 'pscl3_way' : 4, 'pscl2_set' : 4, 'pscl2_way': 8, 'ptw_rq_size': 16, 'ptw_mshr_size': 5, 'ptw_max_read': 2, 'ptw_max_write': 2}
 
 ###
@@ -100,7 +122,11 @@ os.makedirs('obj', exist_ok=True)
 # Establish default optional values
 ###
 
-config_file['physical_memory'] = ChainMap(config_file['physical_memory'], default_pmem.copy())
+pmem_preset = config_file['physical_memory'].get('preset')
+if pmem_preset is not None and pmem_preset not in pmem_presets:
+    print('Physical memory: preset must be one of ' + ', '.join('"' + p + '"' for p in pmem_presets) + '. Exiting...')
+    sys.exit(1)
+config_file['physical_memory'] = ChainMap(config_file['physical_memory'], pmem_presets.get(pmem_preset, {}).copy(), default_pmem.copy())
 config_file['virtual_memory'] = ChainMap(config_file['virtual_memory'], default_vmem.copy())
 
 cores = config_file.get('ooo_cpu', [{}])
@@ -168,8 +194,16 @@ caches = dict(itertools.compress(caches.items(), accessible))
 for cache in caches.values():
     cache['hit_latency'] = cache.get('hit_latency') or (cache['latency'] - cache['fill_latency'])
 
+# Establish set sampling. By default, every set is simulated.
+for cache in caches.values():
+    cache['set_sample_rate'] = cache.get('set_sample_rate', 1)
+    cache['unsampled_latency'] = cache.get('unsampled_latency') or cache['latency']
+    if cache['set_sample_rate'] < 1 or (cache['set_sample_rate'] & (cache['set_sample_rate'] - 1)) != 0 or cache['sets'] % cache['set_sample_rate'] != 0:
+        print('Cache ' + cache['name'] + ': set_sample_rate must be a power of two that divides the number of sets. Exiting...')
+        sys.exit(1)
+
 # Create prefetch activation masks
-type_list = ('LOAD', 'RFO', 'PREFETCH', 'WRITEBACK', 'TRANSLATION')
+type_list = ('LOAD', 'RFO', 'PREFETCH', 'WRITEBACK', 'TRANSLATION', 'METADATA')
 for cache in caches.values():
     cache['prefetch_activate_mask'] = functools.reduce(operator.or_, (1 << i for i,t in enumerate(type_list) if t in cache['prefetch_activate'].split(',')))
 
@@ -206,6 +240,149 @@ for cpu in cores:
         caches[cache_name]['offset_bits'] = 'LOG2_BLOCK_SIZE'
         cache_name = caches[cache_name]['lower_level']
 
+# Unsampled sets return no data, so translation caches must simulate every set
+for cache in caches.values():
+    if cache['set_sample_rate'] > 1 and cache['offset_bits'] != 'LOG2_BLOCK_SIZE':
+        print('Cache ' + cache['name'] + ': set sampling is not supported for translation caches. Exiting...')
+        sys.exit(1)
+
+# Establish inclusion policies. By default, caches are neither inclusive nor exclusive.
+first_level_names = list(itertools.chain.from_iterable((cpu['L1I'], cpu['L1D'], cpu['ITLB'], cpu['DTLB']) for cpu in cores))
+for cache in caches.values():
+    cache['inclusion'] = cache.get('inclusion', 'nine').lower()
+    if cache['inclusion'] not in ('nine', 'inclusive', 'exclusive'):
+        print('Cache ' + cache['name'] + ': inclusion must be one of "nine", "inclusive", or "exclusive". Exiting...')
+        sys.exit(1)
+    if cache['inclusion'] != 'nine' and (cache['name'] in first_level_names or cache['offset_bits'] != 'LOG2_BLOCK_SIZE'):
+        print('Cache ' + cache['name'] + ': inclusion policies are only supported for data caches below the first level. Exiting...')
+        sys.exit(1)
+    cache['inclusion_name'] = cache['inclusion'].upper()
+
+# Profiling is off unless requested
+for cache in caches.values():
+    cache['profile'] = cache.get('profile', False)
+
+# Recording is off unless requested
+for cache in caches.values():
+    cache['record'] = cache.get('record', False)
+
+# Prefetch throttling is off unless requested
+for cache in caches.values():
+    cache['prefetch_throttle'] = cache.get('prefetch_throttle', False)
+
+# Translation caches may have a separate array for huge pages
+for cache in caches.values():
+    cache['huge_sets'] = cache.get('huge_sets', 0)
+    cache['huge_ways'] = cache.get('huge_ways', 0)
+    if (cache['huge_sets'] > 0) != (cache['huge_ways'] > 0) or (cache['huge_sets'] & (cache['huge_sets'] - 1)) != 0:
+        print('Cache ' + cache['name'] + ': huge_sets must be a power of two, and given together with huge_ways. Exiting...')
+        sys.exit(1)
+    if cache['huge_ways'] > 0 and cache['offset_bits'] != 'LOG2_PAGE_SIZE':
+        print('Cache ' + cache['name'] + ': huge page arrays are only supported for translation caches. Exiting...')
+        sys.exit(1)
+
+# Virtual address prefetches are translated by looking them up in a translation cache: by default the core's ITLB for the L1I,
+# and its STLB for the L1D and L2C
+for cpu in cores:
+    for cache_name,translator in ((cpu['L1I'], cpu['ITLB']), (cpu['L1D'], cpu['STLB']), (caches[cpu['L1D']]['lower_level'], cpu['STLB'])):
+        if cache_name in caches and caches[cache_name]['offset_bits'] == 'LOG2_BLOCK_SIZE':
+            caches[cache_name]['va_translator'] = caches[cache_name].get('va_translator', translator)
+for cache in caches.values():
+    translator = cache.get('va_translator')
+    if translator is not None and (translator not in caches or caches[translator]['offset_bits'] != 'LOG2_PAGE_SIZE'):
+        print('Cache ' + cache['name'] + ': va_translator must name a translation cache. Exiting...')
+        sys.exit(1)
+    cache['va_translator_ptr'] = '&' + translator if translator is not None else 'nullptr'
+    cache['va_translate_latency'] = cache.get('va_translate_latency', caches[translator]['hit_latency'] if translator is not None else 2)
+    cache['va_translate_width'] = cache.get('va_translate_width', 2)
+
+# DRAM address mapping, given as two-letter fields from the most to the least significant bits above the block offset
+pmem = config_file['physical_memory']
+dram_fields = {'Ch': 'channels', 'Ra': 'ranks', 'Ba': 'banks', 'Co': 'columns', 'Ro': 'rows'}
+dram_order = [pmem['address_mapping'][i:i+2] for i in range(0, len(pmem['address_mapping']), 2)]
+if sorted(dram_order) != sorted(dram_fields):
+    print('Physical memory: address_mapping must name each of Ro, Ra, Ba, Co, and Ch exactly once. Exiting...')
+    sys.exit(1)
+for field in dram_fields.values():
+    if pmem[field] < 1 or (pmem[field] & (pmem[field] - 1)) != 0:
+        print('Physical memory: ' + field + ' must be a power of two. Exiting...')
+        sys.exit(1)
+
+if pmem['bank_groups'] < 1 or (pmem['bank_groups'] & (pmem['bank_groups'] - 1)) != 0 or pmem['bank_groups'] > pmem['banks']:
+    print('Physical memory: bank_groups must be a power of two no greater than banks. Exiting...')
+    sys.exit(1)
+
+# Refresh is "none", "all_bank", or "per_bank"
+if pmem['refresh'] not in ('none', 'all_bank', 'per_bank'):
+    print('Physical memory: refresh must be one of "none", "all_bank", or "per_bank". Exiting...')
+    sys.exit(1)
+if pmem['refresh'] != 'none' and (pmem['tREFI'] <= 0 or pmem['tRFC'] >= pmem['tREFI']):
+    print('Physical memory: refresh requires tREFI to be greater than tRFC. Exiting...')
+    sys.exit(1)
+pmem['refresh_name'] = 'dram_refresh_t::' + pmem['refresh'].upper()
+
+# Memory controllers each own an equal, contiguous share of the physical address space. By default, the cores are divided
+# evenly among the controllers' nodes.
+vmem = config_file['virtual_memory']
+num_controllers = pmem['controllers']
+if num_controllers < 1 or vmem['size'] % (num_controllers * config_file['page_size']) != 0:
+    print('Physical memory: the virtual memory size must divide evenly into pages among the controllers. Exiting...')
+    sys.exit(1)
+pmem['cpu_node'] = pmem.get('cpu_node', [i * num_controllers // config_file['num_cores'] for i in range(config_file['num_cores'])])
+if len(pmem['cpu_node']) != config_file['num_cores'] or any(n not in range(num_controllers) for n in pmem['cpu_node']):
+    print('Physical memory: cpu_node must give a controller index for each core. Exiting...')
+    sys.exit(1)
+
+# Physical pages are placed by "interleave" (round-robin across nodes), "first_touch" (on the node of the core that touches the
+# page first), or "affinity" (on the node given for each core)
+if vmem['placement'] not in ('interleave', 'first_touch', 'affinity'):
+    print('Virtual memory: placement must be one of "interleave", "first_touch", or "affinity". Exiting...')
+    sys.exit(1)
+vmem['affinity'] = vmem.get('affinity', pmem['cpu_node'])
+if len(vmem['affinity']) != config_file['num_cores'] or any(n not in range(num_controllers) for n in vmem['affinity']):
+    print('Virtual memory: affinity must give a controller index for each core. Exiting...')
+    sys.exit(1)
+vmem['placement_name'] = vmem['placement'].upper()
+
+# Huge pages map whole page tables of base pages: 2MB or 1GB with 4kB pages
+huge_page_sizes = [config_file['page_size'] * 512**k for k in range(1, vmem['num_levels'])]
+if vmem['huge_pages'] not in ('none', 'fraction', 'promote'):
+    print('Virtual memory: huge_pages must be one of "none", "fraction", or "promote". Exiting...')
+    sys.exit(1)
+if vmem['huge_page_size'] not in huge_page_sizes:
+    print('Virtual memory: huge_page_size must be one of ' + ', '.join(str(s) for s in huge_page_sizes) + '. Exiting...')
+    sys.exit(1)
+if vmem['huge_pages'] != 'none' and vmem['size'] % (num_controllers * vmem['huge_page_size']) != 0:
+    print('Virtual memory: the size must divide evenly into huge pages among the controllers. Exiting...')
+    sys.exit(1)
+if not (0 <= vmem['huge_page_fraction'] <= 1) or not (0 < vmem['promotion_threshold'] <= vmem['huge_page_size'] // config_file['page_size']):
+    print('Virtual memory: huge_page_fraction must be between 0 and 1, and promotion_threshold at most the base pages in a huge page. Exiting...')
+    sys.exit(1)
+vmem['huge_pages_name'] = vmem['huge_pages'].upper()
+
+dram_shifts = {}
+shift = (config_file['block_size'] - 1).bit_length()
+for token in reversed(dram_order):
+    dram_shifts[token] = shift
+    shift += (pmem[dram_fields[token]] - 1).bit_length()
+
+# Channel and bank bits may be XORed with other address bits. Each hash is a list of address masks, one per field bit starting
+# from the least significant, or "row" to XOR the field with the lowest bits of the row (permutation-based interleaving).
+def dram_hash(token, spec):
+    width = (pmem[dram_fields[token]] - 1).bit_length()
+    if spec == 'row':
+        masks = [1 << (dram_shifts['Ro'] + i) for i in range(min(width, (pmem['rows'] - 1).bit_length()))]
+    else:
+        masks = [int(m, 0) if isinstance(m, str) else m for m in spec]
+    field_mask = ((1 << width) - 1) << dram_shifts[token]
+    if len(masks) > width or any(m & field_mask for m in masks):
+        print('Physical memory: a hash may have at most one mask per field bit, and may not include the bits of its own field. Exiting...')
+        sys.exit(1)
+    return masks
+
+pmem['channel_hash'] = dram_hash('Ch', pmem['channel_hash'])
+pmem['bank_hash'] = dram_hash('Ba', pmem['bank_hash'])
+
 ###
 # Check to make sure modules exist and they correspond to any already-built modules.
 ###
@@ -357,6 +534,26 @@ for cpu in cores:
     caches[cpu['L1I']]['prefetcher_cycle_operate'] = cpu['iprefetcher_cycle_operate']
     caches[cpu['L1I']]['prefetcher_final_stats'] = cpu['iprefetcher_final_stats']
 
+# Resolve DRAM scheduler function names
+pmem = config_file['physical_memory']
+fname = os.path.join('dram_scheduler', pmem['scheduler'])
+if not os.path.exists(fname):
+    fname = norm_fname(pmem['scheduler'])
+if not os.path.exists(fname):
+    print('Path "' + fname + '" does not exist. Exiting...')
+    sys.exit(1)
+
+pmem['scheduler_name'] = 's' + fname.translate(fname_translation_table)
+pmem['scheduler_initialize'] = 'sched_' + pmem['scheduler_name'] + '_initialize'
+pmem['scheduler_schedule'] = 'sched_' + pmem['scheduler_name'] + '_schedule'
+pmem['scheduler_final_stats'] = 'sched_' + pmem['scheduler_name'] + '_final_stats'
+
+opts = ''
+opts += ' -Dinitialize_dram_scheduler=' + pmem['scheduler_initialize']
+opts += ' -Dschedule_dram_request=' + pmem['scheduler_schedule']
+opts += ' -Ddram_scheduler_final_stats=' + pmem['scheduler_final_stats']
+libfilenames['sched_' + pmem['scheduler_name'] + '.a'] = (fname, opts)
+
 # Check cache of previous configuration
 if os.path.exists(config_cache_name):
     with open(config_cache_name) as rfp:
@@ -428,9 +625,16 @@ with open(instantiation_file_name, 'wt') as wfp:
     wfp.write('#include <array>\n')
     wfp.write('#include <vector>\n')
 
-    wfp.write(vmem_fmtstr.format(attrs=config_file['virtual_memory']))
+    wfp.write(vmem_fmtstr.format(attrs=vmem, affinity_list=', '.join(str(n) for n in vmem['affinity'])))
     wfp.write('\n')
-    wfp.write(pmem_fmtstr.format(attrs=config_file['physical_memory']))
+    for i in range(num_controllers):
+        wfp.write(pmem_fmtstr.format(name=pmem['name'] + str(i), node=i, attrs=pmem))
+    wfp.write('std::array<MEMORY_CONTROLLER*, NUM_MEMORY_CONTROLLERS> memory_controllers {\n')
+    wfp.write(', '.join('&' + pmem['name'] + str(i) for i in range(num_controllers)))
+    wfp.write('\n};\n')
+    wfp.write(router_fmtstr.format(attrs=pmem))
+    for name in sorted({elem['va_translator'] for elem in memory_system if elem.get('va_translator') is not None}):
+        wfp.write('extern CACHE ' + name + ';\n')
     for elem in memory_system:
         if 'pscl5_set' in elem:
             wfp.write(ptw_fmtstr.format(**elem))
@@ -444,12 +648,16 @@ with open(instantiation_file_name, 'wt') as wfp:
     wfp.write(', '.join('&{name}'.format(**elem) for elem in cores))
     wfp.write('\n};\n')
 
+    wfp.write('std::array<PageTableWalker*, NUM_CPUS> ptws {\n')
+    wfp.write(', '.join('&{PTW}'.format(**elem) for elem in cores))
+    wfp.write('\n};\n')
+
     wfp.write('std::array<CACHE*, NUM_CACHES> caches {\n')
     wfp.write(', '.join('&{name}'.format(**elem) for elem in memory_system if 'pscl5_set' not in elem))
     wfp.write('\n};\n')
 
     wfp.write('std::array<champsim::operable*, NUM_OPERABLES> operables {\n')
-    wfp.write(', '.join('&{name}'.format(**elem) for elem in itertools.chain(cores, memory_system, (config_file['physical_memory'],))))
+    wfp.write(', '.join(itertools.chain(('&{name}'.format(**elem) for elem in itertools.chain(cores, memory_system)), ('&' + pmem['name'] + str(i) for i in range(num_controllers)))))
     wfp.write('\n};\n')
 
 # Core modules file
@@ -657,6 +865,34 @@ with open('inc/cache_modules.inc', 'wt') as wfp:
     wfp.write('\n}\n')
     wfp.write('\n')
 
+# DRAM controller modules file
+with open('inc/dram_controller_modules.inc', 'wt') as wfp:
+    wfp.write('enum class sched_t\n{\n    ')
+    wfp.write(pmem['scheduler_name'])
+    wfp.write('\n};\n')
+    wfp.write('\n')
+
+    wfp.write('void {}();'.format(pmem['scheduler_initialize']))
+    wfp.write('\nvoid impl_dram_scheduler_initialize()\n{\n    ')
+    wfp.write('if (sched_type == sched_t::{scheduler_name}) return {scheduler_initialize}();'.format(**pmem))
+    wfp.write('\n    throw std::invalid_argument("DRAM scheduler module not found");')
+    wfp.write('\n}\n')
+    wfp.write('\n')
+
+    wfp.write('std::vector<PACKET>::iterator {}(DRAM_CHANNEL&);'.format(pmem['scheduler_schedule']))
+    wfp.write('\nstd::vector<PACKET>::iterator impl_schedule_dram_request(DRAM_CHANNEL& channel)\n{\n    ')
+    wfp.write('if (sched_type == sched_t::{scheduler_name}) return {scheduler_schedule}(channel);'.format(**pmem))
+    wfp.write('\n    throw std::invalid_argument("DRAM scheduler module not found");')
+    wfp.write('\n}\n')
+    wfp.write('\n')
+
+    wfp.write('void {}();'.format(pmem['scheduler_final_stats']))
+    wfp.write('\nvoid impl_dram_scheduler_final_stats()\n{\n    ')
+    wfp.write('if (sched_type == sched_t::{scheduler_name}) return {scheduler_final_stats}();'.format(**pmem))
+    wfp.write('\n    throw std::invalid_argument("DRAM scheduler module not found");')
+    wfp.write('\n}\n')
+    wfp.write('\n')
+
 # Constants header
 with open(constants_header_name, 'wt') as wfp:
     wfp.write('/***\n * THIS FILE IS AUTOMATICALLY GENERATED\n * Do not edit this file. It will be overwritten when the configure script is run.\n ***/\n\n')
@@ -670,14 +906,23 @@ with open(constants_header_name, 'wt') as wfp:
     wfp.write(define_fmtstr.format(name='heartbeat_frequency').format(names=const_names, config=config_file))
     wfp.write(define_fmtstr.format(name='num_cores').format(names=const_names, config=config_file))
     wfp.write('#define NUM_CACHES ' + str(len(caches)) + 'u\n')
-    wfp.write('#define NUM_OPERABLES ' + str(len(cores) + len(memory_system) + 1) + 'u\n')
+    wfp.write('#define NUM_OPERABLES ' + str(len(cores) + len(memory_system) + num_controllers) + 'u\n')
 
     for k in const_names['physical_memory']:
-        if k in ['tRP', 'tRCD', 'tCAS', 'turn_around_time']:
+        if k in ['tRP', 'tRCD', 'tCAS', 'turn_around_time', 'tRAS', 'tCCD_S', 'tCCD_L', 'tRRD_S', 'tRRD_L', 'tFAW', 'tWR', 'tWTR', 'tREFI', 'tRFC', 'refresh_name', 'remote_latency', 'remote_bandwidth']:
             wfp.write(define_nonint_fmtstr.format(name=k).format(names=const_names['physical_memory'], config=config_file['physical_memory']))
         else:
             wfp.write(define_fmtstr.format(name=k).format(names=const_names['physical_memory'], config=config_file['physical_memory']))
 
+    for token,name in (('Ch', 'CHANNEL'), ('Ra', 'RANK'), ('Ba', 'BANK'), ('Co', 'COLUMN'), ('Ro', 'ROW')):
+        wfp.write('#define DRAM_' + name + '_SHIFT ' + str(dram_shifts[token]) + 'u\n')
+    wfp.write('#define DRAM_CHANNEL_HASH {' + ', '.join(hex(m) + 'ull' for m in pmem['channel_hash']) + '}\n')
+    wfp.write('#define DRAM_BANK_HASH {' + ', '.join(hex(m) + 'ull' for m in pmem['bank_hash']) + '}\n')
+    wfp.write('#define MEMORY_NODE_SIZE ' + str(vmem['size'] // num_controllers) + 'ull\n')
+    wfp.write('#define HUGE_PAGE_SIZE ' + str(vmem['huge_page_size']) + 'ull\n')
+    wfp.write('#define LOG2_HUGE_PAGE_SIZE lg2(HUGE_PAGE_SIZE)\n')
+    wfp.write('#define CPU_MEMORY_NODE {' + ', '.join(str(n) + 'u' for n in pmem['cpu_node']) + '}\n')
+
     wfp.write('#endif\n')
 
 # Makefile
@@ -690,13 +935,14 @@ with open('Makefile', 'wt') as wfp:
     wfp.write('LDFLAGS := ' + config_file.get('LDFLAGS', '') + '\n')
     wfp.write('LDLIBS := ' + config_file.get('LDLIBS', '') + '\n')
     wfp.write('\n')
-    wfp.write('.phony: all clean\n\n')
+    wfp.write('.phony: all clean bpred_replay cache_replay\n\n')
     wfp.write('all: ' + config_file['executable_name'] + '\n\n')
     wfp.write('clean: \n')
     wfp.write('\t$(RM) ' + constants_header_name + '\n')
     wfp.write('\t$(RM) ' + instantiation_file_name + '\n')
     wfp.write('\t$(RM) ' + 'inc/cache_modules.inc' + '\n')
     wfp.write('\t$(RM) ' + 'inc/ooo_cpu_modules.inc' + '\n')
+    wfp.write('\t$(RM) ' + 'inc/dram_controller_modules.inc' + '\n')
     wfp.write('\t find . -name \*.o -delete\n\t find . -name \*.d -delete\n\t $(RM) -r obj\n\n')
     for v in libfilenames.values():
         wfp.write('\t find {0} -name \*.o -delete\n\t find {0} -name \*.d -delete\n'.format(*v))
@@ -704,10 +950,18 @@ with open('Makefile', 'wt') as wfp:
     wfp.write(config_file['executable_name'] + ': $(patsubst %.cc,%.o,$(wildcard src/*.cc)) ' + ' '.join('obj/' + k for k in libfilenames) + '\n')
     wfp.write('\t$(CXX) $(LDFLAGS) -o $@ $^ $(LDLIBS)\n\n')
 
+    # the replay tools link the simulator's objects, except its main, with the same modules
+    for replay in ('bpred_replay', 'cache_replay'):
+        replay_name = os.path.join(os.path.dirname(config_file['executable_name']), replay)
+        wfp.write(replay + ': ' + replay_name + '\n\n')
+        wfp.write(replay_name + ': replay/' + replay + '.o $(filter-out src/main.o,$(patsubst %.cc,%.o,$(wildcard src/*.cc))) ' + ' '.join('obj/' + k for k in libfilenames) + '\n')
+        wfp.write('\t$(CXX) $(LDFLAGS) -o $@ $^ $(LDLIBS)\n\n')
+
     for k,v in libfilenames.items():
         wfp.write(module_make_fmtstr.format(k, *v))
 
     wfp.write('-include $(wildcard src/*.d)\n')
+    wfp.write('-include $(wildcard replay/*.d)\n')
     for v in libfilenames.values():
         wfp.write('-include $(wildcard {0}/*.d)\n'.format(*v))
     wfp.write('\n')
@@ -0,0 +1,100 @@
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <iostream>
+
+#include "dram_controller.h"
+
+/*
+ * Blacklisting memory scheduler, after Subramanian et al., "The Blacklisting Memory Scheduler," ICCD 2014.
+ *
+ * A core that is served more than BLACKLIST_THRESHOLD requests in a row on a channel is blacklisted. Each free bank offers two
+ * candidates, its oldest packet and its oldest row buffer hit. Candidates from cores that are not blacklisted are served first,
+ * then row buffer hits, then the oldest. The blacklist is cleared every CLEARING_INTERVAL cycles.
+ */
+constexpr unsigned BLACKLIST_THRESHOLD = 4;
+constexpr uint64_t CLEARING_INTERVAL = 10000;
+
+namespace
+{
+struct bliss_state {
+  std::bitset<NUM_CPUS> blacklist;
+  uint64_t next_clear = CLEARING_INTERVAL;
+
+  struct streak_t {
+    uint32_t cpu = 0;
+    unsigned length = 0;
+  };
+  std::array<streak_t, DRAM_CHANNELS> streaks = {};
+
+  uint64_t blacklistings = 0;
+};
+} // namespace
+
+void MEMORY_CONTROLLER::initialize_dram_scheduler() { sched_state.emplace<bliss_state>(); }
+
+std::vector<PACKET>::iterator MEMORY_CONTROLLER::schedule_dram_request(DRAM_CHANNEL& channel)
+{
+  auto& st = *sched_state.get<bliss_state>();
+  auto& streak = st.streaks[std::distance(std::data(channels), &channel)];
+
+  if (current_cycle >= st.next_clear) {
+    st.blacklist.reset();
+    st.next_clear = current_cycle + CLEARING_INTERVAL;
+  }
+
+  auto& queue = channel.write_mode ? channel.WQ : channel.RQ;
+  auto& pending = channel.write_mode ? channel.wq_pending : channel.rq_pending;
+
+  // each free bank offers the candidates FR-FCFS would choose between, its oldest packet and its oldest row buffer hit, and
+  // these are ranked across the banks with the blacklist
+  auto selected = std::end(queue);
+  int selected_priority = -1;
+  auto consider = [&](std::vector<PACKET>::iterator pkt, bool hit) {
+    int priority = ((pkt->cpu < NUM_CPUS && st.blacklist.test(pkt->cpu)) ? 0 : 2) + (hit ? 1 : 0);
+    if (priority > selected_priority || (priority == selected_priority && schedules_before(pkt, selected))) {
+      selected = pkt;
+      selected_priority = priority;
+    }
+  };
+
+  for (std::size_t i = 0; i < std::size(pending); ++i) {
+    // each bank list is ordered by arrival, so a bank whose oldest packet has not yet arrived has nothing ready
+    if (channel.bank_request[i].valid || std::empty(pending[i]) || pending[i].front()->event_cycle > current_cycle)
+      continue;
+
+    auto open_row = channel.bank_request[i].open_row;
+    auto hit = std::find_if(std::begin(pending[i]), std::end(pending[i]), [open_row, this](auto x) {
+      return x->event_cycle <= current_cycle && dram_get_row(x->address) == open_row;
+    });
+
+    consider(pending[i].front(), hit == std::begin(pending[i]));
+    if (hit != std::end(pending[i]) && hit != std::begin(pending[i]))
+      consider(*hit, true);
+  }
+
+  if (selected != std::end(queue)) {
+    if (selected->cpu == streak.cpu) {
+      streak.length++;
+    } else {
+      streak.cpu = selected->cpu;
+      streak.length = 1;
+    }
+
+    if (streak.length > BLACKLIST_THRESHOLD && streak.cpu < NUM_CPUS && !st.blacklist.test(streak.cpu)) {
+      st.blacklist.set(streak.cpu);
+      st.blacklistings++;
+    }
+  }
+
+  return selected;
+}
+
+void MEMORY_CONTROLLER::dram_scheduler_final_stats()
+{
+  auto& st = *sched_state.get<bliss_state>();
+  std::cout << "DRAM ";
+  if (NUM_MEMORY_CONTROLLERS > 1)
+    std::cout << "CONTROLLER " << node << " ";
+  std::cout << "BLISS BLACKLISTINGS: " << st.blacklistings << std::endl;
+}
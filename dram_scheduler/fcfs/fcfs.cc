@@ -0,0 +1,21 @@
+#include "dram_controller.h"
+
+void MEMORY_CONTROLLER::initialize_dram_scheduler() {}
+
+// the oldest unscheduled packet, even if its bank is busy
+std::vector<PACKET>::iterator MEMORY_CONTROLLER::schedule_dram_request(DRAM_CHANNEL& channel)
+{
+  auto& queue = channel.write_mode ? channel.WQ : channel.RQ;
+  auto& pending = channel.write_mode ? channel.wq_pending : channel.rq_pending;
+
+  // each bank list is ordered by age, so the oldest packet is at the head of one of them
+  auto oldest = std::end(queue);
+  for (auto& bank : pending) {
+    if (!std::empty(bank) && (oldest == std::end(queue) || schedules_before(bank.front(), oldest)))
+      oldest = bank.front();
+  }
+
+  return oldest;
+}
+
+void MEMORY_CONTROLLER::dram_scheduler_final_stats() {}
@@ -0,0 +1,33 @@
+#include <algorithm>
+
+#include "dram_controller.h"
+
+void MEMORY_CONTROLLER::initialize_dram_scheduler() {}
+
+// first-ready, first-come first-served: the oldest row buffer hit to a free bank, or else the oldest packet to a free bank
+std::vector<PACKET>::iterator MEMORY_CONTROLLER::schedule_dram_request(DRAM_CHANNEL& channel)
+{
+  auto& queue = channel.write_mode ? channel.WQ : channel.RQ;
+  auto& pending = channel.write_mode ? channel.wq_pending : channel.rq_pending;
+
+  auto oldest = std::end(queue), oldest_hit = std::end(queue);
+  for (std::size_t i = 0; i < std::size(pending); ++i) {
+    // each bank list is ordered by arrival, so a bank whose oldest packet has not yet arrived has nothing ready
+    if (channel.bank_request[i].valid || std::empty(pending[i]) || pending[i].front()->event_cycle > current_cycle)
+      continue;
+
+    if (oldest == std::end(queue) || schedules_before(pending[i].front(), oldest))
+      oldest = pending[i].front();
+
+    auto open_row = channel.bank_request[i].open_row;
+    auto hit = std::find_if(std::begin(pending[i]), std::end(pending[i]), [open_row, this](auto x) {
+      return x->event_cycle <= current_cycle && dram_get_row(x->address) == open_row;
+    });
+    if (hit != std::end(pending[i]) && (oldest_hit == std::end(queue) || schedules_before(*hit, oldest_hit)))
+      oldest_hit = *hit;
+  }
+
+  return (oldest_hit != std::end(queue)) ? oldest_hit : oldest;
+}
+
+void MEMORY_CONTROLLER::dram_scheduler_final_stats() {}
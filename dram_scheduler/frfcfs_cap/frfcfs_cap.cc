@@ -0,0 +1,70 @@
+#include <algorithm>
+#include <array>
+#include <iostream>
+
+#include "dram_controller.h"
+
+// the number of younger row buffer hits that may be served ahead of the oldest packet to a bank
+constexpr unsigned CAP = 4;
+
+namespace
+{
+struct frfcfs_cap_state {
+  std::array<std::array<unsigned, DRAM_RANKS * DRAM_BANKS>, DRAM_CHANNELS> bypasses = {};
+  uint64_t capped = 0;
+};
+} // namespace
+
+void MEMORY_CONTROLLER::initialize_dram_scheduler() { sched_state.emplace<frfcfs_cap_state>(); }
+
+// FR-FCFS, except that a bank stops preferring row buffer hits once CAP of them have bypassed its oldest packet
+std::vector<PACKET>::iterator MEMORY_CONTROLLER::schedule_dram_request(DRAM_CHANNEL& channel)
+{
+  auto& st = *sched_state.get<frfcfs_cap_state>();
+  auto& bypasses = st.bypasses[std::distance(std::data(channels), &channel)];
+
+  auto& queue = channel.write_mode ? channel.WQ : channel.RQ;
+  auto& pending = channel.write_mode ? channel.wq_pending : channel.rq_pending;
+
+  auto oldest = std::end(queue), oldest_hit = std::end(queue);
+  for (std::size_t i = 0; i < std::size(pending); ++i) {
+    // each bank list is ordered by arrival, so a bank whose oldest packet has not yet arrived has nothing ready
+    if (channel.bank_request[i].valid || std::empty(pending[i]) || pending[i].front()->event_cycle > current_cycle)
+      continue;
+
+    if (oldest == std::end(queue) || schedules_before(pending[i].front(), oldest))
+      oldest = pending[i].front();
+
+    auto open_row = channel.bank_request[i].open_row;
+    auto hit = std::find_if(std::begin(pending[i]), std::end(pending[i]), [open_row, this](auto x) {
+      return x->event_cycle <= current_cycle && dram_get_row(x->address) == open_row;
+    });
+    if (hit != std::begin(pending[i]) && hit != std::end(pending[i]) && bypasses[i] >= CAP) {
+      st.capped++;
+      hit = std::begin(pending[i]); // the oldest packet takes the place of the hit
+    }
+
+    if (hit != std::end(pending[i]) && (oldest_hit == std::end(queue) || schedules_before(*hit, oldest_hit)))
+      oldest_hit = *hit;
+  }
+
+  auto selected = (oldest_hit != std::end(queue)) ? oldest_hit : oldest;
+  if (selected != std::end(queue)) {
+    auto idx = dram_get_rank(selected->address) * DRAM_BANKS + dram_get_bank(selected->address);
+    if (selected == pending[idx].front())
+      bypasses[idx] = 0;
+    else
+      bypasses[idx]++;
+  }
+
+  return selected;
+}
+
+void MEMORY_CONTROLLER::dram_scheduler_final_stats()
+{
+  auto& st = *sched_state.get<frfcfs_cap_state>();
+  std::cout << "DRAM ";
+  if (NUM_MEMORY_CONTROLLERS > 1)
+    std::cout << "CONTROLLER " << node << " ";
+  std::cout << "FR-FCFS CAPPED: " << st.capped << std::endl;
+}
@@ -0,0 +1,57 @@
+#ifndef ACCESS_RECORDER_H
+#define ACCESS_RECORDER_H
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace champsim
+{
+
+/*
+ * Optional recording of the requests that reach a CACHE's tag array, for bin/cache_replay. Every read, write, and prefetch from
+ * an upper level is logged in order with the outcome it had; the cache's own prefetches, fills, and victims are left out, since
+ * they depend on the modules and are regenerated by the replay.
+ *
+ * The file starts with a header naming the cache and giving its geometry, followed by fixed-size records.
+ */
+class access_recorder
+{
+public:
+  static constexpr char MAGIC[8] = {'C', 'S', 'A', 'C', 'C', 'E', 'S', '1'};
+
+  struct header {
+    char magic[8];
+    char name[48];
+    uint32_t sets, ways, offset_bits, virtual_prefetch;
+  };
+
+  struct record {
+    uint64_t address, v_address, ip;
+    uint8_t type, cpu, hit, pad[5];
+  };
+
+  static_assert(sizeof(record) == 32);
+
+  access_recorder(const std::string& fname, const std::string& name, uint32_t sets, uint32_t ways, uint32_t offset_bits, bool virtual_prefetch);
+
+  void record_access(uint64_t address, uint64_t v_address, uint64_t ip, uint8_t type, uint32_t cpu, bool hit);
+  void close();
+
+  const std::string fname;
+
+private:
+  // records are written out in batches of this many
+  static constexpr std::size_t BUFFER_SIZE = 1 << 16;
+
+  header hdr = {};
+  std::ofstream file;
+  std::vector<record> buffer;
+
+  void flush();
+};
+
+} // namespace champsim
+
+#endif
@@ -16,6 +16,7 @@ class PACKET
 {
 public:
   bool scheduled = false;
+  bool dirty = false; // the data carried is newer than the copy in memory
 
   uint8_t asid[2] = {std::numeric_limits<uint8_t>::max(), std::numeric_limits<uint8_t>::max()}, type = 0, fill_level = 0, pf_origin_level = 0;
 
@@ -29,6 +30,9 @@ public:
   std::vector<MemoryRequestProducer*> to_return;
 
   uint8_t translation_level = 0, init_translation_level = 0;
+
+  // for translations, the page table level of the leaf entry: 0 for base pages
+  uint8_t page_level = 0;
 };
 
 template <>
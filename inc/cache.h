@@ -3,28 +3,71 @@
 
 #include <functional>
 #include <list>
+#include <memory>
+#include <optional>
 #include <string>
 #include <vector>
 
+#include "access_recorder.h"
+#include "cache_profiler.h"
 #include "champsim.h"
 #include "delay_queue.hpp"
 #include "memory_class.h"
+#include "module_state.h"
 #include "ooo_cpu.h"
 #include "operable.h"
-
-// virtual address space prefetching
-#define VA_PREFETCH_TRANSLATION_LATENCY 2
+#include "prefetch_throttle.h"
 
 extern std::array<O3_CPU*, NUM_CPUS> ooo_cpu;
 
 class CACHE : public champsim::operable, public MemoryRequestConsumer, public MemoryRequestProducer
 {
 public:
+  // How the contents of this cache relate to the contents of the caches above it
+  enum class inclusion_t { NINE, INCLUSIVE, EXCLUSIVE };
+
+  // A fill, an eviction, or a demand hit on a prefetched block in this cache, as reported to prefetchers at other levels
+  struct prefetch_event {
+    enum class kind_t { FILL, EVICT, PREFETCH_HIT };
+
+    kind_t kind;
+    CACHE* cache;
+    uint64_t address, v_address, ip; // the block filled, evicted, or hit, and the IP of the access that filled or hit it
+    uint32_t cpu;
+    uint8_t type;         // the type of the access that filled or hit the block
+    bool prefetch;        // FILL: a prefetch of this level; EVICT: a prefetch of this level that was never used
+    bool late;            // PREFETCH_HIT: the demand arrived while the prefetch was still in flight
+    uint32_t pf_metadata; // FILL: the metadata the prefetch was issued with
+  };
+  using prefetch_listener = std::function<void(const prefetch_event&)>;
+
+  // What became of a prefetch issued into a cache: queued there as a new prefetch, refused for now because the queue is full or
+  // the throttle holds it back, or dropped (outside the sampled sets, declined below, beyond the throttle's distance, or merged
+  // with a prefetch or writeback already queued)
+  enum class prefetch_result { ENQUEUED, DEFERRED, DROPPED };
+
+  // A summary of the prefetching done at this level, for prefetchers at other levels to consult
+  struct prefetch_status {
+    uint32_t pq_occupancy, pq_size, mshr_occupancy, mshr_size;
+    uint64_t issued, useful, useless;
+    double accuracy; // useful over resolved prefetches since the statistics were last reset, or 1 before any was resolved
+  };
+
   uint32_t cpu;
   const std::string NAME;
   const uint32_t NUM_SET, NUM_WAY, WQ_SIZE, RQ_SIZE, PQ_SIZE, MSHR_SIZE;
   const uint32_t HIT_LATENCY, FILL_LATENCY, OFFSET_BITS;
+
+  // Set sampling: only one set in every SET_SAMPLE_RATE is simulated, and NUM_SET counts only the simulated sets.
+  // Accesses to the other sets hold no tag state and return after UNSAMPLED_LATENCY.
+  const uint32_t SET_SAMPLE_RATE, UNSAMPLED_LATENCY;
+
   std::vector<BLOCK> block{NUM_SET * NUM_WAY};
+
+  // Translation caches may hold huge pages in a separate array, with LRU replacement. Without one, huge pages are split into
+  // base page entries in the main array.
+  const uint32_t HUGE_SET, HUGE_WAY;
+  std::vector<BLOCK> huge_block{HUGE_SET * HUGE_WAY};
   const uint32_t MAX_READ, MAX_WRITE;
   uint32_t reads_available_this_cycle, writes_available_this_cycle;
   const bool prefetch_as_load;
@@ -39,8 +82,9 @@ public:
   // queues
   champsim::delay_queue<PACKET> RQ{RQ_SIZE, HIT_LATENCY}, // read queue
       PQ{PQ_SIZE, HIT_LATENCY},                           // prefetch queue
-      VAPQ{PQ_SIZE, VA_PREFETCH_TRANSLATION_LATENCY},     // virtual address prefetch queue
-      WQ{WQ_SIZE, HIT_LATENCY};                           // write queue
+      WQ{WQ_SIZE, HIT_LATENCY},                           // write queue
+      UNSAMPLED{MSHR_SIZE, UNSAMPLED_LATENCY};            // accesses to sets outside the sample
+  champsim::delay_queue<PACKET> VAPQ;                     // virtual address prefetch queue, delayed by the translation latency
 
   std::list<PACKET> MSHR; // MSHR
 
@@ -51,6 +95,26 @@ public:
            WQ_FULL = 0, WQ_FORWARD = 0, WQ_TO_CACHE = 0;
 
   uint64_t total_miss_latency = 0;
+  uint64_t UNSAMPLED_ACCESS = 0;
+  uint64_t BACK_INVAL = 0;
+  uint64_t HUGE_PAGE_HIT = 0;
+
+  // Prefetches to virtual addresses are translated by looking them up in a translation cache, normally the core's STLB, after its
+  // hit latency and at most VA_TRANSLATE_WIDTH pages per cycle. A prefetch to the same page as the one before it in the same cycle
+  // reuses that translation, and one whose page misses is dropped rather than walked. Without a translation cache, translations
+  // are free.
+  CACHE* const va_translator;
+  const uint32_t VA_TRANSLATE_WIDTH;
+  uint64_t VA_TRANSLATED = 0, VA_MERGED = 0, VA_DROPPED = 0;
+
+  // caches whose lower level is this cache
+  std::vector<CACHE*> upper_levels;
+
+  // set when the lower level is exclusive, and must also receive clean victims
+  bool send_clean_victims = false;
+
+  // callbacks registered by the prefetchers of other caches, invoked on every prefetch_event here
+  std::vector<prefetch_listener> prefetch_listeners;
 
   // functions
   int add_rq(PACKET* packet) override;
@@ -64,44 +128,94 @@ public:
 
   uint32_t get_occupancy(uint8_t queue_type, uint64_t address) override;
   uint32_t get_size(uint8_t queue_type, uint64_t address) override;
+  bool declines_prefetch(uint64_t address) override;
 
   uint32_t get_set(uint64_t address);
+  bool is_sampled_set(uint64_t address);
   uint32_t get_way(uint64_t address, uint32_t set);
 
   int invalidate_entry(uint64_t inval_addr);
+  bool back_invalidate(uint64_t inval_addr);
   int prefetch_line(uint64_t pf_addr, bool fill_this_level, uint32_t prefetch_metadata);
   int prefetch_line(uint64_t ip, uint64_t base_addr, uint64_t pf_addr, bool fill_this_level, uint32_t prefetch_metadata); // deprecated
 
+  // Cross-level prefetching. A prefetcher may issue a prefetch into any other cache, where it is treated as a prefetch of that
+  // cache; the address must be in the address space of that cache's prefetcher. It may also read the state of another cache's
+  // prefetching, and register to be told of the fills, evictions, and prefetch hits there.
+  prefetch_result prefetch_line_to(CACHE* target, uint64_t pf_addr, uint32_t prefetch_metadata);
+  CACHE* lower_cache() const;
+  prefetch_status get_prefetch_status();
+  void add_prefetch_listener(prefetch_listener listener);
+  void notify_prefetch_listeners(const prefetch_event& event);
+
   void add_mshr(PACKET* packet);
+  prefetch_result issue_prefetch(uint64_t pf_addr, bool fill_this_level, uint32_t prefetch_metadata);
   void va_translate_prefetches();
 
   void handle_fill();
   void handle_writeback();
   void handle_read();
   void handle_prefetch();
+  void handle_unsampled();
 
   void readlike_hit(std::size_t set, std::size_t way, PACKET& handle_pkt);
   bool readlike_miss(PACKET& handle_pkt);
   bool filllike_miss(std::size_t set, std::size_t way, PACKET& handle_pkt);
+  bool unsampled_access(PACKET& handle_pkt);
+  bool huge_page_hit(PACKET& handle_pkt);
+  void huge_page_fill(PACKET& handle_pkt);
 
   bool should_activate_prefetcher(int type);
 
+  // the physical address for a virtual address held by this translation cache, without disturbing its state
+  std::optional<uint64_t> probe_translation(uint64_t vaddr);
+
+  // drops the base page translations of the huge page region holding vaddr from this translation cache, and points the
+  // translations of that region that are still being filled at its new huge page frame
+  void shootdown(uint64_t vaddr, uint64_t huge_frame);
+
   void print_deadlock() override;
 
 #include "cache_modules.inc"
 
   const repl_t repl_type;
   const pref_t pref_type;
+  const inclusion_t inclusion_policy;
+
+  // per-instance storage owned by the replacement and prefetcher modules
+  champsim::module_state repl_state, pref_state;
+
+  // detailed profiling, allocated only when enabled in the configuration
+  std::unique_ptr<champsim::cache_profiler> profiler;
+
+  // a log of the requests reaching the tag array, for replay, allocated only when enabled in the configuration
+  std::unique_ptr<champsim::access_recorder> recorder;
+
+  // feedback-directed limits on the prefetcher, allocated only when enabled in the configuration
+  std::unique_ptr<champsim::prefetch_throttle> throttle;
 
   // constructor
   CACHE(std::string v1, double freq_scale, unsigned fill_level, uint32_t v2, int v3, uint32_t v5, uint32_t v6, uint32_t v7, uint32_t v8, uint32_t hit_lat,
         uint32_t fill_lat, uint32_t max_read, uint32_t max_write, std::size_t offset_bits, bool pref_load, bool wq_full_addr, bool va_pref,
-        unsigned pref_act_mask, MemoryRequestConsumer* ll, pref_t pref, repl_t repl)
-      : champsim::operable(freq_scale), MemoryRequestConsumer(fill_level), MemoryRequestProducer(ll), NAME(v1), NUM_SET(v2), NUM_WAY(v3), WQ_SIZE(v5),
-        RQ_SIZE(v6), PQ_SIZE(v7), MSHR_SIZE(v8), HIT_LATENCY(hit_lat), FILL_LATENCY(fill_lat), OFFSET_BITS(offset_bits), MAX_READ(max_read),
+        unsigned pref_act_mask, MemoryRequestConsumer* ll, pref_t pref, repl_t repl, uint32_t set_sample_rate, uint32_t unsampled_lat,
+        inclusion_t inclusion, bool profile, bool record, bool pref_throttle, uint32_t huge_sets, uint32_t huge_ways, CACHE* va_translator,
+        uint32_t va_translate_lat, uint32_t va_translate_width)
+      : champsim::operable(freq_scale), MemoryRequestConsumer(fill_level), MemoryRequestProducer(ll), NAME(v1), NUM_SET(v2 / set_sample_rate), NUM_WAY(v3),
+        WQ_SIZE(v5), RQ_SIZE(v6), PQ_SIZE(v7), MSHR_SIZE(v8), HIT_LATENCY(hit_lat), FILL_LATENCY(fill_lat), OFFSET_BITS(offset_bits),
+        SET_SAMPLE_RATE(set_sample_rate), UNSAMPLED_LATENCY(unsampled_lat), HUGE_SET(huge_sets), HUGE_WAY(huge_ways), MAX_READ(max_read),
         MAX_WRITE(max_write), prefetch_as_load(pref_load), match_offset_bits(wq_full_addr), virtual_prefetch(va_pref), pref_activate_mask(pref_act_mask),
-        repl_type(repl), pref_type(pref)
+        VAPQ{PQ_SIZE, va_translate_lat}, va_translator(va_translator), VA_TRANSLATE_WIDTH(va_translate_width), repl_type(repl), pref_type(pref),
+        inclusion_policy(inclusion)
   {
+    if (profile)
+      profiler = std::make_unique<champsim::cache_profiler>(NUM_SET, NUM_WAY);
+
+    if (record)
+      recorder = std::make_unique<champsim::access_recorder>(NAME + ".access.bin", NAME, NUM_SET, NUM_WAY, OFFSET_BITS, virtual_prefetch);
+
+    // epochs last for as many fills as half the blocks in the cache
+    if (pref_throttle)
+      throttle = std::make_unique<champsim::prefetch_throttle>(NUM_SET * NUM_WAY / 2);
   }
 };
 
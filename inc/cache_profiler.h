@@ -0,0 +1,90 @@
+#ifndef CACHE_PROFILER_H
+#define CACHE_PROFILER_H
+
+#include <array>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace champsim
+{
+
+/*
+ * Count-min sketch: a fixed-size frequency estimator that never underestimates.
+ */
+class count_min_sketch
+{
+public:
+  static constexpr std::size_t DEPTH = 4;
+  static constexpr std::size_t LOG2_WIDTH = 10;
+
+  void increment(uint64_t key);
+  uint64_t estimate(uint64_t key) const;
+  void clear();
+
+private:
+  std::array<std::array<uint64_t, 1ull << LOG2_WIDTH>, DEPTH> counters = {};
+
+  static std::size_t index(std::size_t row, uint64_t key);
+};
+
+/*
+ * Space-saving heavy-hitter tracker (Metwally et al., ICDT 2005). Keeps the CAPACITY most frequent keys, each with an upper bound
+ * on how much its count may be overestimated.
+ */
+class space_saving
+{
+public:
+  static constexpr std::size_t CAPACITY = 32;
+
+  struct entry {
+    uint64_t key = 0, count = 0, error = 0;
+  };
+
+  void increment(uint64_t key);
+  std::vector<entry> top() const;
+  void clear();
+
+private:
+  std::array<entry, CAPACITY> entries = {};
+  std::size_t occupancy = 0;
+};
+
+/*
+ * Optional profiling for a CACHE. Collects per-set access, miss, and eviction counts, the most frequently missing PCs, and a
+ * histogram of per-set stack (reuse) distances measured on a sample of the sets. All structures are allocated up front.
+ */
+class cache_profiler
+{
+public:
+  // one set in every REUSE_SAMPLE_STRIDE is tracked for reuse distance, aiming for about this many sets
+  static constexpr std::size_t REUSE_SAMPLE_TARGET = 64;
+
+  // distances are tracked up to this multiple of the associativity
+  static constexpr std::size_t REUSE_DEPTH_FACTOR = 4;
+
+  cache_profiler(std::size_t sets, std::size_t ways);
+
+  void record_access(uint32_t set, uint64_t block_addr, uint64_t ip, uint8_t type, bool hit);
+  void record_eviction(uint32_t set);
+  void clear();
+
+  void dump(std::ostream& os, const std::string& name, uint32_t set_sample_rate) const;
+
+private:
+  const std::size_t NUM_SET, NUM_WAY, REUSE_SAMPLE_STRIDE, REUSE_DEPTH;
+
+  std::vector<uint64_t> set_access, set_miss, set_evict;
+
+  count_min_sketch miss_pc_counts;
+  space_saving miss_pc_top;
+
+  // per sampled set, block addresses ordered from most to least recently used
+  std::vector<std::vector<uint64_t>> reuse_stacks;
+  std::vector<uint64_t> reuse_hist; // the last bucket counts first touches and distances beyond REUSE_DEPTH
+};
+
+} // namespace champsim
+
+#endif
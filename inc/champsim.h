@@ -45,6 +45,9 @@ struct deadlock : public std::exception {
 struct deprecated_clock_cycle {
   uint64_t operator[](std::size_t cpu_idx);
 };
+
+// the memory controller local to each core
+constexpr std::array<uint32_t, NUM_CPUS> cpu_memory_node = CPU_MEMORY_NODE;
 } // namespace champsim
 
 extern champsim::deprecated_clock_cycle current_core_cycle;
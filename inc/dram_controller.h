@@ -1,12 +1,17 @@
 #ifndef DRAM_H
 #define DRAM_H
 
+#include <algorithm>
 #include <array>
 #include <cmath>
+#include <deque>
 #include <limits>
+#include <vector>
 
+#include "champsim.h"
 #include "champsim_constants.h"
 #include "memory_class.h"
+#include "module_state.h"
 #include "operable.h"
 #include "util.h"
 
@@ -22,25 +27,65 @@ constexpr int32_t ceil(float num)
 {
   return (static_cast<float>(static_cast<int32_t>(num)) == num) ? static_cast<int32_t>(num) : static_cast<int32_t>(num) + ((num > 0) ? 1 : 0);
 }
+
+constexpr uint64_t parity(uint64_t x)
+{
+  for (unsigned shift = 32; shift > 0; shift >>= 1)
+    x ^= x >> shift;
+  return x & 1;
+}
+
+// Extract a field of the DRAM address, then flip each of its bits by the parity of the address bits selected by the matching hash mask
+template <std::size_t N>
+constexpr uint32_t dram_field(uint64_t address, std::size_t shift, std::size_t bits, const std::array<uint64_t, N>& hash)
+{
+  uint64_t result = (address >> shift) & bitmask(bits);
+  for (std::size_t i = 0; i < N; ++i)
+    result ^= parity(address & hash[i]) << i;
+  return result;
+}
 } // namespace detail
 
+enum class dram_refresh_t { NONE, ALL_BANK, PER_BANK };
+
 struct BANK_REQUEST {
-  bool valid = false, row_buffer_hit = false;
+  bool valid = false, row_buffer_hit = false, is_write = false;
 
   std::size_t open_row = std::numeric_limits<uint32_t>::max();
 
   uint64_t event_cycle = 0;
 
+  // the earliest cycle at which the open row may be closed (tRAS, tWR), and the number of refreshes this bank has seen
+  uint64_t precharge_ready = 0, refreshes = 0;
+
   std::vector<PACKET>::iterator pkt;
 };
 
+// the most recent commands issued to a rank, for the constraints between banks
+struct DRAM_RANK_TIMING {
+  uint64_t last_activate = 0, last_column = 0, read_ready = 0;
+  std::size_t last_activate_group = 0, last_column_group = 0;
+
+  // the last four activations, for tFAW
+  std::array<uint64_t, 4> activate_window = {};
+};
+
 struct DRAM_CHANNEL {
   std::vector<PACKET> WQ{DRAM_WQ_SIZE};
   std::vector<PACKET> RQ{DRAM_RQ_SIZE};
 
+  // valid packets in each queue
+  std::size_t wq_occupancy = 0, rq_occupancy = 0;
+
+  // unscheduled packets, split by bank, each list ordered by event cycle and then by queue position
+  using pending_list = std::deque<std::vector<PACKET>::iterator>;
+  std::array<pending_list, DRAM_RANKS* DRAM_BANKS> wq_pending, rq_pending;
+
   std::array<BANK_REQUEST, DRAM_RANKS* DRAM_BANKS> bank_request = {};
   std::array<BANK_REQUEST, DRAM_RANKS* DRAM_BANKS>::iterator active_request = std::end(bank_request);
 
+  std::array<DRAM_RANK_TIMING, DRAM_RANKS> rank_timing = {};
+
   uint64_t dbus_cycle_available = 0, dbus_cycle_congested = 0, dbus_count_congested = 0;
 
   bool write_mode = false;
@@ -56,11 +101,42 @@ public:
   const static uint64_t tRCD = detail::ceil(1.0 * tRCD_DRAM_NANOSECONDS * DRAM_IO_FREQ / 1000);
   const static uint64_t tCAS = detail::ceil(1.0 * tCAS_DRAM_NANOSECONDS * DRAM_IO_FREQ / 1000);
   const static uint64_t DRAM_DBUS_TURN_AROUND_TIME = detail::ceil(1.0 * DBUS_TURN_AROUND_NANOSECONDS * DRAM_IO_FREQ / 1000);
+  const static uint64_t tRAS = detail::ceil(1.0 * tRAS_DRAM_NANOSECONDS * DRAM_IO_FREQ / 1000);
+  const static uint64_t tCCD_S = detail::ceil(1.0 * tCCD_S_DRAM_NANOSECONDS * DRAM_IO_FREQ / 1000);
+  const static uint64_t tCCD_L = detail::ceil(1.0 * tCCD_L_DRAM_NANOSECONDS * DRAM_IO_FREQ / 1000);
+  const static uint64_t tRRD_S = detail::ceil(1.0 * tRRD_S_DRAM_NANOSECONDS * DRAM_IO_FREQ / 1000);
+  const static uint64_t tRRD_L = detail::ceil(1.0 * tRRD_L_DRAM_NANOSECONDS * DRAM_IO_FREQ / 1000);
+  const static uint64_t tFAW = detail::ceil(1.0 * tFAW_DRAM_NANOSECONDS * DRAM_IO_FREQ / 1000);
+  const static uint64_t tWR = detail::ceil(1.0 * tWR_DRAM_NANOSECONDS * DRAM_IO_FREQ / 1000);
+  const static uint64_t tWTR = detail::ceil(1.0 * tWTR_DRAM_NANOSECONDS * DRAM_IO_FREQ / 1000);
+  const static uint64_t tREFI = detail::ceil(1.0 * tREFI_DRAM_NANOSECONDS * DRAM_IO_FREQ / 1000);
+  const static uint64_t tRFC = detail::ceil(1.0 * tRFC_DRAM_NANOSECONDS * DRAM_IO_FREQ / 1000);
   const static uint64_t DRAM_DBUS_RETURN_TIME = detail::ceil(1.0 * BLOCK_SIZE / DRAM_CHANNEL_WIDTH);
 
+  // Packets from cores on other nodes cross the interconnect before they reach the queues. The whole round trip is charged on
+  // arrival, and the link accepts one block every REMOTE_TRANSFER_TIME cycles.
+  const static uint64_t REMOTE_LATENCY = detail::ceil(1.0 * REMOTE_LATENCY_NANOSECONDS * DRAM_IO_FREQ / 1000);
+  const static uint64_t REMOTE_TRANSFER_TIME =
+      (REMOTE_BANDWIDTH_GBPS > 0) ? detail::ceil(1.0 * BLOCK_SIZE * DRAM_IO_FREQ / (1000 * std::max<double>(REMOTE_BANDWIDTH_GBPS, 1))) : 0;
+
+  // the index of this controller, whose node owns the MEMORY_NODE_SIZE bytes of physical memory starting at node * MEMORY_NODE_SIZE
+  const std::size_t node;
+  uint64_t remote_link_available = 0;
+  uint64_t REMOTE_ACCESS = 0;
+
   std::array<DRAM_CHANNEL, DRAM_CHANNELS> channels;
 
-  MEMORY_CONTROLLER(double freq_scale) : champsim::operable(freq_scale), MemoryRequestConsumer(std::numeric_limits<unsigned>::max()) {}
+#include "dram_controller_modules.inc"
+
+  const sched_t sched_type;
+
+  // per-instance storage owned by the scheduler module
+  champsim::module_state sched_state;
+
+  MEMORY_CONTROLLER(double freq_scale, sched_t sched, std::size_t node)
+      : champsim::operable(freq_scale), MemoryRequestConsumer(std::numeric_limits<unsigned>::max()), node(node), sched_type(sched)
+  {
+  }
 
   int add_rq(PACKET* packet) override;
   int add_wq(PACKET* packet) override;
@@ -71,11 +147,54 @@ public:
   uint32_t get_occupancy(uint8_t queue_type, uint64_t address) override;
   uint32_t get_size(uint8_t queue_type, uint64_t address) override;
 
-  uint32_t dram_get_channel(uint64_t address);
-  uint32_t dram_get_rank(uint64_t address);
-  uint32_t dram_get_bank(uint64_t address);
-  uint32_t dram_get_row(uint64_t address);
-  uint32_t dram_get_column(uint64_t address);
+  // The address mapping is generated from the configuration: each field is a slice of the address above the block offset, and
+  // the channel and bank may additionally be XORed with other address bits.
+  static constexpr std::array<uint64_t, lg2(DRAM_CHANNELS)> CHANNEL_HASH = DRAM_CHANNEL_HASH;
+  static constexpr std::array<uint64_t, lg2(DRAM_BANKS)> BANK_HASH = DRAM_BANK_HASH;
+
+  static constexpr uint32_t dram_get_channel(uint64_t address) { return detail::dram_field(address, DRAM_CHANNEL_SHIFT, lg2(DRAM_CHANNELS), CHANNEL_HASH); }
+  static constexpr uint32_t dram_get_rank(uint64_t address) { return (address >> DRAM_RANK_SHIFT) & bitmask(lg2(DRAM_RANKS)); }
+  static constexpr uint32_t dram_get_bank(uint64_t address) { return detail::dram_field(address, DRAM_BANK_SHIFT, lg2(DRAM_BANKS), BANK_HASH); }
+  static constexpr uint32_t dram_get_row(uint64_t address) { return (address >> DRAM_ROW_SHIFT) & bitmask(lg2(DRAM_ROWS)); }
+  static constexpr uint32_t dram_get_column(uint64_t address) { return (address >> DRAM_COLUMN_SHIFT) & bitmask(lg2(DRAM_COLUMNS)); }
+
+  // the order in which packets arrived: oldest first, then by position in the queue
+  static bool schedules_before(std::vector<PACKET>::iterator lhs, std::vector<PACKET>::iterator rhs);
+
+private:
+  void add_pending(DRAM_CHANNEL& channel, std::vector<PACKET>::iterator pkt, bool is_write);
+
+  // the cycle at which a packet from the given core reaches this controller
+  uint64_t arrival_cycle(uint32_t cpu);
+
+  // the cycle at which the data for a newly scheduled packet is ready to go on the bus
+  uint64_t issue_commands(DRAM_CHANNEL& channel, std::size_t bank_idx, bool row_buffer_hit, bool is_write);
+
+  // refreshes are modeled lazily, as windows during which a bank accepts no commands and after which its row is closed
+  static uint64_t refresh_offset(std::size_t bank_idx);
+  uint64_t refresh_count(uint64_t cycle, std::size_t bank_idx) const;
+  uint64_t after_refresh(uint64_t cycle, std::size_t bank_idx) const;
+};
+
+// Sends each packet to the memory controller whose node owns its physical address
+class MEMORY_ROUTER : public MemoryRequestConsumer
+{
+public:
+  std::array<MEMORY_CONTROLLER*, NUM_MEMORY_CONTROLLERS> controllers;
+
+  explicit MEMORY_ROUTER(std::array<MEMORY_CONTROLLER*, NUM_MEMORY_CONTROLLERS> controllers)
+      : MemoryRequestConsumer(std::numeric_limits<unsigned>::max()), controllers(controllers)
+  {
+  }
+
+  static constexpr std::size_t get_node(uint64_t address) { return std::min<uint64_t>(address / MEMORY_NODE_SIZE, NUM_MEMORY_CONTROLLERS - 1); }
+
+  int add_rq(PACKET* packet) override { return controllers[get_node(packet->address)]->add_rq(packet); }
+  int add_wq(PACKET* packet) override { return controllers[get_node(packet->address)]->add_wq(packet); }
+  int add_pq(PACKET* packet) override { return controllers[get_node(packet->address)]->add_pq(packet); }
+
+  uint32_t get_occupancy(uint8_t queue_type, uint64_t address) override { return controllers[get_node(address)]->get_occupancy(queue_type, address); }
+  uint32_t get_size(uint8_t queue_type, uint64_t address) override { return controllers[get_node(address)]->get_size(queue_type, address); }
 };
 
 #endif
@@ -11,7 +11,8 @@
 #define PREFETCH 2
 #define WRITEBACK 3
 #define TRANSLATION 4
-#define NUM_TYPES 5
+#define METADATA 5 // a prefetcher reading its own tables from memory, which is neither demand nor prefetch traffic
+#define NUM_TYPES 6
 
 // CACHE BLOCK
 class BLOCK
@@ -45,6 +46,9 @@ public:
   virtual uint32_t get_occupancy(uint8_t queue_type, uint64_t address) = 0;
   virtual uint32_t get_size(uint8_t queue_type, uint64_t address) = 0;
 
+  // whether a prefetch for this address would be declined here or below, and must not be issued
+  virtual bool declines_prefetch(uint64_t address) { return false; }
+
   explicit MemoryRequestConsumer(unsigned fill_level) : fill_level(fill_level) {}
 };
 
@@ -0,0 +1,41 @@
+#ifndef MODULE_STATE_H
+#define MODULE_STATE_H
+
+#include <memory>
+#include <utility>
+
+namespace champsim
+{
+
+/*
+ * Opaque per-instance storage for replacement, prefetcher, branch predictor, and BTB modules.
+ *
+ * Each CACHE and O3_CPU owns one of these per module slot. A module allocates its whole state
+ * as a single object in its initialize hook and retrieves a typed pointer to it in every other
+ * hook, so there is no lookup keyed on the owning instance on the hot path.
+ */
+class module_state
+{
+  using deleter_type = void (*)(void*);
+  std::unique_ptr<void, deleter_type> data{nullptr, [](void*) {}};
+
+public:
+  template <typename T, typename... Args>
+  T* emplace(Args&&... args)
+  {
+    data = std::unique_ptr<void, deleter_type>{new T(std::forward<Args>(args)...), [](void* p) { delete static_cast<T*>(p); }};
+    return get<T>();
+  }
+
+  template <typename T>
+  T* get() const
+  {
+    return static_cast<T*>(data.get());
+  }
+
+  bool has_value() const { return static_cast<bool>(data); }
+};
+
+} // namespace champsim
+
+#endif
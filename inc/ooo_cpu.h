@@ -2,6 +2,7 @@
 #define OOO_CPU_H
 
 #include <array>
+#include <deque>
 #include <functional>
 #include <queue>
 
@@ -10,6 +11,7 @@
 #include "delay_queue.hpp"
 #include "instruction.h"
 #include "memory_class.h"
+#include "module_state.h"
 #include "operable.h"
 
 using namespace std;
@@ -24,6 +26,16 @@ public:
   void return_data(PACKET* packet);
 };
 
+// the special registers that an instruction reads and writes, from which its branch type is inferred
+struct register_usage {
+  bool reads_sp = false, writes_sp = false, reads_flags = false, reads_ip = false, writes_ip = false, reads_other = false;
+};
+
+register_usage get_register_usage(const ooo_model_instr& instr);
+
+// set is_branch, branch_taken, and branch_type from the registers used, and clear the target unless the branch is taken
+void decode_branch(ooo_model_instr& instr, const register_usage& regs);
+
 // cpu
 class O3_CPU : public champsim::operable
 {
@@ -49,6 +61,13 @@ public:
 
   // reorder buffer, load/store queue, register file
   champsim::circular_buffer<ooo_model_instr> IFETCH_BUFFER;
+
+  // Fetch target queue. When FTQ_SIZE is nonzero, branch prediction runs up to FTQ_SIZE fetch targets ahead of fetch, and each
+  // predicted block is prefetched into the L1I as it enters the queue. A fetch target is a run of sequential instructions within
+  // one cache block, ended by a taken branch. Prediction stops at a mispredicted branch until it resolves.
+  const std::size_t FTQ_SIZE;
+  std::deque<ooo_model_instr> FTQ;
+  std::size_t ftq_targets = 0;
   champsim::delay_queue<ooo_model_instr> DISPATCH_BUFFER;
   champsim::delay_queue<ooo_model_instr> DECODE_BUFFER;
   champsim::circular_buffer<ooo_model_instr> ROB;
@@ -87,6 +106,9 @@ public:
 
   // functions
   void init_instruction(ooo_model_instr instr);
+  uint64_t get_predicted_target(const ooo_model_instr& instr);
+  void fetch_from_ftq();
+  static bool starts_fetch_target(const ooo_model_instr& prev, const ooo_model_instr& next);
   void check_dib();
   void translate_fetch();
   void fetch_instruction();
@@ -131,18 +153,21 @@ public:
   const btb_t btb_type;
   const ipref_t ipref_type;
 
+  // per-instance storage owned by the branch predictor, BTB, and instruction prefetcher modules
+  champsim::module_state bpred_state, btb_state, ipref_state;
+
   O3_CPU(uint32_t cpu, double freq_scale, std::size_t dib_set, std::size_t dib_way, std::size_t dib_window, std::size_t ifetch_buffer_size,
-         std::size_t decode_buffer_size, std::size_t dispatch_buffer_size, std::size_t rob_size, std::size_t lq_size, std::size_t sq_size, unsigned fetch_width,
-         unsigned decode_width, unsigned dispatch_width, unsigned schedule_width, unsigned execute_width, unsigned lq_width, unsigned sq_width,
-         unsigned retire_width, unsigned mispredict_penalty, unsigned decode_latency, unsigned dispatch_latency, unsigned schedule_latency,
+         std::size_t ftq_size, std::size_t decode_buffer_size, std::size_t dispatch_buffer_size, std::size_t rob_size, std::size_t lq_size, std::size_t sq_size,
+         unsigned fetch_width, unsigned decode_width, unsigned dispatch_width, unsigned schedule_width, unsigned execute_width, unsigned lq_width,
+         unsigned sq_width, unsigned retire_width, unsigned mispredict_penalty, unsigned decode_latency, unsigned dispatch_latency, unsigned schedule_latency,
          unsigned execute_latency, MemoryRequestConsumer* itlb, MemoryRequestConsumer* dtlb, MemoryRequestConsumer* l1i, MemoryRequestConsumer* l1d,
          bpred_t bpred_type, btb_t btb_type, ipref_t ipref_type)
       : champsim::operable(freq_scale), cpu(cpu), dib_set(dib_set), dib_way(dib_way), dib_window(dib_window), IFETCH_BUFFER(ifetch_buffer_size),
-        DISPATCH_BUFFER(dispatch_buffer_size, dispatch_latency), DECODE_BUFFER(decode_buffer_size, decode_latency), ROB(rob_size), LQ(lq_size), SQ(sq_size),
-        FETCH_WIDTH(fetch_width), DECODE_WIDTH(decode_width), DISPATCH_WIDTH(dispatch_width), SCHEDULER_SIZE(schedule_width), EXEC_WIDTH(execute_width),
-        LQ_WIDTH(lq_width), SQ_WIDTH(sq_width), RETIRE_WIDTH(retire_width), BRANCH_MISPREDICT_PENALTY(mispredict_penalty), SCHEDULING_LATENCY(schedule_latency),
-        EXEC_LATENCY(execute_latency), ITLB_bus(rob_size, itlb), DTLB_bus(rob_size, dtlb), L1I_bus(rob_size, l1i), L1D_bus(rob_size, l1d),
-        bpred_type(bpred_type), btb_type(btb_type), ipref_type(ipref_type)
+        FTQ_SIZE(ftq_size), DISPATCH_BUFFER(dispatch_buffer_size, dispatch_latency), DECODE_BUFFER(decode_buffer_size, decode_latency), ROB(rob_size),
+        LQ(lq_size), SQ(sq_size), FETCH_WIDTH(fetch_width), DECODE_WIDTH(decode_width), DISPATCH_WIDTH(dispatch_width), SCHEDULER_SIZE(schedule_width),
+        EXEC_WIDTH(execute_width), LQ_WIDTH(lq_width), SQ_WIDTH(sq_width), RETIRE_WIDTH(retire_width), BRANCH_MISPREDICT_PENALTY(mispredict_penalty),
+        SCHEDULING_LATENCY(schedule_latency), EXEC_LATENCY(execute_latency), ITLB_bus(rob_size, itlb), DTLB_bus(rob_size, dtlb), L1I_bus(rob_size, l1i),
+        L1D_bus(rob_size, l1d), bpred_type(bpred_type), btb_type(btb_type), ipref_type(ipref_type)
   {
   }
 };
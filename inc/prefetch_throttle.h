@@ -0,0 +1,91 @@
+#ifndef PREFETCH_THROTTLE_H
+#define PREFETCH_THROTTLE_H
+
+#include <array>
+#include <bitset>
+#include <cstdint>
+
+namespace champsim
+{
+
+/*
+ * Feedback-directed prefetch throttling, after Srinath et al., "Feedback Directed Prefetching," HPCA 2007.
+ *
+ * The throttle sits between a prefetcher module and CACHE::prefetch_line(). It enforces a prefetch degree (prefetches per
+ * triggering access) and distance (blocks away from the triggering access) taken from one of several aggressiveness levels.
+ * At the end of every epoch the level is raised or lowered from the measured accuracy, lateness, and cache pollution of the
+ * prefetches, and from the occupancy of the DRAM read queues.
+ */
+class prefetch_throttle
+{
+public:
+  struct level_t {
+    unsigned distance, degree;
+  };
+
+  static constexpr std::array<level_t, 5> LEVELS{{{4, 1}, {8, 1}, {16, 2}, {32, 4}, {64, 4}}};
+  static constexpr std::size_t INITIAL_LEVEL = 2;
+
+  static constexpr double ACCURACY_HIGH = 0.75, ACCURACY_LOW = 0.40, LATENESS_THRESHOLD = 0.01, POLLUTION_THRESHOLD = 0.005, BANDWIDTH_THRESHOLD = 0.75;
+
+  static constexpr std::size_t LOG2_POLLUTION_FILTER_SIZE = 12;
+
+  // the distance of a prefetch is measured from the nearest of this many recent triggering accesses, so that prefetches issued
+  // later, from cycle_operate, are held to the same limit as those issued on the access
+  static constexpr std::size_t TRIGGER_HISTORY = 16;
+
+  explicit prefetch_throttle(uint64_t epoch_length) : EPOCH_LENGTH(epoch_length) {}
+
+  // a prefetcher invocation begins on an access to trigger_block
+  void begin_trigger(uint64_t trigger_block);
+
+  // the prefetcher's cycle_operate hook begins; the degree applies per cycle there
+  void begin_cycle() { issued_this_trigger = 0; }
+
+  // A prefetch beyond the current distance is dropped, since it will not come any closer. One beyond the current degree is
+  // deferred, and may be retried on a later cycle.
+  enum class verdict { ISSUE, DEFER, DROP };
+  verdict allow(uint64_t pf_block);
+
+  // the occupancy of the DRAM read queue that an issued prefetch maps to, given its physical address
+  void sample_dram(uint32_t dram_occupancy, uint32_t dram_size)
+  {
+    epoch.dram_occupancy += dram_occupancy;
+    epoch.dram_size += dram_size;
+  }
+
+  void record_issue() { epoch.issued++; }
+  void record_useful() { epoch.useful++; }
+  void record_late() { epoch.late++; }
+  void record_fill(uint64_t fill_block, bool demand, bool prefetch, bool evicting, uint64_t evicted_block);
+
+  const level_t& current() const { return LEVELS[level]; }
+  std::size_t current_level() const { return level; }
+
+  uint64_t throttled = 0, epochs = 0;
+
+private:
+  const uint64_t EPOCH_LENGTH;
+  std::size_t level = INITIAL_LEVEL;
+
+  std::array<uint64_t, TRIGGER_HISTORY> triggers = {};
+  std::size_t num_triggers = 0, next_trigger = 0; // no distance limit applies before the first trigger
+  unsigned issued_this_trigger = 0;
+
+  struct counters {
+    uint64_t issued = 0, useful = 0, late = 0, demand_miss = 0, polluting = 0, dram_occupancy = 0, dram_size = 0;
+  };
+
+  counters epoch, history; // history decays by half every epoch
+  uint64_t fills = 0;
+
+  // blocks evicted by prefetches
+  std::bitset<1ull << LOG2_POLLUTION_FILTER_SIZE> pollution_filter;
+
+  static std::size_t filter_index(uint64_t block);
+  void end_epoch();
+};
+
+} // namespace champsim
+
+#endif
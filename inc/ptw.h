@@ -1,10 +1,12 @@
 #ifndef PTW_H
 #define PTW_H
 
-#include <list>
+#include <array>
 #include <map>
 #include <optional>
 #include <string>
+#include <tuple>
+#include <vector>
 
 #include "delay_queue.hpp"
 #include "memory_class.h"
@@ -19,12 +21,14 @@ class PagingStructureCache
     uint32_t lru = std::numeric_limits<uint32_t>::max() >> 1;
   };
 
+public:
   const std::string NAME;
   const uint32_t NUM_SET, NUM_WAY;
   std::vector<block_t> block{NUM_SET * NUM_WAY};
 
-public:
   const std::size_t level;
+  uint64_t ACCESS = 0, HIT = 0;
+
   PagingStructureCache(std::string v1, uint8_t v2, uint32_t v3, uint32_t v4) : NAME(v1), NUM_SET(v3), NUM_WAY(v4), level(v2) {}
 
   std::optional<uint64_t> check_hit(uint64_t address);
@@ -40,9 +44,21 @@ public:
 
   champsim::delay_queue<PACKET> RQ;
 
-  std::list<PACKET> MSHR;
+  // Walks in flight occupy a fixed slab. Those that are ready to continue, or are waiting out a page fault, are also kept in a
+  // min-heap on the cycle at which they become ready, so that a faulting walk does not hold up the walks behind it.
+  std::vector<PACKET> MSHR{MSHR_SIZE};
+  std::vector<std::tuple<uint64_t, uint64_t, std::size_t>> mshr_ready; // event cycle, order of scheduling, slab index
+  uint64_t mshr_order = 0;
+  std::size_t mshr_occupancy = 0;
 
-  uint64_t total_miss_latency = 0;
+  uint64_t total_miss_latency = 0, WALKS = 0;
+
+  // Translation prefetches from the TLBs arrive in the prefetch queue and are walked like demand misses. Those for pages that are
+  // not yet mapped are declined, since a prefetch may not take a page fault.
+  uint64_t PREFETCH_WALKS = 0, PREFETCH_DECLINED = 0;
+
+  // bucket i counts the walks that took [2^i, 2^(i+1)) cycles, and the last bucket counts all longer walks
+  std::array<uint64_t, 16> walk_latency_histogram = {};
 
   PagingStructureCache PSCL5, PSCL4, PSCL3, PSCL2;
 
@@ -55,7 +71,8 @@ public:
   // functions
   int add_rq(PACKET* packet) override;
   int add_wq(PACKET* packet) override { assert(0); }
-  int add_pq(PACKET* packet) override { assert(0); }
+  int add_pq(PACKET* packet) override;
+  bool declines_prefetch(uint64_t address) override;
 
   void return_data(PACKET* packet) override;
   void operate() override;
@@ -69,6 +86,9 @@ public:
   uint64_t get_shamt(uint8_t pt_level);
 
   void print_deadlock() override;
+
+private:
+  void schedule_mshr(std::size_t idx, uint64_t cycle);
 };
 
 #endif
@@ -1,35 +1,115 @@
 #ifndef VMEM_H
 #define VMEM_H
 
+#include <array>
 #include <cstdint>
-#include <deque>
-#include <map>
+#include <functional>
+#include <optional>
+#include <random>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include "champsim_constants.h"
 
 // reserve 1MB of space
 #define VMEM_RESERVE_CAPACITY 1048576
 
 #define PTE_BYTES 8
 
+// Hands out the frames of a range of physical memory in a random order. This is a Fisher-Yates shuffle performed one draw at a
+// time: only the positions that have been swapped are stored, so the cost is proportional to the number of frames drawn, and the
+// order depends only on the seed. Frames given back are handed out again first.
+class ppage_permutation
+{
+  uint64_t first, frame_size, count, drawn = 0;
+  std::mt19937_64 rng;
+  std::unordered_map<uint64_t, uint64_t> swapped;
+  std::vector<uint64_t> released;
+
+  uint64_t at(uint64_t idx) const;
+
+public:
+  ppage_permutation(uint64_t begin_addr, uint64_t end_addr, uint64_t seed, uint64_t frame_size = PAGE_SIZE);
+  uint64_t size() const { return count - drawn + std::size(released); }
+  bool empty() const { return size() == 0; }
+  bool contains(uint64_t addr) const { return addr >= first && addr - first < count * frame_size; }
+  uint64_t next();
+  void release(uint64_t addr);
+};
+
 class VirtualMemory
 {
 private:
-  std::map<std::pair<uint32_t, uint64_t>, uint64_t> vpage_to_ppage_map;
-  std::map<std::tuple<uint32_t, uint64_t, uint32_t>, uint64_t> page_table;
+  struct key_hash {
+    std::size_t operator()(const std::pair<uint32_t, uint64_t>& key) const { return std::hash<uint64_t>{}(key.second * 0x9e3779b97f4a7c15ull ^ key.first); }
+    std::size_t operator()(const std::tuple<uint32_t, uint64_t, uint32_t>& key) const
+    {
+      return (*this)({std::get<0>(key), (std::get<1>(key) << 3) + std::get<2>(key)}); // the level fits in three bits
+    }
+  };
+
+  std::unordered_map<std::pair<uint32_t, uint64_t>, uint64_t, key_hash> vpage_to_ppage_map;
+  std::unordered_map<std::tuple<uint32_t, uint64_t, uint32_t>, uint64_t, key_hash> page_table;
+
+  // huge page mappings, and the number of base pages touched in each region that may yet be promoted
+  std::unordered_map<std::pair<uint32_t, uint64_t>, uint64_t, key_hash> huge_page_map;
+  std::unordered_map<std::pair<uint32_t, uint64_t>, uint32_t, key_hash> region_touches;
 
   uint64_t next_pte_page;
+  std::size_t next_interleave_node = 0;
+
+  std::size_t home_node(uint32_t cpu_num);
+  std::optional<uint64_t> allocate_huge_frame(uint32_t cpu_num);
+  bool backed_by_huge_page(uint32_t cpu_num, uint64_t region) const;
 
 public:
+  // how physical pages are spread across the memory controllers: round-robin, on the node of the core that first touches the
+  // page, or on a fixed node for each core
+  enum class placement_t { INTERLEAVE, FIRST_TOUCH, AFFINITY };
+
+  // which regions of HUGE_PAGE_SIZE bytes are mapped with a single huge page: none, a fixed fraction of them chosen at random, or
+  // those in which a number of base pages have been touched (as transparent huge pages are promoted)
+  enum class huge_page_t { NONE, FRACTION, PROMOTE };
+
   const uint64_t minor_fault_penalty;
   const uint32_t pt_levels;
   const uint32_t page_size; // Size of a PTE page
-  std::deque<uint64_t> ppage_free_list;
+  const placement_t placement;
+  const std::vector<uint32_t> affinity;
+  const huge_page_t huge_pages;
+  const double huge_page_fraction;
+  const uint32_t promotion_threshold;
+
+  // the page table level that holds the leaf entries of huge pages
+  const uint32_t huge_page_level;
+
+  // free physical pages and huge page frames, one permutation of each for each memory controller
+  std::vector<ppage_permutation> ppage_free_list, huge_frame_free_list;
+
+  uint64_t huge_pages_mapped = 0, promotions = 0;
+
+  // called with the core, virtual address, and huge page frame of each promoted region, so that the translation caches can drop the
+  // translations of its base pages
+  using shootdown_listener = std::function<void(uint32_t cpu_num, uint64_t vaddr, uint64_t frame)>;
+  std::vector<shootdown_listener> shootdown_listeners;
 
   // capacity and pg_size are measured in bytes, and capacity must be a multiple
   // of pg_size
-  VirtualMemory(uint64_t capacity, uint64_t pg_size, uint32_t page_table_levels, uint64_t random_seed, uint64_t minor_fault_penalty);
+  VirtualMemory(uint64_t capacity, uint64_t pg_size, uint32_t page_table_levels, uint64_t random_seed, uint64_t minor_fault_penalty,
+                placement_t placement, std::vector<uint32_t> affinity, huge_page_t huge_pages, double huge_page_fraction, uint32_t promotion_threshold);
+  std::size_t available_ppages() const;
+  uint64_t allocate_ppage(uint32_t cpu_num);
+
+  // the level of the page table at which the walk for this address ends: 0 for base pages, or huge_page_level
+  uint32_t page_level(uint32_t cpu_num, uint64_t vaddr) const;
+
   uint64_t shamt(uint32_t level) const;
   uint64_t get_offset(uint64_t vaddr, uint32_t level) const;
   std::pair<uint64_t, bool> va_to_pa(uint32_t cpu_num, uint64_t vaddr);
+
+  // whether a translation for this address exists yet, without creating one
+  bool is_mapped(uint32_t cpu_num, uint64_t vaddr) const;
   std::pair<uint64_t, bool> get_pte_pa(uint32_t cpu_num, uint64_t vaddr, uint32_t level);
 };
 
@@ -0,0 +1,333 @@
+/*
+ * A spatial footprint prefetcher, after Bakhshalipour et al., "Bingo Spatial
+ * Data Prefetcher," HPCA 2019, which extends Spatial Memory Streaming
+ * (Somogyi et al., ISCA 2006).
+ *
+ * Memory is divided into regions of BINGO_REGION_LOG2 bytes. The first access
+ * to a region (the trigger) starts a generation, and the blocks accessed until
+ * one of them is evicted from the cache form its footprint.
+ *
+ * - The filter table holds regions accessed only once so far, so that regions
+ *   with no spatial pattern do not occupy the accumulation table.
+ * - The accumulation table records the footprint of the regions accessed more
+ *   than once. When a generation ends, its footprint is stored in the pattern
+ *   history table.
+ * - The pattern history table is indexed by the trigger PC and offset, and
+ *   tagged with both that (short) event and the trigger PC and address (long)
+ *   event. A trigger that matches a long event prefetches its footprint; one
+ *   that matches only short events prefetches the blocks that at least
+ *   BINGO_VOTE_PERCENT of them include.
+ *
+ * The predicted footprint of each trigger is queued and issued in bulk from
+ * prefetcher_cycle_operate, nearest blocks first, filling this level while
+ * fewer than half of the MSHRs are in use.
+ *
+ * The table sizes are set at compile time with BINGO_PHT_ENTRIES,
+ * BINGO_AT_ENTRIES and BINGO_FT_ENTRIES, for example by adding
+ * -DBINGO_PHT_ENTRIES=8192 to the CXXFLAGS of the configuration. Footprints are
+ * bitmaps, and each table is kept as structure-of-arrays, so a lookup compares
+ * a contiguous array of tags.
+ */
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <type_traits>
+
+#include "cache.h"
+#include "util.h"
+
+#ifndef BINGO_REGION_LOG2
+#define BINGO_REGION_LOG2 11
+#endif
+
+#ifndef BINGO_PHT_ENTRIES
+#define BINGO_PHT_ENTRIES 4096
+#endif
+
+#ifndef BINGO_PHT_WAYS
+#define BINGO_PHT_WAYS 16
+#endif
+
+#ifndef BINGO_AT_ENTRIES
+#define BINGO_AT_ENTRIES 64
+#endif
+
+#ifndef BINGO_FT_ENTRIES
+#define BINGO_FT_ENTRIES 64
+#endif
+
+#ifndef BINGO_VOTE_PERCENT
+#define BINGO_VOTE_PERCENT 20
+#endif
+
+namespace
+{
+constexpr unsigned REGION_LOG2 = BINGO_REGION_LOG2;
+constexpr unsigned REGION_BLOCKS = 1u << (REGION_LOG2 - LOG2_BLOCK_SIZE);
+static_assert(REGION_LOG2 > LOG2_BLOCK_SIZE && REGION_BLOCKS <= 64 && REGION_LOG2 <= LOG2_PAGE_SIZE,
+              "BINGO_REGION_LOG2 must give 2 to 64 blocks per region, within a page");
+
+constexpr std::size_t PHT_WAYS = BINGO_PHT_WAYS;
+constexpr std::size_t PHT_SETS = BINGO_PHT_ENTRIES / PHT_WAYS;
+static_assert(PHT_SETS > 0 && (PHT_SETS & (PHT_SETS - 1)) == 0, "BINGO_PHT_ENTRIES / BINGO_PHT_WAYS must be a power of two");
+static_assert(BINGO_AT_ENTRIES > 0 && BINGO_FT_ENTRIES > 0);
+
+// queued footprints waiting to be issued
+constexpr std::size_t PENDING_SIZE = 16;
+
+using footprint_t = std::conditional_t<(REGION_BLOCKS <= 32), uint32_t, uint64_t>;
+constexpr footprint_t REGION_MASK = ~footprint_t{0} >> (8 * sizeof(footprint_t) - REGION_BLOCKS);
+
+uint64_t mix(uint64_t key)
+{
+  // the finalizer of MurmurHash3
+  key ^= key >> 33;
+  key *= 0xff51afd7ed558ccdull;
+  key ^= key >> 33;
+  key *= 0xc4ceb9fe1a85ec53ull;
+  key ^= key >> 33;
+  return key;
+}
+
+// where a trigger's pattern lives in the pattern history table
+struct trigger_event {
+  uint32_t set = 0;
+  uint16_t short_tag = 0, long_tag = 0;
+
+  trigger_event() = default;
+  trigger_event(uint64_t ip, uint64_t block, unsigned offset)
+  {
+    uint64_t short_hash = mix((ip << 6) | offset);
+    set = short_hash & (PHT_SETS - 1);
+    short_tag = short_hash >> 48;
+    long_tag = mix(ip ^ (block << 20)) >> 48;
+  }
+};
+
+// a small fully associative table of regions with LRU replacement
+template <std::size_t SIZE>
+struct region_table {
+  std::array<uint64_t, SIZE> regions = {}; // region number + 1, or 0 if invalid
+  std::array<footprint_t, SIZE> footprints = {};
+  std::array<trigger_event, SIZE> triggers = {};
+  std::array<uint8_t, SIZE> trigger_offsets = {};
+  std::array<uint64_t, SIZE> last_used = {};
+  uint64_t access_count = 0;
+
+  // the index of the entry for this region, or SIZE if there is none
+  std::size_t find(uint64_t region) const
+  {
+    std::size_t idx = SIZE;
+    for (std::size_t i = 0; i < SIZE; i++)
+      idx = (regions[i] == region + 1) ? i : idx;
+    return idx;
+  }
+
+  std::size_t victim() const { return std::distance(std::begin(last_used), std::min_element(std::begin(last_used), std::end(last_used))); }
+
+  void touch(std::size_t idx) { last_used[idx] = ++access_count; }
+  bool valid(std::size_t idx) const { return regions[idx] != 0; }
+
+  void set(std::size_t idx, uint64_t region, footprint_t footprint, trigger_event trigger, unsigned offset)
+  {
+    regions[idx] = region + 1;
+    footprints[idx] = footprint;
+    triggers[idx] = trigger;
+    trigger_offsets[idx] = offset;
+    touch(idx);
+  }
+};
+
+struct pending_footprint {
+  uint64_t region_base;
+  footprint_t footprint; // rotated so that bit 0 is the trigger block
+  unsigned trigger_offset;
+};
+
+struct bingo_state {
+  region_table<BINGO_FT_ENTRIES> filter;
+  region_table<BINGO_AT_ENTRIES> accumulation;
+
+  std::array<footprint_t, PHT_SETS * PHT_WAYS> pht_footprints = {};
+  std::array<uint16_t, PHT_SETS * PHT_WAYS> pht_short_tags = {}, pht_long_tags = {};
+  std::array<uint8_t, PHT_SETS * PHT_WAYS> pht_age = {};
+
+  std::deque<pending_footprint> pending;
+
+  uint64_t triggers = 0, long_matches = 0, short_matches = 0, patterns_stored = 0, blocks_predicted = 0, pending_dropped = 0;
+
+  void pht_touch(std::size_t idx)
+  {
+    auto begin = idx - (idx % PHT_WAYS);
+    for (std::size_t i = begin; i < begin + PHT_WAYS; i++)
+      pht_age[i] += (pht_age[i] < pht_age[idx]);
+    pht_age[idx] = 0;
+  }
+
+  footprint_t pht_lookup(trigger_event ev)
+  {
+    auto begin = ev.set * PHT_WAYS;
+    std::array<unsigned, REGION_BLOCKS> votes = {};
+    unsigned matches = 0;
+    for (std::size_t i = begin; i < begin + PHT_WAYS; i++) {
+      if (pht_footprints[i] == 0 || pht_short_tags[i] != ev.short_tag)
+        continue;
+
+      if (pht_long_tags[i] == ev.long_tag) {
+        long_matches++;
+        pht_touch(i);
+        return pht_footprints[i];
+      }
+
+      matches++;
+      for (unsigned b = 0; b < REGION_BLOCKS; b++)
+        votes[b] += (pht_footprints[i] >> b) & 1;
+    }
+
+    if (matches == 0)
+      return 0;
+
+    short_matches++;
+    footprint_t result = 0;
+    for (unsigned b = 0; b < REGION_BLOCKS; b++)
+      result |= static_cast<footprint_t>(100 * votes[b] >= BINGO_VOTE_PERCENT * matches) << b;
+    return result;
+  }
+
+  void pht_insert(trigger_event ev, footprint_t footprint)
+  {
+    patterns_stored++;
+    auto begin = ev.set * PHT_WAYS;
+    auto victim = begin;
+    for (std::size_t i = begin; i < begin + PHT_WAYS; i++) {
+      if (pht_short_tags[i] == ev.short_tag && pht_long_tags[i] == ev.long_tag) {
+        victim = i;
+        break;
+      }
+      if (pht_age[i] > pht_age[victim])
+        victim = i;
+    }
+
+    pht_footprints[victim] = footprint;
+    pht_short_tags[victim] = ev.short_tag;
+    pht_long_tags[victim] = ev.long_tag;
+    pht_age[victim] = PHT_WAYS;
+    pht_touch(victim);
+  }
+
+  // the generation of an accumulating region has ended
+  void end_generation(std::size_t idx)
+  {
+    pht_insert(accumulation.triggers[idx], accumulation.footprints[idx]);
+    accumulation.regions[idx] = 0;
+  }
+};
+
+footprint_t rotate_right(footprint_t x, unsigned n)
+{
+  n %= REGION_BLOCKS;
+  return ((x >> n) | (n ? x << (REGION_BLOCKS - n) : 0)) & REGION_MASK;
+}
+} // namespace
+
+void CACHE::prefetcher_initialize()
+{
+  auto& st = *pref_state.emplace<bingo_state>();
+
+  std::size_t table_bytes = sizeof(st.filter) + sizeof(st.accumulation) + sizeof(st.pht_footprints) + sizeof(st.pht_short_tags) + sizeof(st.pht_long_tags)
+                            + sizeof(st.pht_age);
+  std::cout << NAME << " Bingo spatial prefetcher region: " << (1u << REGION_LOG2) << " bytes PHT: " << PHT_SETS * PHT_WAYS
+            << " entries AT: " << BINGO_AT_ENTRIES << " FT: " << BINGO_FT_ENTRIES << " tables: " << table_bytes / 1024.0 << " KB" << std::endl;
+}
+
+uint32_t CACHE::prefetcher_cache_operate(uint64_t addr, uint64_t ip, uint8_t cache_hit, uint8_t type, uint32_t metadata_in)
+{
+  auto& st = *pref_state.get<bingo_state>();
+  uint64_t region = addr >> REGION_LOG2;
+  unsigned offset = (addr >> LOG2_BLOCK_SIZE) & (REGION_BLOCKS - 1);
+
+  // an accumulating region adds the block to its footprint
+  if (auto idx = st.accumulation.find(region); idx != BINGO_AT_ENTRIES) {
+    st.accumulation.footprints[idx] |= footprint_t{1} << offset;
+    st.accumulation.touch(idx);
+    return metadata_in;
+  }
+
+  // a second block in a filtered region moves it to the accumulation table
+  if (auto idx = st.filter.find(region); idx != BINGO_FT_ENTRIES) {
+    if (offset != st.filter.trigger_offsets[idx]) {
+      auto at_idx = st.accumulation.victim();
+      if (st.accumulation.valid(at_idx))
+        st.end_generation(at_idx);
+
+      footprint_t footprint = (footprint_t{1} << offset) | (footprint_t{1} << st.filter.trigger_offsets[idx]);
+      st.accumulation.set(at_idx, region, footprint, st.filter.triggers[idx], st.filter.trigger_offsets[idx]);
+      st.filter.regions[idx] = 0;
+    }
+    return metadata_in;
+  }
+
+  // otherwise, this is a trigger access that starts a new generation
+  st.triggers++;
+  trigger_event ev{ip, addr >> LOG2_BLOCK_SIZE, offset};
+  st.filter.set(st.filter.victim(), region, 0, ev, offset);
+
+  footprint_t prediction = st.pht_lookup(ev) & ~(footprint_t{1} << offset);
+  if (prediction != 0) {
+    st.blocks_predicted += __builtin_popcountll(prediction);
+    if (std::size(st.pending) == PENDING_SIZE) {
+      st.pending.pop_front();
+      st.pending_dropped++;
+    }
+    st.pending.push_back({region << REGION_LOG2, rotate_right(prediction, offset), offset});
+  }
+
+  return metadata_in;
+}
+
+uint32_t CACHE::prefetcher_cache_fill(uint64_t addr, uint32_t set, uint32_t way, uint8_t prefetch, uint64_t evicted_addr, uint32_t metadata_in)
+{
+  auto& st = *pref_state.get<bingo_state>();
+  uint64_t evicted_region = evicted_addr >> REGION_LOG2;
+
+  // evicting a block of an active region ends its generation
+  if (auto idx = st.accumulation.find(evicted_region); idx != BINGO_AT_ENTRIES)
+    st.end_generation(idx);
+  else if (auto ft_idx = st.filter.find(evicted_region); ft_idx != BINGO_FT_ENTRIES)
+    st.filter.regions[ft_idx] = 0;
+
+  return metadata_in;
+}
+
+void CACHE::prefetcher_cycle_operate()
+{
+  auto& st = *pref_state.get<bingo_state>();
+
+  while (!std::empty(st.pending)) {
+    auto& [region_base, footprint, trigger_offset] = st.pending.front();
+    while (footprint != 0) {
+      unsigned distance = __builtin_ctzll(footprint);
+      uint64_t pf_addr = region_base + ((trigger_offset + distance) % REGION_BLOCKS) * BLOCK_SIZE;
+
+      // wait for room in the prefetch queue rather than retrying every cycle
+      if (!virtual_prefetch && get_occupancy(3, pf_addr) == get_size(3, pf_addr))
+        return;
+      if (!prefetch_line(pf_addr, (get_occupancy(0, pf_addr) < get_size(0, pf_addr) / 2), 0))
+        return;
+
+      footprint &= footprint - 1;
+    }
+    st.pending.pop_front();
+  }
+}
+
+void CACHE::prefetcher_final_stats()
+{
+  auto& st = *pref_state.get<bingo_state>();
+  std::cout << NAME << " BINGO TRIGGERS: " << st.triggers << " LONG MATCHES: " << st.long_matches << " SHORT MATCHES: " << st.short_matches
+            << " PATTERNS STORED: " << st.patterns_stored << std::endl;
+  std::cout << NAME << " BINGO BLOCKS PREDICTED: " << st.blocks_predicted << " FOOTPRINTS DROPPED: " << st.pending_dropped << std::endl;
+}
@@ -1,11 +1,12 @@
 #include <algorithm>
 #include <array>
-#include <map>
 
 #include "cache.h"
 
 constexpr int PREFETCH_DEGREE = 3;
 
+namespace
+{
 struct tracker_entry {
   uint64_t ip = 0;              // the IP we're tracking
   uint64_t last_cl_addr = 0;    // the last address accessed by this IP
@@ -21,15 +22,25 @@ struct lookahead_entry {
 
 constexpr std::size_t TRACKER_SETS = 256;
 constexpr std::size_t TRACKER_WAYS = 4;
-std::map<CACHE*, lookahead_entry> lookahead;
-std::map<CACHE*, std::array<tracker_entry, TRACKER_SETS * TRACKER_WAYS>> trackers;
 
-void CACHE::prefetcher_initialize() { std::cout << NAME << " IP-based stride prefetcher" << std::endl; }
+struct ip_stride_state {
+  lookahead_entry lookahead;
+  std::array<tracker_entry, TRACKER_SETS * TRACKER_WAYS> trackers;
+};
+} // namespace
+
+void CACHE::prefetcher_initialize()
+{
+  std::cout << NAME << " IP-based stride prefetcher" << std::endl;
+  pref_state.emplace<ip_stride_state>();
+}
 
 void CACHE::prefetcher_cycle_operate()
 {
+  auto& lookahead = pref_state.get<ip_stride_state>()->lookahead;
+
   // If a lookahead is active
-  if (auto [old_pf_address, stride, degree] = lookahead[this]; degree > 0) {
+  if (auto [old_pf_address, stride, degree] = lookahead; degree > 0) {
     auto pf_address = old_pf_address + (stride << LOG2_BLOCK_SIZE);
 
     // If the next step would exceed the degree or run off the page, stop
@@ -38,21 +49,22 @@ void CACHE::prefetcher_cycle_operate()
       // level or not
       bool success = prefetch_line(0, 0, pf_address, (get_occupancy(0, pf_address) < get_size(0, pf_address) / 2), 0);
       if (success)
-        lookahead[this] = {pf_address, stride, degree - 1};
+        lookahead = {pf_address, stride, degree - 1};
       // If we fail, try again next cycle
     } else {
-      lookahead[this] = {};
+      lookahead = {};
     }
   }
 }
 
 uint32_t CACHE::prefetcher_cache_operate(uint64_t addr, uint64_t ip, uint8_t cache_hit, uint8_t type, uint32_t metadata_in)
 {
+  auto& [lookahead, trackers] = *pref_state.get<ip_stride_state>();
   uint64_t cl_addr = addr >> LOG2_BLOCK_SIZE;
   int64_t stride = 0;
 
   // get boundaries of tracking set
-  auto set_begin = std::next(std::begin(trackers[this]), ip % TRACKER_SETS);
+  auto set_begin = std::next(std::begin(trackers), ip % TRACKER_SETS);
   auto set_end = std::next(set_begin, TRACKER_WAYS);
 
   // find the current ip within the set
@@ -67,7 +79,7 @@ uint32_t CACHE::prefetcher_cache_operate(uint64_t addr, uint64_t ip, uint8_t cac
     // Initialize prefetch state unless we somehow saw the same address twice in
     // a row or if this is the first time we've seen this stride
     if (stride != 0 && stride == found->last_stride)
-      lookahead[this] = {cl_addr, stride, PREFETCH_DEGREE};
+      lookahead = {cl_addr, stride, PREFETCH_DEGREE};
   } else {
     // replace by LRU
     found = std::min_element(set_begin, set_end, [](tracker_entry x, tracker_entry y) { return x.last_used_cycle < y.last_used_cycle; });
@@ -0,0 +1,167 @@
+#include <algorithm>
+#include <array>
+#include <iostream>
+
+#include "cache.h"
+
+/*
+ * An IP-stride prefetcher for the L1D that shares its stream with the cache below it. The nearest blocks of a confirmed
+ * stride are prefetched into this cache, and the blocks beyond them directly into the lower cache, while its prefetch queue
+ * is less than half full. The far prefetches are followed by listening for prefetch hits and unused evictions in the lower
+ * cache, and their degree is raised or lowered every epoch based on their accuracy there.
+ */
+#ifndef COORD_NEAR_DEGREE
+#define COORD_NEAR_DEGREE 2
+#endif
+
+#ifndef COORD_FAR_DEGREE_MAX
+#define COORD_FAR_DEGREE_MAX 8
+#endif
+
+#ifndef COORD_EPOCH
+#define COORD_EPOCH 256 // far prefetches resolved per epoch
+#endif
+
+namespace
+{
+struct tracker_entry {
+  uint64_t ip = 0;              // the IP we're tracking
+  uint64_t last_cl_addr = 0;    // the last address accessed by this IP
+  int64_t last_stride = 0;      // the stride between the last two addresses accessed by this IP
+  uint64_t last_used_cycle = 0; // use LRU to evict old IP trackers
+};
+
+constexpr std::size_t TRACKER_SETS = 256;
+constexpr std::size_t TRACKER_WAYS = 4;
+constexpr std::size_t FAR_ENTRIES = 1024;
+
+struct ip_stride_coord_state {
+  std::array<tracker_entry, TRACKER_SETS * TRACKER_WAYS> trackers;
+
+  CACHE* lower = nullptr; // the cache that receives the far prefetches, if any
+  int far_degree = COORD_FAR_DEGREE_MAX / 2;
+
+  // the blocks of the outstanding far prefetches, direct-mapped, with zero as empty
+  std::array<uint64_t, FAR_ENTRIES> far_blocks = {};
+  uint64_t epoch_useful = 0, epoch_useless = 0;
+  uint64_t far_issued = 0, far_useful = 0, far_useless = 0;
+
+  void resolve(uint64_t block, bool useful)
+  {
+    auto& slot = far_blocks[block % FAR_ENTRIES];
+    if (slot != block + 1)
+      return;
+    slot = 0;
+
+    if (useful) {
+      far_useful++;
+      epoch_useful++;
+    } else {
+      far_useless++;
+      epoch_useless++;
+    }
+
+    if (epoch_useful + epoch_useless == COORD_EPOCH) {
+      if (4 * epoch_useful >= 3 * COORD_EPOCH)
+        far_degree = std::min(far_degree + 1, COORD_FAR_DEGREE_MAX);
+      else if (5 * epoch_useful < 2 * COORD_EPOCH)
+        far_degree = std::max(far_degree - 1, 1);
+      epoch_useful = epoch_useless = 0;
+    }
+  }
+};
+} // namespace
+
+void CACHE::prefetcher_initialize()
+{
+  auto& st = *pref_state.emplace<ip_stride_coord_state>();
+
+  // far prefetches are only issued to a cache that prefetches in the same address space as this one
+  CACHE* lower = lower_cache();
+  if (lower != nullptr && lower->virtual_prefetch == virtual_prefetch) {
+    st.lower = lower;
+    lower->add_prefetch_listener([&st, lower](const CACHE::prefetch_event& event) {
+      uint64_t block = (lower->virtual_prefetch ? event.v_address : event.address) >> LOG2_BLOCK_SIZE;
+      if (event.kind == CACHE::prefetch_event::kind_t::PREFETCH_HIT)
+        st.resolve(block, true);
+      else if (event.kind == CACHE::prefetch_event::kind_t::EVICT && event.prefetch)
+        st.resolve(block, false);
+    });
+  }
+
+  std::cout << NAME << " coordinated IP-based stride prefetcher near degree: " << COORD_NEAR_DEGREE << " far degree: up to " << COORD_FAR_DEGREE_MAX
+            << " into " << (st.lower != nullptr ? st.lower->NAME : "none") << std::endl;
+}
+
+uint32_t CACHE::prefetcher_cache_operate(uint64_t addr, uint64_t ip, uint8_t cache_hit, uint8_t type, uint32_t metadata_in)
+{
+  auto& st = *pref_state.get<ip_stride_coord_state>();
+  uint64_t cl_addr = addr >> LOG2_BLOCK_SIZE;
+  int64_t stride = 0;
+
+  // get boundaries of tracking set
+  auto set_begin = std::next(std::begin(st.trackers), ip % TRACKER_SETS);
+  auto set_end = std::next(set_begin, TRACKER_WAYS);
+
+  // find the current ip within the set
+  auto found = std::find_if(set_begin, set_end, [ip](tracker_entry x) { return x.ip == ip; });
+
+  bool confirmed = false;
+  if (found != set_end) {
+    stride = (int64_t)cl_addr - (int64_t)found->last_cl_addr;
+    confirmed = (stride != 0 && stride == found->last_stride);
+  } else {
+    // replace by LRU
+    found = std::min_element(set_begin, set_end, [](tracker_entry x, tracker_entry y) { return x.last_used_cycle < y.last_used_cycle; });
+  }
+
+  // update tracking set
+  *found = {ip, cl_addr, stride, current_cycle};
+
+  if (!confirmed)
+    return metadata_in;
+
+  int far_degree = (st.lower != nullptr) ? st.far_degree : 0;
+  for (int i = 1; i <= COORD_NEAR_DEGREE + far_degree; i++) {
+    uint64_t pf_address = (cl_addr + i * stride) << LOG2_BLOCK_SIZE;
+
+    // stop at the end of the page
+    if (!virtual_prefetch && (pf_address >> LOG2_PAGE_SIZE) != (addr >> LOG2_PAGE_SIZE))
+      break;
+
+    if (i <= COORD_NEAR_DEGREE) {
+      prefetch_line(pf_address, true, 0);
+    } else {
+      // leave the lower cache room for its own prefetcher and for the misses of this one
+      auto status = st.lower->get_prefetch_status();
+      if (2 * status.pq_occupancy >= status.pq_size)
+        break;
+
+      if (prefetch_line_to(st.lower, pf_address, 0) == CACHE::prefetch_result::ENQUEUED) {
+        st.far_blocks[(pf_address >> LOG2_BLOCK_SIZE) % FAR_ENTRIES] = (pf_address >> LOG2_BLOCK_SIZE) + 1;
+        st.far_issued++;
+      }
+    }
+  }
+
+  return metadata_in;
+}
+
+uint32_t CACHE::prefetcher_cache_fill(uint64_t addr, uint32_t set, uint32_t way, uint8_t prefetch, uint64_t evicted_addr, uint32_t metadata_in)
+{
+  return metadata_in;
+}
+
+void CACHE::prefetcher_cycle_operate() {}
+
+void CACHE::prefetcher_final_stats()
+{
+  auto& st = *pref_state.get<ip_stride_coord_state>();
+  if (st.lower == nullptr)
+    return;
+
+  auto status = st.lower->get_prefetch_status();
+  std::cout << NAME << " far prefetches into " << st.lower->NAME << " issued: " << st.far_issued << " useful: " << st.far_useful
+            << " useless: " << st.far_useless << " far degree: " << st.far_degree << std::endl;
+  std::cout << st.lower->NAME << " prefetch accuracy, including its own prefetcher: " << status.accuracy << std::endl;
+}
@@ -0,0 +1,81 @@
+#ifndef KPCP_H
+#define KPCP_H
+
+#include <array>
+#include <cstdint>
+
+//#define L2_PF_DEBUG_PRINT
+#ifdef L2_PF_DEBUG_PRINT
+#define L2_PF_DEBUG(x) x
+#else
+#define L2_PF_DEBUG(x)
+#endif
+
+#define L2_GHR_ON
+
+// Signature table parameters, indexed by the page number modulo a prime
+#define L2_ST_SET 64
+#define L2_ST_WAY 4
+#define L2_ST_PRIME 61
+#define L2_ST_TAG_MASK 0xFFFF
+
+// Signatures are built from 7-bit sign-magnitude deltas
+#define SIG_LENGTH 12
+#define SIG_SHIFT 3
+#define SIG_MASK ((1 << SIG_LENGTH) - 1)
+
+// Pattern table parameters, indexed by the signature modulo a prime
+#define L2_PT_SET 512
+#define L2_PT_WAY 4
+#define L2_PT_PRIME 509
+#define CSIG_MAX 15
+#define CDELTA_MAX 15
+
+// Global history register, which carries a path across a page boundary
+#define L2_GHR_TRACK 8
+
+/*
+ * Each table is kept as structure-of-arrays, with each field as narrow as the
+ * hardware it models. The blocks of a page that were prefetched, and those that
+ * were used, are 64-bit bitmaps in its signature table entry.
+ */
+namespace kpcp
+{
+static_assert(L2_ST_PRIME <= L2_ST_SET && L2_PT_PRIME <= L2_PT_SET);
+static_assert(L2_ST_WAY <= 32 && L2_GHR_TRACK <= 8, "ways are searched with a 32-bit mask, and GHR entries with an 8-bit mask");
+static_assert(SIG_LENGTH <= 16 && CSIG_MAX < 256 && CDELTA_MAX < 256);
+
+struct SIGNATURE_TABLE {
+  std::array<uint32_t, L2_ST_SET> valid = {}, first_hit = {}; // bitmaps of the ways of each set
+  std::array<uint16_t, L2_ST_SET * L2_ST_WAY> tag = {}, signature = {};
+  std::array<uint8_t, L2_ST_SET * L2_ST_WAY> last_block = {}, lru = {};
+  std::array<uint64_t, L2_ST_SET * L2_ST_WAY> l2_pf = {}, used = {}; // bitmaps of the blocks of the page
+
+  SIGNATURE_TABLE();
+
+  // the index of the valid entry for this tag, or -1 if there is none
+  int find(uint32_t set, uint32_t tag) const;
+};
+
+struct PATTERN_TABLE {
+  std::array<int8_t, L2_PT_SET * L2_PT_WAY> delta = {};
+  std::array<uint8_t, L2_PT_SET * L2_PT_WAY> c_delta = {};
+  std::array<uint8_t, L2_PT_SET> c_sig = {};
+};
+
+struct GLOBAL_HISTORY_REGISTER {
+  std::array<uint16_t, L2_GHR_TRACK> signature = {};
+  std::array<uint8_t, L2_GHR_TRACK> path_conf = {}, last_block = {}, lru = {};
+  std::array<int8_t, L2_GHR_TRACK> oop_delta = {};
+
+  GLOBAL_HISTORY_REGISTER();
+};
+
+class PF_buffer
+{
+public:
+  int delta = 0, signature = 0, conf = 0, depth = 0;
+};
+} // namespace kpcp
+
+#endif
@@ -1,42 +1,76 @@
 #include "spp_dev.h"
 
+#include <algorithm>
+#include <iostream>
+
 #include "cache.h"
 
-SIGNATURE_TABLE ST;
-PATTERN_TABLE PT;
-PREFETCH_FILTER FILTER;
-GLOBAL_REGISTER GHR;
+using namespace spp;
+
+namespace
+{
+bool test_bit(const uint64_t* bits, std::size_t i) { return (bits[i / 64] >> (i % 64)) & 1; }
+void assign_bit(uint64_t* bits, std::size_t i, bool value) { bits[i / 64] = (bits[i / 64] & ~(1ull << (i % 64))) | (static_cast<uint64_t>(value) << (i % 64)); }
+
+// the first of ST_WAY entries with this value, or ST_WAY if there is none, as a reduction the compiler vectorizes
+template <typename T>
+uint32_t first_match(const std::array<T, ST_WAY>& values, uint32_t value)
+{
+  uint32_t match = ST_WAY;
+  for (uint32_t i = 0; i < ST_WAY; i++)
+    match = std::min(match, (values[i] == value) ? i : ST_WAY);
+  return match;
+}
+
+// the first of ST_WAY entries whose bit is clear, or ST_WAY if there is none
+uint32_t first_clear(const std::array<uint64_t, ST_WAY / 64>& bits)
+{
+  for (std::size_t chunk = 0; chunk < ST_WAY / 64; chunk++)
+    if (~bits[chunk])
+      return chunk * 64 + __builtin_ctzll(~bits[chunk]);
+  return ST_WAY;
+}
+} // namespace
 
-void CACHE::prefetcher_initialize() {}
+void CACHE::prefetcher_initialize()
+{
+  auto& st = *pref_state.emplace<spp_state>();
+  st.delta_q.resize(MSHR_SIZE);
+  st.confidence_q.resize(MSHR_SIZE);
+
+  std::size_t table_bits = ST_SET * ST_WAY * (1 + ST_TAG_BIT + SIG_BIT + LOG2_PAGE_SIZE - LOG2_BLOCK_SIZE + lg2(ST_WAY))
+                           + PT_SET * (PT_WAY * (SIG_DELTA_BIT + C_DELTA_BIT) + C_SIG_BIT) + FILTER_SET * (2 + REMAINDER_BIT);
+  std::cout << NAME << " Signature Path Prefetcher ST: " << ST_SET * ST_WAY << " entries PT: " << PT_SET * PT_WAY << " entries filter: " << FILTER_SET
+            << " entries modeled storage: " << table_bits / 8192.0 << " KB" << std::endl;
+}
 
 void CACHE::prefetcher_cycle_operate() {}
 
 uint32_t CACHE::prefetcher_cache_operate(uint64_t addr, uint64_t ip, uint8_t cache_hit, uint8_t type, uint32_t metadata_in)
 {
+  auto& [ST, PT, FILTER, GHR, delta_q, confidence_q] = *pref_state.get<spp_state>();
   uint64_t page = addr >> LOG2_PAGE_SIZE;
-  uint32_t page_offset = (addr >> LOG2_BLOCK_SIZE) & (PAGE_SIZE / BLOCK_SIZE - 1), last_sig = 0, curr_sig = 0, confidence_q[MSHR_SIZE], depth = 0;
+  uint32_t page_offset = (addr >> LOG2_BLOCK_SIZE) & (PAGE_SIZE / BLOCK_SIZE - 1), last_sig = 0, curr_sig = 0, depth = 0;
 
-  int32_t delta = 0, delta_q[MSHR_SIZE];
+  int32_t delta = 0;
 
-  for (uint32_t i = 0; i < MSHR_SIZE; i++) {
-    confidence_q[i] = 0;
-    delta_q[i] = 0;
-  }
+  std::fill(std::begin(confidence_q), std::end(confidence_q), 0);
+  std::fill(std::begin(delta_q), std::end(delta_q), 0);
   confidence_q[0] = 100;
   GHR.global_accuracy = GHR.pf_issued ? ((100 * GHR.pf_useful) / GHR.pf_issued) : 0;
 
-  SPP_DP(cout << endl
-              << "[ChampSim] " << __func__ << " addr: " << hex << addr << " cache_line: " << (addr >> LOG2_BLOCK_SIZE);
-         cout << " page: " << page << " page_offset: " << dec << page_offset << endl;);
+  SPP_DP(std::cout << std::endl
+                   << "[ChampSim] " << __func__ << " addr: " << std::hex << addr << " cache_line: " << (addr >> LOG2_BLOCK_SIZE);
+         std::cout << " page: " << page << " page_offset: " << std::dec << page_offset << std::endl;);
 
   // Stage 1: Read and update a sig stored in ST
   // last_sig and delta are used to update (sig, delta) correlation in PT
   // curr_sig is used to read prefetch candidates in PT
-  ST.read_and_update_sig(page, page_offset, last_sig, curr_sig, delta);
+  ST.read_and_update_sig(page, page_offset, last_sig, curr_sig, delta, GHR);
 
   // Also check the prefetch filter in parallel to update global accuracy
   // counters
-  FILTER.check(addr, L2C_DEMAND);
+  FILTER.check(addr, L2C_DEMAND, GHR);
 
   // Stage 2: Update delta patterns stored in PT
   if (last_sig)
@@ -51,7 +85,7 @@ uint32_t CACHE::prefetcher_cache_operate(uint64_t addr, uint64_t ip, uint8_t cac
   do {
 #endif
     uint32_t lookahead_way = PT_WAY;
-    PT.read_pattern(curr_sig, delta_q, confidence_q, lookahead_way, lookahead_conf, pf_q_tail, depth);
+    PT.read_pattern(curr_sig, delta_q, confidence_q, lookahead_way, lookahead_conf, pf_q_tail, depth, GHR);
 
     do_lookahead = 0;
     for (uint32_t i = pf_q_head; i < pf_q_tail; i++) {
@@ -59,10 +93,8 @@ uint32_t CACHE::prefetcher_cache_operate(uint64_t addr, uint64_t ip, uint8_t cac
         uint64_t pf_addr = (base_addr & ~(BLOCK_SIZE - 1)) + (delta_q[i] << LOG2_BLOCK_SIZE);
 
         if ((addr & ~(PAGE_SIZE - 1)) == (pf_addr & ~(PAGE_SIZE - 1))) { // Prefetch request is in the same physical page
-          if (FILTER.check(pf_addr, ((confidence_q[i] >= FILL_THRESHOLD) ? SPP_L2C_PREFETCH : SPP_LLC_PREFETCH))) {
-            prefetch_line(ip, addr, pf_addr, (confidence_q[i] >= FILL_THRESHOLD),
-                          0); // Use addr (not base_addr) to obey the same
-                              // physical page boundary
+          if (FILTER.check(pf_addr, ((confidence_q[i] >= FILL_THRESHOLD) ? SPP_L2C_PREFETCH : SPP_LLC_PREFETCH), GHR)) {
+            prefetch_line(pf_addr, (confidence_q[i] >= FILL_THRESHOLD), 0); // Use addr (not base_addr) to obey the same physical page boundary
 
             if (confidence_q[i] >= FILL_THRESHOLD) {
               GHR.pf_issued++;
@@ -70,13 +102,13 @@ uint32_t CACHE::prefetcher_cache_operate(uint64_t addr, uint64_t ip, uint8_t cac
                 GHR.pf_issued >>= 1;
                 GHR.pf_useful >>= 1;
               }
-              SPP_DP(cout << "[ChampSim] SPP L2 prefetch issued GHR.pf_issued: " << GHR.pf_issued << " GHR.pf_useful: " << GHR.pf_useful << endl;);
+              SPP_DP(std::cout << "[ChampSim] SPP L2 prefetch issued GHR.pf_issued: " << GHR.pf_issued << " GHR.pf_useful: " << GHR.pf_useful << std::endl;);
             }
 
-            SPP_DP(cout << "[ChampSim] " << __func__ << " base_addr: " << hex << base_addr << " pf_addr: " << pf_addr;
-                   cout << " pf_cache_line: " << (pf_addr >> LOG2_BLOCK_SIZE);
-                   cout << " prefetch_delta: " << dec << delta_q[i] << " confidence: " << confidence_q[i];
-                   cout << " depth: " << i << " fill_level: " << ((confidence_q[i] >= FILL_THRESHOLD) ? FILL_L2 : FILL_LLC) << endl;);
+            SPP_DP(std::cout << "[ChampSim] " << __func__ << " base_addr: " << std::hex << base_addr << " pf_addr: " << pf_addr;
+                   std::cout << " pf_cache_line: " << (pf_addr >> LOG2_BLOCK_SIZE);
+                   std::cout << " prefetch_delta: " << std::dec << delta_q[i] << " confidence: " << confidence_q[i];
+                   std::cout << " depth: " << i << " fill_level: " << ((confidence_q[i] >= FILL_THRESHOLD) ? FILL_L2 : FILL_LLC) << std::endl;);
           }
         } else { // Prefetch request is crossing the physical page boundary
 #ifdef GHR_ON
@@ -95,18 +127,11 @@ uint32_t CACHE::prefetcher_cache_operate(uint64_t addr, uint64_t ip, uint8_t cac
     if (lookahead_way < PT_WAY) {
       uint32_t set = get_hash(curr_sig) % PT_SET;
       base_addr += (PT.delta[set][lookahead_way] << LOG2_BLOCK_SIZE);
-
-      // PT.delta uses a 7-bit sign magnitude representation to generate
-      // sig_delta
-      // int sig_delta = (PT.delta[set][lookahead_way] < 0) ? ((((-1) *
-      // PT.delta[set][lookahead_way]) & 0x3F) + 0x40) :
-      // PT.delta[set][lookahead_way];
-      int sig_delta = (PT.delta[set][lookahead_way] < 0) ? (((-1) * PT.delta[set][lookahead_way]) + (1 << (SIG_DELTA_BIT - 1))) : PT.delta[set][lookahead_way];
-      curr_sig = ((curr_sig << SIG_SHIFT) ^ sig_delta) & SIG_MASK;
+      curr_sig = ((curr_sig << SIG_SHIFT) ^ sig_delta(PT.delta[set][lookahead_way])) & SIG_MASK;
     }
 
-    SPP_DP(cout << "Looping curr_sig: " << hex << curr_sig << " base_addr: " << base_addr << dec;
-           cout << " pf_q_head: " << pf_q_head << " pf_q_tail: " << pf_q_tail << " depth: " << depth << endl;);
+    SPP_DP(std::cout << "Looping curr_sig: " << std::hex << curr_sig << " base_addr: " << base_addr << std::dec;
+           std::cout << " pf_q_head: " << pf_q_head << " pf_q_tail: " << pf_q_tail << " depth: " << depth << std::endl;);
 #ifdef LOOKAHEAD_ON
   } while (do_lookahead);
 #endif
@@ -117,8 +142,9 @@ uint32_t CACHE::prefetcher_cache_operate(uint64_t addr, uint64_t ip, uint8_t cac
 uint32_t CACHE::prefetcher_cache_fill(uint64_t addr, uint32_t set, uint32_t match, uint8_t prefetch, uint64_t evicted_addr, uint32_t metadata_in)
 {
 #ifdef FILTER_ON
-  SPP_DP(cout << endl;);
-  FILTER.check(evicted_addr, L2C_EVICT);
+  auto& st = *pref_state.get<spp_state>();
+  SPP_DP(std::cout << std::endl;);
+  st.FILTER.check(evicted_addr, L2C_EVICT, st.GHR);
 #endif
 
   return metadata_in;
@@ -127,7 +153,7 @@ uint32_t CACHE::prefetcher_cache_fill(uint64_t addr, uint32_t set, uint32_t matc
 void CACHE::prefetcher_final_stats() {}
 
 // TODO: Find a good 64-bit hash function
-uint64_t get_hash(uint64_t key)
+uint64_t spp::get_hash(uint64_t key)
 {
   // Robert Jenkins' 32 bit mix function
   key += (key << 12);
@@ -145,79 +171,81 @@ uint64_t get_hash(uint64_t key)
   return key;
 }
 
-void SIGNATURE_TABLE::read_and_update_sig(uint64_t page, uint32_t page_offset, uint32_t& last_sig, uint32_t& curr_sig, int32_t& delta)
+SIGNATURE_TABLE::SIGNATURE_TABLE()
+{
+  for (auto& set_lru : lru)
+    for (uint32_t way = 0; way < ST_WAY; way++)
+      set_lru[way] = way;
+}
+
+void SIGNATURE_TABLE::read_and_update_sig(uint64_t page, uint32_t page_offset, uint32_t& last_sig, uint32_t& curr_sig, int32_t& delta,
+                                          const GLOBAL_REGISTER& GHR)
 {
   uint32_t set = get_hash(page) % ST_SET, match = ST_WAY, partial_page = page & ST_TAG_MASK;
   uint8_t ST_hit = 0;
-  int sig_delta = 0;
 
-  SPP_DP(cout << "[ST] " << __func__ << " page: " << hex << page << " partial_page: " << partial_page << dec << endl;);
+  SPP_DP(std::cout << "[ST] " << __func__ << " page: " << std::hex << page << " partial_page: " << partial_page << std::dec << std::endl;);
 
   // Case 1: Hit
-  for (match = 0; match < ST_WAY; match++) {
-    if (valid[set][match] && (tag[set][match] == partial_page)) {
-      last_sig = sig[set][match];
-      delta = page_offset - last_offset[set][match];
-
-      if (delta) {
-        // Build a new sig based on 7-bit sign magnitude representation of delta
-        // sig_delta = (delta < 0) ? ((((-1) * delta) & 0x3F) + 0x40) : delta;
-        sig_delta = (delta < 0) ? (((-1) * delta) + (1 << (SIG_DELTA_BIT - 1))) : delta;
-        sig[set][match] = ((last_sig << SIG_SHIFT) ^ sig_delta) & SIG_MASK;
-        curr_sig = sig[set][match];
-        last_offset[set][match] = page_offset;
-
-        SPP_DP(cout << "[ST] " << __func__ << " hit set: " << set << " way: " << match;
-               cout << " valid: " << valid[set][match] << " tag: " << hex << tag[set][match]; cout << " last_sig: " << last_sig << " curr_sig: " << curr_sig;
-               cout << " delta: " << dec << delta << " last_offset: " << page_offset << endl;);
-      } else
-        last_sig = 0; // Hitting the same cache line, delta is zero
-
-      ST_hit = 1;
-      break;
-    }
+  // Ways are filled in order and never invalidated, so the valid ways are a prefix of the set and the first matching way is valid if any is
+  match = first_match(tag[set], partial_page);
+  if (match < ST_WAY && !test_bit(valid[set].data(), match))
+    match = ST_WAY;
+  if (match < ST_WAY) {
+    last_sig = sig[set][match];
+    delta = page_offset - last_offset[set][match];
+
+    if (delta) {
+      // Build a new sig based on 7-bit sign magnitude representation of delta
+      sig[set][match] = ((last_sig << SIG_SHIFT) ^ sig_delta(delta)) & SIG_MASK;
+      curr_sig = sig[set][match];
+      last_offset[set][match] = page_offset;
+
+      SPP_DP(std::cout << "[ST] " << __func__ << " hit set: " << set << " way: " << match;
+             std::cout << " valid: " << test_bit(valid[set].data(), match) << " tag: " << std::hex << tag[set][match];
+             std::cout << " last_sig: " << last_sig << " curr_sig: " << curr_sig;
+             std::cout << " delta: " << std::dec << delta << " last_offset: " << page_offset << std::endl;);
+    } else
+      last_sig = 0; // Hitting the same cache line, delta is zero
+
+    ST_hit = 1;
   }
 
   // Case 2: Invalid
   if (match == ST_WAY) {
-    for (match = 0; match < ST_WAY; match++) {
-      if (valid[set][match] == 0) {
-        valid[set][match] = 1;
-        tag[set][match] = partial_page;
-        sig[set][match] = 0;
-        curr_sig = sig[set][match];
-        last_offset[set][match] = page_offset;
-
-        SPP_DP(cout << "[ST] " << __func__ << " invalid set: " << set << " way: " << match;
-               cout << " valid: " << valid[set][match] << " tag: " << hex << partial_page;
-               cout << " sig: " << sig[set][match] << " last_offset: " << dec << page_offset << endl;);
-
-        break;
-      }
+    match = first_clear(valid[set]);
+    if (match < ST_WAY) {
+      assign_bit(valid[set].data(), match, true);
+      tag[set][match] = partial_page;
+      sig[set][match] = 0;
+      curr_sig = sig[set][match];
+      last_offset[set][match] = page_offset;
+
+      SPP_DP(std::cout << "[ST] " << __func__ << " invalid set: " << set << " way: " << match;
+             std::cout << " valid: " << test_bit(valid[set].data(), match) << " tag: " << std::hex << partial_page;
+             std::cout << " sig: " << sig[set][match] << " last_offset: " << std::dec << page_offset << std::endl;);
     }
   }
 
   // Case 3: Miss
   if (match == ST_WAY) {
-    for (match = 0; match < ST_WAY; match++) {
-      if (lru[set][match] == ST_WAY - 1) { // Find replacement victim
-        tag[set][match] = partial_page;
-        sig[set][match] = 0;
-        curr_sig = sig[set][match];
-        last_offset[set][match] = page_offset;
-
-        SPP_DP(cout << "[ST] " << __func__ << " miss set: " << set << " way: " << match;
-               cout << " valid: " << valid[set][match] << " victim tag: " << hex << tag[set][match] << " new tag: " << partial_page;
-               cout << " sig: " << sig[set][match] << " last_offset: " << dec << page_offset << endl;);
-
-        break;
-      }
+    // Find replacement victim
+    match = first_match(lru[set], ST_WAY - 1);
+    if (match < ST_WAY) {
+      tag[set][match] = partial_page;
+      sig[set][match] = 0;
+      curr_sig = sig[set][match];
+      last_offset[set][match] = page_offset;
+
+      SPP_DP(std::cout << "[ST] " << __func__ << " miss set: " << set << " way: " << match;
+             std::cout << " valid: " << test_bit(valid[set].data(), match) << " victim tag: " << std::hex << tag[set][match] << " new tag: " << partial_page;
+             std::cout << " sig: " << sig[set][match] << " last_offset: " << std::dec << page_offset << std::endl;);
     }
 
 #ifdef SPP_SANITY_CHECK
     // Assertion
     if (match == ST_WAY) {
-      cout << "[ST] Cannot find a replacement victim!" << endl;
+      std::cout << "[ST] Cannot find a replacement victim!" << std::endl;
       assert(0);
     }
 #endif
@@ -227,27 +255,16 @@ void SIGNATURE_TABLE::read_and_update_sig(uint64_t page, uint32_t page_offset, u
   if (ST_hit == 0) {
     uint32_t GHR_found = GHR.check_entry(page_offset);
     if (GHR_found < MAX_GHR_ENTRY) {
-      sig_delta = (GHR.delta[GHR_found] < 0) ? (((-1) * GHR.delta[GHR_found]) + (1 << (SIG_DELTA_BIT - 1))) : GHR.delta[GHR_found];
-      sig[set][match] = ((GHR.sig[GHR_found] << SIG_SHIFT) ^ sig_delta) & SIG_MASK;
+      sig[set][match] = ((GHR.sig[GHR_found] << SIG_SHIFT) ^ sig_delta(GHR.delta[GHR_found])) & SIG_MASK;
       curr_sig = sig[set][match];
     }
   }
 #endif
 
   // Update LRU
-  for (uint32_t way = 0; way < ST_WAY; way++) {
-    if (lru[set][way] < lru[set][match]) {
-      lru[set][way]++;
-
-#ifdef SPP_SANITY_CHECK
-      // Assertion
-      if (lru[set][way] >= ST_WAY) {
-        cout << "[ST] LRU value is wrong! set: " << set << " way: " << way << " lru: " << lru[set][way] << endl;
-        assert(0);
-      }
-#endif
-    }
-  }
+  uint8_t position = lru[set][match];
+  for (uint32_t way = 0; way < ST_WAY; way++)
+    lru[set][way] += (lru[set][way] < position);
   lru[set][match] = 0; // Promote to the MRU position
 }
 
@@ -267,8 +284,8 @@ void PATTERN_TABLE::update_pattern(uint32_t last_sig, int curr_delta)
         c_sig[set] >>= 1;
       }
 
-      SPP_DP(cout << "[PT] " << __func__ << " hit sig: " << hex << last_sig << dec << " set: " << set << " way: " << match;
-             cout << " delta: " << delta[set][match] << " c_delta: " << c_delta[set][match] << " c_sig: " << c_sig[set] << endl;);
+      SPP_DP(std::cout << "[PT] " << __func__ << " hit sig: " << std::hex << last_sig << std::dec << " set: " << set << " way: " << match;
+             std::cout << " delta: " << +delta[set][match] << " c_delta: " << +c_delta[set][match] << " c_sig: " << +c_sig[set] << std::endl;);
 
       break;
     }
@@ -285,6 +302,14 @@ void PATTERN_TABLE::update_pattern(uint32_t last_sig, int curr_delta)
       }
     }
 
+#ifdef SPP_SANITY_CHECK
+    // Assertion
+    if (victim_way == PT_WAY) {
+      std::cout << "[PT] Cannot find a replacement victim!" << std::endl;
+      assert(0);
+    }
+#endif
+
     delta[set][victim_way] = curr_delta;
     c_delta[set][victim_way] = 0;
     c_sig[set]++;
@@ -294,21 +319,13 @@ void PATTERN_TABLE::update_pattern(uint32_t last_sig, int curr_delta)
       c_sig[set] >>= 1;
     }
 
-    SPP_DP(cout << "[PT] " << __func__ << " miss sig: " << hex << last_sig << dec << " set: " << set << " way: " << victim_way;
-           cout << " delta: " << delta[set][victim_way] << " c_delta: " << c_delta[set][victim_way] << " c_sig: " << c_sig[set] << endl;);
-
-#ifdef SPP_SANITY_CHECK
-    // Assertion
-    if (victim_way == PT_WAY) {
-      cout << "[PT] Cannot find a replacement victim!" << endl;
-      assert(0);
-    }
-#endif
+    SPP_DP(std::cout << "[PT] " << __func__ << " miss sig: " << std::hex << last_sig << std::dec << " set: " << set << " way: " << victim_way;
+           std::cout << " delta: " << +delta[set][victim_way] << " c_delta: " << +c_delta[set][victim_way] << " c_sig: " << +c_sig[set] << std::endl;);
   }
 }
 
-void PATTERN_TABLE::read_pattern(uint32_t curr_sig, int* delta_q, uint32_t* confidence_q, uint32_t& lookahead_way, uint32_t& lookahead_conf,
-                                 uint32_t& pf_q_tail, uint32_t& depth)
+void PATTERN_TABLE::read_pattern(uint32_t curr_sig, std::vector<int>& delta_q, std::vector<uint32_t>& confidence_q, uint32_t& lookahead_way,
+                                 uint32_t& lookahead_conf, uint32_t& pf_q_tail, uint32_t& depth, const GLOBAL_REGISTER& GHR) const
 {
   // Update (sig, delta) correlation
   uint32_t set = get_hash(curr_sig) % PT_SET, local_conf = 0, pf_conf = 0, max_conf = 0;
@@ -318,7 +335,8 @@ void PATTERN_TABLE::read_pattern(uint32_t curr_sig, int* delta_q, uint32_t* conf
       local_conf = (100 * c_delta[set][way]) / c_sig[set];
       pf_conf = depth ? (GHR.global_accuracy * c_delta[set][way] / c_sig[set] * lookahead_conf / 100) : local_conf;
 
-      if (pf_conf >= PF_THRESHOLD) {
+      // The queue holds one candidate per MSHR
+      if (pf_conf >= PF_THRESHOLD && pf_q_tail < std::size(confidence_q)) {
         confidence_q[pf_q_tail] = pf_conf;
         delta_q[pf_q_tail] = delta[set][way];
 
@@ -329,54 +347,58 @@ void PATTERN_TABLE::read_pattern(uint32_t curr_sig, int* delta_q, uint32_t* conf
         }
         pf_q_tail++;
 
-        SPP_DP(cout << "[PT] " << __func__ << " HIGH CONF: " << pf_conf << " sig: " << hex << curr_sig << dec << " set: " << set << " way: " << way;
-               cout << " delta: " << delta[set][way] << " c_delta: " << c_delta[set][way] << " c_sig: " << c_sig[set];
-               cout << " conf: " << local_conf << " depth: " << depth << endl;);
+        SPP_DP(std::cout << "[PT] " << __func__ << " HIGH CONF: " << pf_conf << " sig: " << std::hex << curr_sig << std::dec << " set: " << set
+                         << " way: " << way;
+               std::cout << " delta: " << +delta[set][way] << " c_delta: " << +c_delta[set][way] << " c_sig: " << +c_sig[set];
+               std::cout << " conf: " << local_conf << " depth: " << depth << std::endl;);
       } else {
-        SPP_DP(cout << "[PT] " << __func__ << "  LOW CONF: " << pf_conf << " sig: " << hex << curr_sig << dec << " set: " << set << " way: " << way;
-               cout << " delta: " << delta[set][way] << " c_delta: " << c_delta[set][way] << " c_sig: " << c_sig[set];
-               cout << " conf: " << local_conf << " depth: " << depth << endl;);
+        SPP_DP(std::cout << "[PT] " << __func__ << "  LOW CONF: " << pf_conf << " sig: " << std::hex << curr_sig << std::dec << " set: " << set
+                         << " way: " << way;
+               std::cout << " delta: " << +delta[set][way] << " c_delta: " << +c_delta[set][way] << " c_sig: " << +c_sig[set];
+               std::cout << " conf: " << local_conf << " depth: " << depth << std::endl;);
       }
     }
     lookahead_conf = max_conf;
     if (lookahead_conf >= PF_THRESHOLD)
       depth++;
 
-    SPP_DP(cout << "global_accuracy: " << GHR.global_accuracy << " lookahead_conf: " << lookahead_conf << endl;);
-  } else
+    SPP_DP(std::cout << "global_accuracy: " << GHR.global_accuracy << " lookahead_conf: " << lookahead_conf << std::endl;);
+  } else if (pf_q_tail < std::size(confidence_q))
     confidence_q[pf_q_tail] = 0;
 }
 
-bool PREFETCH_FILTER::check(uint64_t check_addr, FILTER_REQUEST filter_request)
+bool PREFETCH_FILTER::check(uint64_t check_addr, FILTER_REQUEST filter_request, GLOBAL_REGISTER& GHR)
 {
   uint64_t cache_line = check_addr >> LOG2_BLOCK_SIZE, hash = get_hash(cache_line), quotient = (hash >> REMAINDER_BIT) & ((1 << QUOTIENT_BIT) - 1),
            remainder = hash % (1 << REMAINDER_BIT);
+  bool is_valid = test_bit(valid.data(), quotient), is_useful = test_bit(useful.data(), quotient);
 
-  SPP_DP(cout << "[FILTER] check_addr: " << hex << check_addr << " check_cache_line: " << (check_addr >> LOG2_BLOCK_SIZE);
-         cout << " hash: " << hash << dec << " quotient: " << quotient << " remainder: " << remainder << endl;);
+  SPP_DP(std::cout << "[FILTER] check_addr: " << std::hex << check_addr << " check_cache_line: " << (check_addr >> LOG2_BLOCK_SIZE);
+         std::cout << " hash: " << hash << std::dec << " quotient: " << quotient << " remainder: " << remainder << std::endl;);
 
   switch (filter_request) {
   case SPP_L2C_PREFETCH:
-    if ((valid[quotient] || useful[quotient]) && remainder_tag[quotient] == remainder) {
-      SPP_DP(cout << "[FILTER] " << __func__ << " line is already in the filter check_addr: " << hex << check_addr << " cache_line: " << cache_line << dec;
-             cout << " quotient: " << quotient << " valid: " << valid[quotient] << " useful: " << useful[quotient] << endl;);
+    if ((is_valid || is_useful) && remainder_tag[quotient] == remainder) {
+      SPP_DP(std::cout << "[FILTER] " << __func__ << " line is already in the filter check_addr: " << std::hex << check_addr << " cache_line: " << cache_line
+                       << std::dec;
+             std::cout << " quotient: " << quotient << " valid: " << is_valid << " useful: " << is_useful << std::endl;);
 
       return false; // False return indicates "Do not prefetch"
     } else {
-      valid[quotient] = 1;  // Mark as prefetched
-      useful[quotient] = 0; // Reset useful bit
+      assign_bit(valid.data(), quotient, true);   // Mark as prefetched
+      assign_bit(useful.data(), quotient, false); // Reset useful bit
       remainder_tag[quotient] = remainder;
 
-      SPP_DP(cout << "[FILTER] " << __func__ << " set valid for check_addr: " << hex << check_addr << " cache_line: " << cache_line << dec;
-             cout << " quotient: " << quotient << " remainder_tag: " << remainder_tag[quotient] << " valid: " << valid[quotient]
-                  << " useful: " << useful[quotient] << endl;);
+      SPP_DP(std::cout << "[FILTER] " << __func__ << " set valid for check_addr: " << std::hex << check_addr << " cache_line: " << cache_line << std::dec;
+             std::cout << " quotient: " << quotient << " remainder_tag: " << +remainder_tag[quotient] << std::endl;);
     }
     break;
 
   case SPP_LLC_PREFETCH:
-    if ((valid[quotient] || useful[quotient]) && remainder_tag[quotient] == remainder) {
-      SPP_DP(cout << "[FILTER] " << __func__ << " line is already in the filter check_addr: " << hex << check_addr << " cache_line: " << cache_line << dec;
-             cout << " quotient: " << quotient << " valid: " << valid[quotient] << " useful: " << useful[quotient] << endl;);
+    if ((is_valid || is_useful) && remainder_tag[quotient] == remainder) {
+      SPP_DP(std::cout << "[FILTER] " << __func__ << " line is already in the filter check_addr: " << std::hex << check_addr << " cache_line: " << cache_line
+                       << std::dec;
+             std::cout << " quotient: " << quotient << " valid: " << is_valid << " useful: " << is_useful << std::endl;);
 
       return false; // False return indicates "Do not prefetch"
     } else {
@@ -388,42 +410,40 @@ bool PREFETCH_FILTER::check(uint64_t check_addr, FILTER_REQUEST filter_request)
       // (not from DRAM) To allow this fast prefetch from LLC, SPP does not set
       // the valid bit for SPP_LLC_PREFETCH
 
-      // valid[quotient] = 1;
-      // useful[quotient] = 0;
-
-      SPP_DP(cout << "[FILTER] " << __func__ << " don't set valid for check_addr: " << hex << check_addr << " cache_line: " << cache_line << dec;
-             cout << " quotient: " << quotient << " valid: " << valid[quotient] << " useful: " << useful[quotient] << endl;);
+      SPP_DP(std::cout << "[FILTER] " << __func__ << " don't set valid for check_addr: " << std::hex << check_addr << " cache_line: " << cache_line
+                       << std::dec;
+             std::cout << " quotient: " << quotient << " valid: " << is_valid << " useful: " << is_useful << std::endl;);
     }
     break;
 
   case L2C_DEMAND:
-    if ((remainder_tag[quotient] == remainder) && (useful[quotient] == 0)) {
-      useful[quotient] = 1;
-      if (valid[quotient])
+    if ((remainder_tag[quotient] == remainder) && !is_useful) {
+      assign_bit(useful.data(), quotient, true);
+      if (is_valid)
         GHR.pf_useful++; // This cache line was prefetched by SPP and actually
                          // used in the program
 
-      SPP_DP(cout << "[FILTER] " << __func__ << " set useful for check_addr: " << hex << check_addr << " cache_line: " << cache_line << dec;
-             cout << " quotient: " << quotient << " valid: " << valid[quotient] << " useful: " << useful[quotient];
-             cout << " GHR.pf_issued: " << GHR.pf_issued << " GHR.pf_useful: " << GHR.pf_useful << endl;);
+      SPP_DP(std::cout << "[FILTER] " << __func__ << " set useful for check_addr: " << std::hex << check_addr << " cache_line: " << cache_line << std::dec;
+             std::cout << " quotient: " << quotient << " valid: " << is_valid;
+             std::cout << " GHR.pf_issued: " << GHR.pf_issued << " GHR.pf_useful: " << GHR.pf_useful << std::endl;);
     }
     break;
 
   case L2C_EVICT:
     // Decrease global pf_useful counter when there is a useless prefetch
     // (prefetched but not used)
-    if (valid[quotient] && !useful[quotient] && GHR.pf_useful)
+    if (is_valid && !is_useful && GHR.pf_useful)
       GHR.pf_useful--;
 
     // Reset filter entry
-    valid[quotient] = 0;
-    useful[quotient] = 0;
+    assign_bit(valid.data(), quotient, false);
+    assign_bit(useful.data(), quotient, false);
     remainder_tag[quotient] = 0;
     break;
 
   default:
     // Assertion
-    cout << "[FILTER] Invalid filter request type: " << filter_request << endl;
+    std::cout << "[FILTER] Invalid filter request type: " << filter_request << std::endl;
     assert(0);
   }
 
@@ -437,22 +457,21 @@ void GLOBAL_REGISTER::update_entry(uint32_t pf_sig, uint32_t pf_confidence, uint
   // the pf_offset
   uint32_t min_conf = 100, victim_way = MAX_GHR_ENTRY;
 
-  SPP_DP(cout << "[GHR] Crossing the page boundary pf_sig: " << hex << pf_sig << dec;
-         cout << " confidence: " << pf_confidence << " pf_offset: " << pf_offset << " pf_delta: " << pf_delta << endl;);
+  SPP_DP(std::cout << "[GHR] Crossing the page boundary pf_sig: " << std::hex << pf_sig << std::dec;
+         std::cout << " confidence: " << pf_confidence << " pf_offset: " << pf_offset << " pf_delta: " << pf_delta << std::endl;);
 
   for (uint32_t i = 0; i < MAX_GHR_ENTRY; i++) {
     // if (sig[i] == pf_sig) { // TODO: Which one is better and consistent?
     // If GHR already holds the same pf_sig, update the GHR entry with the
     // latest info
-    if (valid[i] && (offset[i] == pf_offset)) {
+    if (((valid >> i) & 1) && (offset[i] == pf_offset)) {
       // If GHR already holds the same pf_offset, update the GHR entry with the
       // latest info
       sig[i] = pf_sig;
       confidence[i] = pf_confidence;
-      // offset[i] = pf_offset;
       delta[i] = pf_delta;
 
-      SPP_DP(cout << "[GHR] Found a matching index: " << i << endl;);
+      SPP_DP(std::cout << "[GHR] Found a matching index: " << i << std::endl;);
 
       return;
     }
@@ -467,21 +486,21 @@ void GLOBAL_REGISTER::update_entry(uint32_t pf_sig, uint32_t pf_confidence, uint
 
   // Assertion
   if (victim_way >= MAX_GHR_ENTRY) {
-    cout << "[GHR] Cannot find a replacement victim!" << endl;
+    std::cout << "[GHR] Cannot find a replacement victim!" << std::endl;
     assert(0);
   }
 
-  SPP_DP(cout << "[GHR] Replace index: " << victim_way << " pf_sig: " << hex << sig[victim_way] << dec;
-         cout << " confidence: " << confidence[victim_way] << " pf_offset: " << offset[victim_way] << " pf_delta: " << delta[victim_way] << endl;);
+  SPP_DP(std::cout << "[GHR] Replace index: " << victim_way << " pf_sig: " << std::hex << sig[victim_way] << std::dec;
+         std::cout << " confidence: " << +confidence[victim_way] << " pf_offset: " << +offset[victim_way] << " pf_delta: " << +delta[victim_way] << std::endl;);
 
-  valid[victim_way] = 1;
+  valid |= 1u << victim_way;
   sig[victim_way] = pf_sig;
   confidence[victim_way] = pf_confidence;
   offset[victim_way] = pf_offset;
   delta[victim_way] = pf_delta;
 }
 
-uint32_t GLOBAL_REGISTER::check_entry(uint32_t page_offset)
+uint32_t GLOBAL_REGISTER::check_entry(uint32_t page_offset) const
 {
   uint32_t max_conf = 0, max_conf_way = MAX_GHR_ENTRY;
 
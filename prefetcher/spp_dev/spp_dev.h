@@ -1,6 +1,10 @@
 #ifndef SPP_H
 #define SPP_H
 
+#include <array>
+#include <cstdint>
+#include <vector>
+
 // SPP functional knobs
 #define LOOKAHEAD_ON
 #define FILTER_ON
@@ -45,115 +49,86 @@
 #define GLOBAL_COUNTER_MAX ((1 << GLOBAL_COUNTER_BIT) - 1)
 #define MAX_GHR_ENTRY 8
 
+/*
+ * Each table is kept as structure-of-arrays, with each field as narrow as the
+ * hardware it models, so that a tag search compares a contiguous array of
+ * narrow tags and builds a bitmask of the matching ways. Written this way, the
+ * compiler turns the searches into vector compares. Valid, prefetched and
+ * useful bits are packed into 64-bit words.
+ */
+namespace spp
+{
+static_assert(ST_TAG_BIT <= 16 && SIG_BIT <= 16 && SIG_DELTA_BIT <= 8 && C_SIG_BIT < 8 && REMAINDER_BIT <= 8);
+static_assert(ST_WAY % 64 == 0 && ST_WAY <= 256, "the signature table ways are searched 64 at a time, and their LRU positions are 8 bits");
+static_assert(FILTER_SET % 64 == 0);
+
 enum FILTER_REQUEST { SPP_L2C_PREFETCH, SPP_LLC_PREFETCH, L2C_DEMAND, L2C_EVICT }; // Request type for prefetch filter
 uint64_t get_hash(uint64_t key);
 
-class SIGNATURE_TABLE
+// Sign-magnitude representation of a delta, as folded into a signature
+inline uint32_t sig_delta(int delta) { return (delta < 0) ? (((-1) * delta) + (1 << (SIG_DELTA_BIT - 1))) : delta; }
+
+class GLOBAL_REGISTER
 {
 public:
-  bool valid[ST_SET][ST_WAY];
-  uint32_t tag[ST_SET][ST_WAY], last_offset[ST_SET][ST_WAY], sig[ST_SET][ST_WAY], lru[ST_SET][ST_WAY];
-
-  SIGNATURE_TABLE()
-  {
-    cout << "Initialize SIGNATURE TABLE" << endl;
-    cout << "ST_SET: " << ST_SET << endl;
-    cout << "ST_WAY: " << ST_WAY << endl;
-    cout << "ST_TAG_BIT: " << ST_TAG_BIT << endl;
-    cout << "ST_TAG_MASK: " << hex << ST_TAG_MASK << dec << endl;
-
-    for (uint32_t set = 0; set < ST_SET; set++)
-      for (uint32_t way = 0; way < ST_WAY; way++) {
-        valid[set][way] = 0;
-        tag[set][way] = 0;
-        last_offset[set][way] = 0;
-        sig[set][way] = 0;
-        lru[set][way] = way;
-      }
-  };
-
-  void read_and_update_sig(uint64_t page, uint32_t page_offset, uint32_t& last_sig, uint32_t& curr_sig, int32_t& delta);
+  // Global counters to calculate global prefetching accuracy
+  uint64_t pf_useful = 0, pf_issued = 0,
+           global_accuracy = 0; // Alpha value in Section III. Equation 3
+
+  // Global History Register (GHR) entries
+  uint8_t valid = 0; // bitmap of the valid entries
+  std::array<uint16_t, MAX_GHR_ENTRY> sig = {};
+  std::array<uint8_t, MAX_GHR_ENTRY> confidence = {}, offset = {};
+  std::array<int8_t, MAX_GHR_ENTRY> delta = {};
+
+  void update_entry(uint32_t pf_sig, uint32_t pf_confidence, uint32_t pf_offset, int pf_delta);
+  uint32_t check_entry(uint32_t page_offset) const;
 };
 
-class PATTERN_TABLE
+class SIGNATURE_TABLE
 {
 public:
-  int delta[PT_SET][PT_WAY];
-  uint32_t c_delta[PT_SET][PT_WAY], c_sig[PT_SET];
-
-  PATTERN_TABLE()
-  {
-    cout << endl << "Initialize PATTERN TABLE" << endl;
-    cout << "PT_SET: " << PT_SET << endl;
-    cout << "PT_WAY: " << PT_WAY << endl;
-    cout << "SIG_DELTA_BIT: " << SIG_DELTA_BIT << endl;
-    cout << "C_SIG_BIT: " << C_SIG_BIT << endl;
-    cout << "C_DELTA_BIT: " << C_DELTA_BIT << endl;
-
-    for (uint32_t set = 0; set < PT_SET; set++) {
-      for (uint32_t way = 0; way < PT_WAY; way++) {
-        delta[set][way] = 0;
-        c_delta[set][way] = 0;
-      }
-      c_sig[set] = 0;
-    }
-  }
-
-  void update_pattern(uint32_t last_sig, int curr_delta), read_pattern(uint32_t curr_sig, int*prefetch_delta, uint32_t*confidence_q, uint32_t&lookahead_way,
-                                                                       uint32_t&lookahead_conf, uint32_t&pf_q_tail, uint32_t&depth);
+  std::array<std::array<uint64_t, ST_WAY / 64>, ST_SET> valid = {};
+  std::array<std::array<uint16_t, ST_WAY>, ST_SET> tag = {}, sig = {};
+  std::array<std::array<uint8_t, ST_WAY>, ST_SET> last_offset = {}, lru = {};
+
+  SIGNATURE_TABLE();
+
+  void read_and_update_sig(uint64_t page, uint32_t page_offset, uint32_t& last_sig, uint32_t& curr_sig, int32_t& delta, const GLOBAL_REGISTER& GHR);
 };
 
-class PREFETCH_FILTER
+class PATTERN_TABLE
 {
 public:
-  uint64_t remainder_tag[FILTER_SET];
-  bool valid[FILTER_SET], // Consider this as "prefetched"
-      useful[FILTER_SET]; // Consider this as "used"
-
-  PREFETCH_FILTER()
-  {
-    cout << endl << "Initialize PREFETCH FILTER" << endl;
-    cout << "FILTER_SET: " << FILTER_SET << endl;
-
-    for (uint32_t set = 0; set < FILTER_SET; set++) {
-      remainder_tag[set] = 0;
-      valid[set] = 0;
-      useful[set] = 0;
-    }
-  }
-
-  bool check(uint64_t pf_addr, FILTER_REQUEST filter_request);
+  std::array<std::array<int8_t, PT_WAY>, PT_SET> delta = {};
+  std::array<std::array<uint8_t, PT_WAY>, PT_SET> c_delta = {};
+  std::array<uint8_t, PT_SET> c_sig = {};
+
+  void update_pattern(uint32_t last_sig, int curr_delta);
+  void read_pattern(uint32_t curr_sig, std::vector<int>& delta_q, std::vector<uint32_t>& confidence_q, uint32_t& lookahead_way, uint32_t& lookahead_conf,
+                    uint32_t& pf_q_tail, uint32_t& depth, const GLOBAL_REGISTER& GHR) const;
 };
 
-class GLOBAL_REGISTER
+class PREFETCH_FILTER
 {
 public:
-  // Global counters to calculate global prefetching accuracy
-  uint64_t pf_useful, pf_issued,
-      global_accuracy; // Alpha value in Section III. Equation 3
+  std::array<uint8_t, FILTER_SET> remainder_tag = {};
+  std::array<uint64_t, FILTER_SET / 64> valid = {}, // Consider this as "prefetched"
+      useful = {};                                  // Consider this as "used"
 
-  // Global History Register (GHR) entries
-  uint8_t valid[MAX_GHR_ENTRY];
-  uint32_t sig[MAX_GHR_ENTRY], confidence[MAX_GHR_ENTRY], offset[MAX_GHR_ENTRY];
-  int delta[MAX_GHR_ENTRY];
-
-  GLOBAL_REGISTER()
-  {
-    pf_useful = 0;
-    pf_issued = 0;
-    global_accuracy = 0;
-
-    for (uint32_t i = 0; i < MAX_GHR_ENTRY; i++) {
-      valid[i] = 0;
-      sig[i] = 0;
-      confidence[i] = 0;
-      offset[i] = 0;
-      delta[i] = 0;
-    }
-  }
+  bool check(uint64_t pf_addr, FILTER_REQUEST filter_request, GLOBAL_REGISTER& GHR);
+};
 
-  void update_entry(uint32_t pf_sig, uint32_t pf_confidence, uint32_t pf_offset, int pf_delta);
-  uint32_t check_entry(uint32_t page_offset);
+struct spp_state {
+  SIGNATURE_TABLE ST;
+  PATTERN_TABLE PT;
+  PREFETCH_FILTER FILTER;
+  GLOBAL_REGISTER GHR;
+
+  // the prefetch candidates of one access, one per MSHR
+  std::vector<int> delta_q;
+  std::vector<uint32_t> confidence_q;
 };
+} // namespace spp
 
 #endif
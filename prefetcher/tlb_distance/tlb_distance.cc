@@ -0,0 +1,110 @@
+#include <algorithm>
+#include <array>
+#include <iostream>
+
+#include "cache.h"
+
+constexpr std::size_t DISTANCE_SETS = 64;
+constexpr std::size_t DISTANCE_WAYS = 4;
+
+// the number of distances remembered to follow each distance
+constexpr std::size_t PREDICTIONS = 2;
+
+namespace
+{
+// the distances that have been seen to follow a distance between consecutive missing pages, most recent first
+struct distance_entry {
+  bool valid = false;
+  int64_t distance = 0;
+  std::array<int64_t, PREDICTIONS> next = {};
+  uint64_t last_used = 0;
+};
+
+struct tlb_distance_state {
+  std::array<distance_entry, DISTANCE_SETS * DISTANCE_WAYS> table;
+  uint64_t last_page = 0;
+  int64_t last_distance = 0;
+  uint64_t lookups = 0, hits = 0;
+
+  distance_entry* find(int64_t distance)
+  {
+    auto set_begin = std::next(std::begin(table), static_cast<uint64_t>(distance) % DISTANCE_SETS * DISTANCE_WAYS);
+    auto set_end = std::next(set_begin, DISTANCE_WAYS);
+    auto found = std::find_if(set_begin, set_end, [distance](const distance_entry& x) { return x.valid && x.distance == distance; });
+    return (found != set_end) ? &(*found) : nullptr;
+  }
+
+  distance_entry& allocate(int64_t distance)
+  {
+    auto set_begin = std::next(std::begin(table), static_cast<uint64_t>(distance) % DISTANCE_SETS * DISTANCE_WAYS);
+    auto set_end = std::next(set_begin, DISTANCE_WAYS);
+    auto victim = std::min_element(set_begin, set_end, [](const distance_entry& x, const distance_entry& y) {
+      return !x.valid || (y.valid && x.last_used < y.last_used);
+    });
+    *victim = {true, distance, {}, 0};
+    return *victim;
+  }
+};
+} // namespace
+
+void CACHE::prefetcher_initialize()
+{
+  std::cout << NAME << " distance TLB prefetcher" << std::endl;
+  pref_state.emplace<tlb_distance_state>();
+}
+
+// Distance prefetching (Kandiraju and Sivasubramaniam, ISCA 2002): the table records which distances between consecutive missing
+// pages have followed each distance. On a miss, the distances that followed the current one are used to prefetch translations.
+uint32_t CACHE::prefetcher_cache_operate(uint64_t addr, uint64_t ip, uint8_t cache_hit, uint8_t type, uint32_t metadata_in)
+{
+  if (cache_hit)
+    return metadata_in;
+
+  auto& st = *pref_state.get<tlb_distance_state>();
+  uint64_t page = addr >> LOG2_PAGE_SIZE;
+  int64_t distance = static_cast<int64_t>(page) - static_cast<int64_t>(st.last_page);
+
+  if (st.last_page != 0 && distance != 0) {
+    // learn that this distance followed the previous one
+    auto prev = st.find(st.last_distance);
+    auto& entry = (prev != nullptr) ? *prev : st.allocate(st.last_distance);
+    if (auto found = std::find(std::begin(entry.next), std::end(entry.next), distance); found != std::end(entry.next))
+      std::rotate(std::begin(entry.next), found, std::next(found));
+    else {
+      std::copy_backward(std::begin(entry.next), std::prev(std::end(entry.next)), std::end(entry.next));
+      entry.next.front() = distance;
+    }
+    entry.last_used = current_cycle;
+
+    // predict the distances that follow this one
+    st.lookups++;
+    if (auto predicted = st.find(distance); predicted != nullptr) {
+      st.hits++;
+      predicted->last_used = current_cycle;
+      for (auto next : predicted->next) {
+        if (next != 0 && static_cast<int64_t>(page) + next > 0)
+          prefetch_line((page + next) << LOG2_PAGE_SIZE, true, 0);
+      }
+    }
+
+    st.last_distance = distance;
+  }
+
+  if (distance != 0)
+    st.last_page = page;
+
+  return metadata_in;
+}
+
+uint32_t CACHE::prefetcher_cache_fill(uint64_t addr, uint32_t set, uint32_t way, uint8_t prefetch, uint64_t evicted_addr, uint32_t metadata_in)
+{
+  return metadata_in;
+}
+
+void CACHE::prefetcher_cycle_operate() {}
+
+void CACHE::prefetcher_final_stats()
+{
+  auto& st = *pref_state.get<tlb_distance_state>();
+  std::cout << NAME << " DISTANCE TABLE LOOKUPS: " << st.lookups << " HITS: " << st.hits << std::endl;
+}
@@ -0,0 +1,31 @@
+#include <iostream>
+
+#include "cache.h"
+
+// the number of pages after a missing page whose translations are prefetched
+constexpr uint64_t PREFETCH_DEGREE = 2;
+
+void CACHE::prefetcher_initialize() { std::cout << NAME << " sequential TLB prefetcher" << std::endl; }
+
+// Addresses here are virtual page addresses. Each miss prefetches the translations of the pages that follow it, which the page
+// table walker fills into this TLB.
+uint32_t CACHE::prefetcher_cache_operate(uint64_t addr, uint64_t ip, uint8_t cache_hit, uint8_t type, uint32_t metadata_in)
+{
+  if (cache_hit)
+    return metadata_in;
+
+  uint64_t page = addr >> LOG2_PAGE_SIZE;
+  for (uint64_t i = 1; i <= PREFETCH_DEGREE; ++i)
+    prefetch_line((page + i) << LOG2_PAGE_SIZE, true, 0);
+
+  return metadata_in;
+}
+
+uint32_t CACHE::prefetcher_cache_fill(uint64_t addr, uint32_t set, uint32_t way, uint8_t prefetch, uint64_t evicted_addr, uint32_t metadata_in)
+{
+  return metadata_in;
+}
+
+void CACHE::prefetcher_cycle_operate() {}
+
+void CACHE::prefetcher_final_stats() {}
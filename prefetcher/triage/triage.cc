@@ -0,0 +1,384 @@
+/*
+ * A temporal prefetcher for irregular miss streams, after Wu et al.,
+ * "Temporal Prefetching Without the Off-Chip Metadata," MICRO 2019 (Triage),
+ * and Jain and Lin, "Linearizing Irregular Memory Accesses for Improved
+ * Correlated Prefetching," MICRO 2013 (ISB).
+ *
+ * Each load PC's consecutive misses (and hits on prefetched blocks) are
+ * correlated: the training unit remembers the last such address for each PC,
+ * and the metadata table maps that address to the one that followed it, with
+ * a confidence bit so that a single deviation does not replace a successor.
+ * A trigger looks up its successor and prefetches it, and with
+ * TRIAGE_DEGREE > 1 follows the chain from there.
+ *
+ * The metadata table does not live in the prefetcher. It holds
+ * TRIAGE_METADATA_ENTRIES four-byte entries, sixteen to a block, in physical
+ * frames allocated from the virtual memory system, and a block must be read
+ * before it can be used. Blocks are held in a small on-chip metadata cache of
+ * TRIAGE_CACHE_BLOCKS blocks, and dirty blocks are written back when evicted.
+ * The reads and writes are real packets:
+ *
+ * - By default they are sent to the last level cache, where the metadata
+ *   competes with data for capacity and misses to DRAM like any other block.
+ * - With TRIAGE_METADATA_DRAM=1 they are sent directly to the memory
+ *   controllers, and cost only DRAM bandwidth.
+ *
+ * The reads are METADATA accesses, so they are counted apart from the demand
+ * loads of the cache that serves them, and train no prefetcher there, this
+ * one included. The metadata traffic is reported with the prefetcher's final
+ * statistics, so that it can be weighed against the misses the prefetches
+ * cover.
+ */
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <vector>
+
+#include "cache.h"
+#include "dram_controller.h"
+#include "util.h"
+#include "vmem.h"
+
+extern VirtualMemory vmem;
+extern MEMORY_ROUTER DRAM;
+
+#ifndef TRIAGE_METADATA_DRAM
+#define TRIAGE_METADATA_DRAM 0
+#endif
+
+#ifndef TRIAGE_METADATA_ENTRIES
+#define TRIAGE_METADATA_ENTRIES (1 << 17)
+#endif
+
+#ifndef TRIAGE_CACHE_BLOCKS
+#define TRIAGE_CACHE_BLOCKS 64
+#endif
+
+#ifndef TRIAGE_TRAINING_ENTRIES
+#define TRIAGE_TRAINING_ENTRIES 256
+#endif
+
+#ifndef TRIAGE_DEGREE
+#define TRIAGE_DEGREE 1
+#endif
+
+namespace
+{
+constexpr std::size_t ENTRIES_PER_BLOCK = BLOCK_SIZE / 4;
+constexpr std::size_t META_BLOCKS = TRIAGE_METADATA_ENTRIES / ENTRIES_PER_BLOCK;
+static_assert(META_BLOCKS > 0 && (META_BLOCKS & (META_BLOCKS - 1)) == 0, "TRIAGE_METADATA_ENTRIES must be a power of two of at least one block");
+static_assert(ENTRIES_PER_BLOCK <= 256);
+
+constexpr std::size_t MC_BLOCKS = TRIAGE_CACHE_BLOCKS;
+constexpr std::size_t TRAINING_ENTRIES = TRIAGE_TRAINING_ENTRIES;
+constexpr unsigned DEGREE = TRIAGE_DEGREE;
+static_assert(MC_BLOCKS > 0 && TRAINING_ENTRIES > 0 && DEGREE > 0);
+
+// metadata reads that may be outstanding at once
+constexpr std::size_t MAX_READS = 16;
+
+uint64_t mix(uint64_t key)
+{
+  // the finalizer of MurmurHash3
+  key ^= key >> 33;
+  key *= 0xff51afd7ed558ccdull;
+  key ^= key >> 33;
+  key *= 0xc4ceb9fe1a85ec53ull;
+  key ^= key >> 33;
+  return key;
+}
+
+// receives the metadata blocks returned by the lower level
+struct metadata_port final : public MemoryRequestProducer {
+  std::deque<uint64_t> returned;
+
+  metadata_port() : MemoryRequestProducer(nullptr) {}
+  void return_data(PACKET* packet) override { returned.push_back(packet->address); }
+};
+
+struct pending_read {
+  uint64_t block, address;
+  bool issued = false, dirty = false;
+  std::vector<std::pair<uint64_t, unsigned>> lookups; // the block addresses waiting on this metadata, and their remaining degree
+};
+
+struct triage_state {
+  MemoryRequestConsumer* target = nullptr;
+  std::vector<uint64_t> frames; // the physical frames holding the metadata table
+
+  // the metadata table, ENTRIES_PER_BLOCK entries for each metadata block
+  std::vector<uint16_t> tags = std::vector<uint16_t>(META_BLOCKS * ENTRIES_PER_BLOCK);
+  std::vector<uint64_t> successors = std::vector<uint64_t>(META_BLOCKS * ENTRIES_PER_BLOCK);
+  std::vector<uint8_t> confidence = std::vector<uint8_t>(META_BLOCKS * ENTRIES_PER_BLOCK), age = std::vector<uint8_t>(META_BLOCKS * ENTRIES_PER_BLOCK);
+
+  // the training unit: the last trigger of each PC
+  std::array<uint64_t, TRAINING_ENTRIES> tu_ip = {}, tu_last = {};
+
+  // the on-chip metadata cache, fully associative with LRU replacement
+  std::array<uint64_t, MC_BLOCKS> mc_blocks = {}; // metadata block + 1, or 0 if invalid
+  std::array<uint64_t, MC_BLOCKS> mc_last_used = {};
+  std::array<bool, MC_BLOCKS> mc_dirty = {};
+  uint64_t mc_clock = 0;
+
+  std::vector<pending_read> reads;
+  std::deque<uint64_t> writes;
+  metadata_port port;
+
+  uint64_t triggers = 0, trained = 0, predictions = 0, mc_hits = 0, mc_misses = 0, reads_issued = 0, writes_issued = 0, reads_dropped = 0;
+
+  static uint64_t hash(uint64_t cl_addr) { return mix(cl_addr); }
+  static uint64_t meta_block(uint64_t cl_addr) { return hash(cl_addr) & (META_BLOCKS - 1); }
+  static uint16_t meta_tag(uint64_t cl_addr) { return hash(cl_addr) >> 48; }
+
+  uint64_t block_address(uint64_t block) const
+  {
+    uint64_t offset = block * BLOCK_SIZE;
+    return frames[offset / PAGE_SIZE] + (offset % PAGE_SIZE);
+  }
+
+  // the index of the entry for this address in its metadata block, or ENTRIES_PER_BLOCK if there is none
+  std::size_t find_entry(uint64_t cl_addr) const
+  {
+    auto begin = meta_block(cl_addr) * ENTRIES_PER_BLOCK;
+    auto tag = meta_tag(cl_addr);
+    std::size_t idx = ENTRIES_PER_BLOCK;
+    for (std::size_t i = 0; i < ENTRIES_PER_BLOCK; i++)
+      idx = (tags[begin + i] == tag && successors[begin + i] != 0) ? i : idx;
+    return idx;
+  }
+
+  void touch_entry(std::size_t begin, std::size_t idx)
+  {
+    for (std::size_t i = begin; i < begin + ENTRIES_PER_BLOCK; i++)
+      age[i] += (age[i] < age[begin + idx]);
+    age[begin + idx] = 0;
+  }
+
+  void train(uint64_t prev, uint64_t next)
+  {
+    auto begin = meta_block(prev) * ENTRIES_PER_BLOCK;
+    auto idx = find_entry(prev);
+    if (idx == ENTRIES_PER_BLOCK) {
+      auto block_begin = std::next(std::begin(age), begin);
+      idx = std::distance(block_begin, std::max_element(block_begin, std::next(block_begin, ENTRIES_PER_BLOCK)));
+      tags[begin + idx] = meta_tag(prev);
+      successors[begin + idx] = next;
+      confidence[begin + idx] = 0;
+      age[begin + idx] = ENTRIES_PER_BLOCK;
+    } else if (successors[begin + idx] == next) {
+      confidence[begin + idx] = 1;
+    } else if (confidence[begin + idx]) {
+      confidence[begin + idx] = 0;
+    } else {
+      successors[begin + idx] = next;
+    }
+    touch_entry(begin, idx);
+  }
+
+  // the index of this metadata block in the metadata cache, or MC_BLOCKS if it is not there
+  std::size_t mc_find(uint64_t block) const
+  {
+    std::size_t idx = MC_BLOCKS;
+    for (std::size_t i = 0; i < MC_BLOCKS; i++)
+      idx = (mc_blocks[i] == block + 1) ? i : idx;
+    return idx;
+  }
+
+  void mc_insert(uint64_t block, bool dirty)
+  {
+    auto idx = mc_find(block);
+    if (idx == MC_BLOCKS) {
+      idx = std::distance(std::begin(mc_last_used), std::min_element(std::begin(mc_last_used), std::end(mc_last_used)));
+      if (mc_blocks[idx] != 0 && mc_dirty[idx])
+        writes.push_back(mc_blocks[idx] - 1);
+      mc_blocks[idx] = block + 1;
+      mc_dirty[idx] = false;
+    }
+    mc_dirty[idx] = mc_dirty[idx] || dirty;
+    mc_last_used[idx] = ++mc_clock;
+  }
+
+  // wait for a metadata block, merging with a read of the same block that is already outstanding
+  pending_read* request(uint64_t block)
+  {
+    mc_misses++;
+    auto found = std::find_if(std::begin(reads), std::end(reads), [block](const auto& x) { return x.block == block; });
+    if (found != std::end(reads))
+      return &*found;
+
+    if (std::size(reads) == MAX_READS) {
+      reads_dropped++;
+      return nullptr;
+    }
+
+    reads.push_back({block, block_address(block)});
+    return &reads.back();
+  }
+};
+} // namespace
+
+void CACHE::prefetcher_initialize()
+{
+  auto& st = *pref_state.emplace<triage_state>();
+
+  if (TRIAGE_METADATA_DRAM) {
+    st.target = &DRAM;
+  } else {
+    // the metadata is kept in the last level cache below this one
+    CACHE* llc = this;
+    while (auto lower = llc->lower_cache())
+      llc = lower;
+    st.target = llc;
+  }
+
+  // the metadata table is placed in frames of its own, as if allocated by the operating system
+  for (std::size_t i = 0; i < (META_BLOCKS * BLOCK_SIZE + PAGE_SIZE - 1) / PAGE_SIZE; i++)
+    st.frames.push_back(vmem.allocate_ppage(cpu));
+
+  std::cout << NAME << " Triage temporal prefetcher metadata: " << TRIAGE_METADATA_ENTRIES << " entries (" << META_BLOCKS * BLOCK_SIZE / 1024 << " KB) in "
+            << (TRIAGE_METADATA_DRAM ? "DRAM" : dynamic_cast<CACHE*>(st.target)->NAME) << " metadata cache: " << MC_BLOCKS << " blocks degree: " << DEGREE
+            << std::endl;
+}
+
+namespace
+{
+void lookup(CACHE& cache, triage_state& st, uint64_t cl_addr, unsigned degree)
+{
+  for (; degree > 0; degree--) {
+    auto block = st.meta_block(cl_addr);
+    auto mc_idx = st.mc_find(block);
+    if (mc_idx == MC_BLOCKS) {
+      if (auto read = st.request(block); read != nullptr)
+        read->lookups.push_back({cl_addr, degree});
+      return;
+    }
+
+    st.mc_hits++;
+    st.mc_last_used[mc_idx] = ++st.mc_clock;
+    auto idx = st.find_entry(cl_addr);
+    if (idx == ENTRIES_PER_BLOCK)
+      return;
+
+    cl_addr = st.successors[block * ENTRIES_PER_BLOCK + idx];
+    uint64_t pf_addr = cl_addr << LOG2_BLOCK_SIZE;
+    if (!cache.prefetch_line(pf_addr, (cache.get_occupancy(0, pf_addr) < cache.get_size(0, pf_addr) / 2), 0))
+      return;
+    st.predictions++;
+  }
+}
+} // namespace
+
+uint32_t CACHE::prefetcher_cache_operate(uint64_t addr, uint64_t ip, uint8_t cache_hit, uint8_t type, uint32_t metadata_in)
+{
+  auto& st = *pref_state.get<triage_state>();
+  if (type == PREFETCH)
+    return metadata_in;
+
+  // train on misses, and on hits to prefetched blocks, which would have missed without the prefetcher
+  if (cache_hit) {
+    uint32_t set = get_set(addr);
+    uint32_t way = get_way(addr, set);
+    if (way == NUM_WAY || !block[set * NUM_WAY + way].prefetch)
+      return metadata_in;
+  }
+
+  st.triggers++;
+  uint64_t cl_addr = addr >> LOG2_BLOCK_SIZE;
+  auto tu_idx = mix(ip) % TRAINING_ENTRIES;
+  if (st.tu_ip[tu_idx] == ip && st.tu_last[tu_idx] != 0 && st.tu_last[tu_idx] != cl_addr) {
+    // the update is made at once, and marks the metadata block dirty once it is on chip
+    uint64_t prev = st.tu_last[tu_idx];
+    st.train(prev, cl_addr);
+    st.trained++;
+
+    auto block = st.meta_block(prev);
+    if (auto mc_idx = st.mc_find(block); mc_idx != MC_BLOCKS) {
+      st.mc_hits++;
+      st.mc_dirty[mc_idx] = true;
+      st.mc_last_used[mc_idx] = ++st.mc_clock;
+    } else if (auto read = st.request(block); read != nullptr) {
+      read->dirty = true;
+    }
+  }
+  st.tu_ip[tu_idx] = ip;
+  st.tu_last[tu_idx] = cl_addr;
+
+  lookup(*this, st, cl_addr, DEGREE);
+
+  return metadata_in;
+}
+
+uint32_t CACHE::prefetcher_cache_fill(uint64_t addr, uint32_t set, uint32_t way, uint8_t prefetch, uint64_t evicted_addr, uint32_t metadata_in)
+{
+  return metadata_in;
+}
+
+void CACHE::prefetcher_cycle_operate()
+{
+  auto& st = *pref_state.get<triage_state>();
+
+  // install the metadata blocks that have returned, and resume the lookups waiting on them
+  while (!std::empty(st.port.returned)) {
+    uint64_t address = st.port.returned.front();
+    st.port.returned.pop_front();
+
+    auto found = std::find_if(std::begin(st.reads), std::end(st.reads), [address](const auto& x) { return x.issued && x.address == address; });
+    if (found == std::end(st.reads))
+      continue;
+
+    pending_read read = std::move(*found);
+    st.reads.erase(found);
+    st.mc_insert(read.block, read.dirty);
+    for (auto [cl_addr, degree] : read.lookups)
+      lookup(*this, st, cl_addr, degree);
+  }
+
+  // send the metadata reads and writes, as far as the lower level has room for them
+  for (auto& read : st.reads) {
+    if (read.issued)
+      continue;
+    if (st.target->get_occupancy(1, read.address) == st.target->get_size(1, read.address))
+      break;
+
+    PACKET packet;
+    packet.address = read.address;
+    packet.cpu = cpu;
+    packet.type = METADATA;
+    packet.fill_level = st.target->fill_level;
+    packet.to_return = {&st.port};
+
+    if (st.target->add_rq(&packet) == -2)
+      break;
+    read.issued = true;
+    st.reads_issued++;
+  }
+
+  while (!std::empty(st.writes)) {
+    uint64_t address = st.block_address(st.writes.front());
+    if (st.target->get_occupancy(2, address) == st.target->get_size(2, address))
+      break;
+
+    PACKET packet;
+    packet.address = address;
+    packet.cpu = cpu;
+    packet.type = WRITEBACK;
+    packet.fill_level = st.target->fill_level;
+    packet.dirty = true; // the metadata block was modified here
+
+    if (st.target->add_wq(&packet) == -2)
+      break;
+    st.writes.pop_front();
+    st.writes_issued++;
+  }
+}
+
+void CACHE::prefetcher_final_stats()
+{
+  auto& st = *pref_state.get<triage_state>();
+  std::cout << NAME << " TRIAGE TRIGGERS: " << st.triggers << " TRAINED: " << st.trained << " PREDICTIONS: " << st.predictions << std::endl;
+  std::cout << NAME << " TRIAGE METADATA CACHE HITS: " << st.mc_hits << " MISSES: " << st.mc_misses << " READS: " << st.reads_issued
+            << " WRITES: " << st.writes_issued << " DROPPED: " << st.reads_dropped << std::endl;
+}
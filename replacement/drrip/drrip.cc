@@ -1,6 +1,6 @@
 #include <algorithm>
-#include <map>
-#include <utility>
+#include <array>
+#include <vector>
 
 #include "cache.h"
 
@@ -13,25 +13,32 @@
 #define PSEL_MAX ((1 << PSEL_WIDTH) - 1)
 #define PSEL_THRS PSEL_MAX / 2
 
-std::map<CACHE*, unsigned> bip_counter;
-std::map<CACHE*, std::vector<std::size_t>> rand_sets;
-std::map<std::pair<CACHE*, std::size_t>, unsigned> PSEL;
+namespace
+{
+struct drrip_state {
+  unsigned bip_counter = 0;
+  std::vector<std::size_t> rand_sets;
+  std::array<unsigned, NUM_CPUS> PSEL = {};
+};
+} // namespace
 
 void CACHE::initialize_replacement()
 {
+  auto& st = *repl_state.emplace<drrip_state>();
+
   // randomly selected sampler sets
   std::size_t rand_seed = 1103515245 + 12345;
   for (std::size_t i = 0; i < TOTAL_SDM_SETS; i++) {
     std::size_t val = (rand_seed / 65536) % NUM_SET;
-    auto loc = std::lower_bound(std::begin(rand_sets[this]), std::end(rand_sets[this]), val);
+    auto loc = std::lower_bound(std::begin(st.rand_sets), std::end(st.rand_sets), val);
 
-    while (loc != std::end(rand_sets[this]) && *loc == val) {
+    while (loc != std::end(st.rand_sets) && *loc == val) {
       rand_seed = rand_seed * 1103515245 + 12345;
       val = (rand_seed / 65536) % NUM_SET;
-      loc = std::lower_bound(std::begin(rand_sets[this]), std::end(rand_sets[this]), val);
+      loc = std::lower_bound(std::begin(st.rand_sets), std::end(st.rand_sets), val);
     }
 
-    rand_sets[this].insert(loc, val);
+    st.rand_sets.insert(loc, val);
   }
 }
 
@@ -53,20 +60,21 @@ void CACHE::update_replacement_state(uint32_t cpu, uint32_t set, uint32_t way, u
   }
 
   // cache miss
-  auto begin = std::next(std::begin(rand_sets[this]), cpu * NUM_POLICY * SDM_SIZE);
+  auto& st = *repl_state.get<drrip_state>();
+  auto begin = std::next(std::begin(st.rand_sets), cpu * NUM_POLICY * SDM_SIZE);
   auto end = std::next(begin, NUM_POLICY * SDM_SIZE);
   auto leader = std::find(begin, end, set);
 
   if (leader == end) // follower sets
   {
-    if (PSEL[std::make_pair(this, cpu)] > PSEL_THRS) // follow BIP
+    if (st.PSEL[cpu] > PSEL_THRS) // follow BIP
     {
       block[set * NUM_WAY + way].lru = maxRRPV;
 
-      bip_counter[this]++;
-      if (bip_counter[this] == BIP_MAX)
-        bip_counter[this] = 0;
-      if (bip_counter[this] == 0)
+      st.bip_counter++;
+      if (st.bip_counter == BIP_MAX)
+        st.bip_counter = 0;
+      if (st.bip_counter == 0)
         block[set * NUM_WAY + way].lru = maxRRPV - 1;
     } else // follow SRRIP
     {
@@ -74,19 +82,19 @@ void CACHE::update_replacement_state(uint32_t cpu, uint32_t set, uint32_t way, u
     }
   } else if (leader == begin) // leader 0: BIP
   {
-    if (PSEL[std::make_pair(this, cpu)] > 0)
-      PSEL[std::make_pair(this, cpu)]--;
+    if (st.PSEL[cpu] > 0)
+      st.PSEL[cpu]--;
     block[set * NUM_WAY + way].lru = maxRRPV;
 
-    bip_counter[this]++;
-    if (bip_counter[this] == BIP_MAX)
-      bip_counter[this] = 0;
-    if (bip_counter[this] == 0)
+    st.bip_counter++;
+    if (st.bip_counter == BIP_MAX)
+      st.bip_counter = 0;
+    if (st.bip_counter == 0)
       block[set * NUM_WAY + way].lru = maxRRPV - 1;
   } else if (leader == std::next(begin)) // leader 1: SRRIP
   {
-    if (PSEL[std::make_pair(this, cpu)] < PSEL_MAX)
-      PSEL[std::make_pair(this, cpu)]++;
+    if (st.PSEL[cpu] < PSEL_MAX)
+      st.PSEL[cpu]++;
     block[set * NUM_WAY + way].lru = maxRRPV - 1;
   }
 }
@@ -1,7 +1,5 @@
 #include <algorithm>
 #include <array>
-#include <map>
-#include <utility>
 #include <vector>
 
 #include "cache.h"
@@ -12,6 +10,8 @@
 #define SAMPLER_SET (256 * NUM_CPUS)
 #define SHCT_MAX 7
 
+namespace
+{
 // sampler structure
 class SAMPLER_class
 {
@@ -22,33 +22,34 @@ public:
   uint32_t lru = 9999999;
 };
 
-// sampler
-std::map<CACHE*, std::vector<std::size_t>> rand_sets;
-std::map<CACHE*, std::vector<SAMPLER_class>> sampler;
-
-// prediction table structure
-std::map<std::pair<CACHE*, std::size_t>, std::array<unsigned, SHCT_SIZE>> SHCT;
+struct ship_state {
+  std::vector<std::size_t> rand_sets; // randomly selected sampler sets
+  std::vector<SAMPLER_class> sampler;
+  std::array<std::array<unsigned, SHCT_SIZE>, NUM_CPUS> SHCT = {}; // prediction table
+};
+} // namespace
 
 // initialize replacement state
 void CACHE::initialize_replacement()
 {
+  auto& st = *repl_state.emplace<ship_state>();
+
   // randomly selected sampler sets
   std::size_t rand_seed = 1103515245 + 12345;
-  ;
   for (std::size_t i = 0; i < SAMPLER_SET; i++) {
     std::size_t val = (rand_seed / 65536) % NUM_SET;
-    std::vector<std::size_t>::iterator loc = std::lower_bound(std::begin(rand_sets[this]), std::end(rand_sets[this]), val);
+    std::vector<std::size_t>::iterator loc = std::lower_bound(std::begin(st.rand_sets), std::end(st.rand_sets), val);
 
-    while (loc != std::end(rand_sets[this]) && *loc == val) {
+    while (loc != std::end(st.rand_sets) && *loc == val) {
       rand_seed = rand_seed * 1103515245 + 12345;
       val = (rand_seed / 65536) % NUM_SET;
-      loc = std::lower_bound(std::begin(rand_sets[this]), std::end(rand_sets[this]), val);
+      loc = std::lower_bound(std::begin(st.rand_sets), std::end(st.rand_sets), val);
     }
 
-    rand_sets[this].insert(loc, val);
+    st.rand_sets.insert(loc, val);
   }
 
-  sampler.emplace(this, SAMPLER_SET * NUM_WAY);
+  st.sampler.resize(SAMPLER_SET * NUM_WAY);
 }
 
 // find replacement victim
@@ -72,6 +73,9 @@ uint32_t CACHE::find_victim(uint32_t cpu, uint64_t instr_id, uint32_t set, const
 void CACHE::update_replacement_state(uint32_t cpu, uint32_t set, uint32_t way, uint64_t full_addr, uint64_t ip, uint64_t victim_addr, uint32_t type,
                                      uint8_t hit)
 {
+  auto& st = *repl_state.get<ship_state>();
+  auto& SHCT = st.SHCT[cpu];
+
   // handle writeback access
   if (type == WRITEBACK) {
     if (!hit)
@@ -81,17 +85,17 @@ void CACHE::update_replacement_state(uint32_t cpu, uint32_t set, uint32_t way, u
   }
 
   // update sampler
-  auto s_idx = std::find(std::begin(rand_sets[this]), std::end(rand_sets[this]), set);
-  if (s_idx != std::end(rand_sets[this])) {
-    auto s_set_begin = std::next(std::begin(sampler[this]), std::distance(std::begin(rand_sets[this]), s_idx));
+  auto s_idx = std::find(std::begin(st.rand_sets), std::end(st.rand_sets), set);
+  if (s_idx != std::end(st.rand_sets)) {
+    auto s_set_begin = std::next(std::begin(st.sampler), std::distance(std::begin(st.rand_sets), s_idx));
     auto s_set_end = std::next(s_set_begin, NUM_WAY);
 
     // check hit
     auto match = std::find_if(s_set_begin, s_set_end, eq_addr<SAMPLER_class>(full_addr, 8 + lg2(NUM_WAY)));
     if (match != s_set_end) {
       uint32_t SHCT_idx = match->ip % SHCT_PRIME;
-      if (SHCT[std::make_pair(this, cpu)][SHCT_idx] > 0)
-        SHCT[std::make_pair(this, cpu)][SHCT_idx]--;
+      if (SHCT[SHCT_idx] > 0)
+        SHCT[SHCT_idx]--;
 
       match->type = type;
       match->used = 1;
@@ -100,8 +104,8 @@ void CACHE::update_replacement_state(uint32_t cpu, uint32_t set, uint32_t way, u
 
       if (match->used) {
         uint32_t SHCT_idx = match->ip % SHCT_PRIME;
-        if (SHCT[std::make_pair(this, cpu)][SHCT_idx] < SHCT_MAX)
-          SHCT[std::make_pair(this, cpu)][SHCT_idx]++;
+        if (SHCT[SHCT_idx] < SHCT_MAX)
+          SHCT[SHCT_idx]++;
       }
 
       match->valid = 1;
@@ -124,7 +128,7 @@ void CACHE::update_replacement_state(uint32_t cpu, uint32_t set, uint32_t way, u
     uint32_t SHCT_idx = ip % SHCT_PRIME;
 
     block[set * NUM_WAY + way].lru = maxRRPV - 1;
-    if (SHCT[std::make_pair(this, cpu)][SHCT_idx] == SHCT_MAX)
+    if (SHCT[SHCT_idx] == SHCT_MAX)
       block[set * NUM_WAY + way].lru = maxRRPV;
   }
 }
@@ -0,0 +1,106 @@
+/*
+ * Replays the branches of a trace through the branch predictor and BTB modules of the first configured core, without
+ * simulating the rest of the core or the memory system. Each branch is classified as in O3_CPU::init_instruction, predicted,
+ * and trained with its outcome immediately, which is also the order in which the full simulator calls the modules.
+ *
+ * Usage: bpred_replay [-w warmup_instructions] [-i simulation_instructions] [-c] trace
+ *
+ * The statistics cover the simulation instructions only.
+ */
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <getopt.h>
+#include <iostream>
+
+#include "champsim.h"
+#include "champsim_constants.h"
+#include "ooo_cpu.h"
+#include "tracereader.h"
+
+uint8_t warmup_complete[NUM_CPUS] = {}, all_warmup_complete = 0, MAX_INSTR_DESTINATIONS = NUM_INSTR_DESTINATIONS;
+
+champsim::deprecated_clock_cycle current_core_cycle;
+
+extern std::array<O3_CPU*, NUM_CPUS> ooo_cpu;
+
+uint64_t champsim::deprecated_clock_cycle::operator[](std::size_t cpu_idx) { return ooo_cpu[cpu_idx]->current_cycle; }
+
+int main(int argc, char** argv)
+{
+  uint64_t warmup_instructions = 1000000, simulation_instructions = 10000000;
+  bool cloudsuite = false;
+
+  int c;
+  while ((c = getopt(argc, argv, "w:i:c")) != -1) {
+    switch (c) {
+    case 'w':
+      warmup_instructions = atol(optarg);
+      break;
+    case 'i':
+      simulation_instructions = atol(optarg);
+      break;
+    case 'c':
+      cloudsuite = true;
+      MAX_INSTR_DESTINATIONS = NUM_INSTR_DESTINATIONS_SPARC;
+      break;
+    default:
+      abort();
+    }
+  }
+
+  if (optind != argc - 1) {
+    std::cerr << "usage: " << argv[0] << " [-w warmup_instructions] [-i simulation_instructions] [-c] trace" << std::endl;
+    return 1;
+  }
+
+  tracereader* trace = get_tracereader(argv[optind], 0, cloudsuite);
+  O3_CPU& cpu = *ooo_cpu[0];
+  cpu.initialize_core();
+
+  auto start = std::chrono::steady_clock::now();
+  for (uint64_t instr_count = 0; instr_count < warmup_instructions + simulation_instructions; ++instr_count) {
+    if (instr_count == warmup_instructions) {
+      warmup_complete[0] = 1;
+      all_warmup_complete = 1;
+      cpu.num_branch = 0;
+      cpu.branch_mispredictions = 0;
+      std::fill(std::begin(cpu.total_branch_types), std::end(cpu.total_branch_types), 0);
+      std::fill(std::begin(cpu.branch_type_misses), std::end(cpu.branch_type_misses), 0);
+    }
+
+    ooo_model_instr instr = trace->get();
+    decode_branch(instr, get_register_usage(instr));
+    cpu.total_branch_types[instr.branch_type]++;
+    if (!instr.is_branch)
+      continue;
+
+    cpu.num_branch++;
+    if (cpu.get_predicted_target(instr) != instr.branch_target) {
+      cpu.branch_mispredictions++;
+      cpu.branch_type_misses[instr.branch_type]++;
+    }
+
+    cpu.impl_update_btb(instr.ip, instr.branch_target, instr.branch_taken, instr.branch_type);
+    cpu.impl_last_branch_result(instr.ip, instr.branch_target, instr.branch_taken, instr.branch_type);
+  }
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+  std::cout << std::endl;
+  std::cout << "CPU 0 Branch Prediction Accuracy: " << (100.0 * (cpu.num_branch - cpu.branch_mispredictions)) / cpu.num_branch;
+  std::cout << "% MPKI: " << (1000.0 * cpu.branch_mispredictions) / simulation_instructions << std::endl;
+
+  std::cout << "Branch type MPKI" << std::endl;
+  std::cout << "BRANCH_DIRECT_JUMP: " << (1000.0 * cpu.branch_type_misses[BRANCH_DIRECT_JUMP] / simulation_instructions) << std::endl;
+  std::cout << "BRANCH_INDIRECT: " << (1000.0 * cpu.branch_type_misses[BRANCH_INDIRECT] / simulation_instructions) << std::endl;
+  std::cout << "BRANCH_CONDITIONAL: " << (1000.0 * cpu.branch_type_misses[BRANCH_CONDITIONAL] / simulation_instructions) << std::endl;
+  std::cout << "BRANCH_DIRECT_CALL: " << (1000.0 * cpu.branch_type_misses[BRANCH_DIRECT_CALL] / simulation_instructions) << std::endl;
+  std::cout << "BRANCH_INDIRECT_CALL: " << (1000.0 * cpu.branch_type_misses[BRANCH_INDIRECT_CALL] / simulation_instructions) << std::endl;
+  std::cout << "BRANCH_RETURN: " << (1000.0 * cpu.branch_type_misses[BRANCH_RETURN] / simulation_instructions) << std::endl << std::endl;
+
+  std::cout << "Replayed " << (warmup_instructions + simulation_instructions) << " instructions in " << elapsed.count() << " seconds (";
+  std::cout << (warmup_instructions + simulation_instructions) / elapsed.count() / 1e6 << " million instructions per second)" << std::endl;
+
+  return 0;
+}
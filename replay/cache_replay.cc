@@ -0,0 +1,258 @@
+/*
+ * Replays the accesses recorded from a cache (with "record": true in its configuration) through the prefetcher and replacement
+ * modules configured for the cache of the same name, on a functional model of its tag array. There is no timing: a miss is
+ * filled as soon as it is seen, and the prefetches issued for an access, including those from the prefetcher's cycle operation,
+ * are filled before the next access. Each access and each cycle given to the prefetcher advances the cache's clock by one.
+ * Prefetches to virtual addresses are translated with the pages seen in the recording, and dropped if their page was never seen.
+ *
+ * Usage: cache_replay [-w warmup_accesses] [-i simulation_accesses] recording
+ *
+ * The statistics cover the accesses after the warmup, up to the end of the recording.
+ */
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <getopt.h>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <unordered_map>
+
+#include "cache.h"
+#include "champsim.h"
+#include "champsim_constants.h"
+#include "util.h"
+
+uint8_t warmup_complete[NUM_CPUS] = {}, all_warmup_complete = 0, MAX_INSTR_DESTINATIONS = NUM_INSTR_DESTINATIONS;
+
+champsim::deprecated_clock_cycle current_core_cycle;
+
+extern std::array<CACHE*, NUM_CACHES> caches;
+
+uint64_t champsim::deprecated_clock_cycle::operator[](std::size_t cpu_idx) { return ooo_cpu[cpu_idx]->current_cycle; }
+
+namespace
+{
+using record = champsim::access_recorder::record;
+
+// the most cycles given to the prefetcher after each access to issue what it has queued
+constexpr unsigned MAX_PREFETCH_CYCLES = 64;
+
+struct replay_stats {
+  uint64_t accesses = 0, demand_accesses = 0, demand_misses = 0, recorded_demand_misses = 0;
+};
+
+// the virtual page to physical page mapping seen in the recording
+std::unordered_map<uint64_t, uint64_t> page_map;
+
+uint64_t block_base(const CACHE& cache, uint64_t address) { return address & ~bitmask(cache.match_offset_bits ? 0 : cache.OFFSET_BITS); }
+
+void fill(CACHE& cache, uint32_t set, uint64_t address, uint64_t v_address, uint64_t ip, uint8_t type, uint32_t cpu, bool prefetch)
+{
+  auto set_begin = std::next(std::begin(cache.block), set * cache.NUM_WAY);
+  auto set_end = std::next(set_begin, cache.NUM_WAY);
+  uint32_t way = std::distance(set_begin, std::find_if_not(set_begin, set_end, is_valid<BLOCK>()));
+  if (way == cache.NUM_WAY)
+    way = cache.impl_replacement_find_victim(cpu, 0, set, &cache.block.data()[set * cache.NUM_WAY], ip, address, type);
+  if (way == cache.NUM_WAY)
+    return; // bypassed
+
+  BLOCK& fill_block = cache.block[set * cache.NUM_WAY + way];
+  uint64_t evicting_address = block_base(cache, cache.ever_seen_data ? fill_block.address : fill_block.v_address);
+  if (fill_block.prefetch)
+    cache.pf_useless++;
+  if (prefetch)
+    cache.pf_fill++;
+
+  fill_block.valid = true;
+  fill_block.prefetch = prefetch;
+  fill_block.dirty = (type == WRITEBACK);
+  fill_block.address = address;
+  fill_block.v_address = v_address;
+  fill_block.ip = ip;
+  fill_block.cpu = cpu;
+
+  cache.cpu = cpu;
+  cache.impl_prefetcher_cache_fill(block_base(cache, cache.virtual_prefetch ? v_address : address), set, way, prefetch, evicting_address, 0);
+  cache.impl_replacement_update_state(cpu, set, way, address, ip, 0, type, 0);
+}
+
+// fill the prefetches that the last access issued, and any that they issue in turn
+void drain_prefetches(CACHE& cache)
+{
+  while (!std::empty(cache.VAPQ) || !std::empty(cache.PQ)) {
+    if (!std::empty(cache.VAPQ)) {
+      PACKET pf_packet = cache.VAPQ.front();
+      cache.VAPQ.pop_front();
+
+      auto ppage = page_map.find(pf_packet.v_address >> LOG2_PAGE_SIZE);
+      if (ppage == std::end(page_map)) {
+        cache.VA_DROPPED++;
+        continue;
+      }
+
+      cache.VA_TRANSLATED++;
+      pf_packet.address = splice_bits(ppage->second << LOG2_PAGE_SIZE, pf_packet.v_address, LOG2_PAGE_SIZE);
+      if (cache.is_sampled_set(pf_packet.address) && cache.add_pq(&pf_packet) > 0)
+        cache.pf_issued++;
+      continue;
+    }
+
+    PACKET pf_packet = cache.PQ.front();
+    cache.PQ.pop_front();
+
+    uint32_t set = cache.get_set(pf_packet.address);
+    uint32_t way = cache.get_way(pf_packet.address, set);
+    if (way < cache.NUM_WAY)
+      cache.impl_replacement_update_state(pf_packet.cpu, set, way, pf_packet.address, pf_packet.ip, 0, PREFETCH, 1);
+    else if (pf_packet.fill_level <= cache.fill_level)
+      fill(cache, set, pf_packet.address, pf_packet.v_address, pf_packet.ip, PREFETCH, pf_packet.cpu, true);
+  }
+}
+
+void access(CACHE& cache, const record& r, replay_stats& stats)
+{
+  if (r.v_address != 0)
+    page_map[r.v_address >> LOG2_PAGE_SIZE] = r.address >> LOG2_PAGE_SIZE;
+
+  if (!cache.is_sampled_set(r.address))
+    return;
+
+  uint32_t set = cache.get_set(r.address);
+  uint32_t way = cache.get_way(r.address, set);
+  bool hit = (way < cache.NUM_WAY);
+
+  cache.current_cycle++;
+  stats.accesses++;
+  if (r.type != PREFETCH && r.type != WRITEBACK && r.type != METADATA) {
+    stats.demand_accesses++;
+    stats.demand_misses += !hit;
+    stats.recorded_demand_misses += !r.hit;
+  }
+
+  if (r.type == WRITEBACK) {
+    if (hit) {
+      cache.impl_replacement_update_state(r.cpu, set, way, r.address, r.ip, 0, r.type, 1);
+      cache.block[set * cache.NUM_WAY + way].dirty = true;
+    } else {
+      fill(cache, set, r.address, r.v_address, r.ip, r.type, r.cpu, false);
+    }
+    return;
+  }
+
+  cache.ever_seen_data |= (r.v_address != r.ip);
+
+  if (cache.should_activate_prefetcher(r.type)) {
+    cache.cpu = r.cpu;
+    cache.impl_prefetcher_cache_operate(block_base(cache, cache.virtual_prefetch ? r.v_address : r.address), r.ip, hit, r.type, 0);
+  }
+
+  if (hit) {
+    BLOCK& hit_block = cache.block[set * cache.NUM_WAY + way];
+    cache.impl_replacement_update_state(r.cpu, set, way, hit_block.address, r.ip, 0, r.type, 1);
+    if (hit_block.prefetch) {
+      cache.pf_useful++;
+      hit_block.prefetch = false;
+    }
+  } else {
+    fill(cache, set, r.address, r.v_address, r.ip, r.type, r.cpu, false);
+  }
+
+  drain_prefetches(cache);
+
+  // prefetchers that issue from prefetcher_cycle_operate() run until they go quiet
+  for (unsigned i = 0; i < MAX_PREFETCH_CYCLES; ++i) {
+    uint64_t requested = cache.pf_requested;
+    cache.current_cycle++;
+    cache.impl_prefetcher_cycle_operate();
+    drain_prefetches(cache);
+    if (cache.pf_requested == requested)
+      break;
+  }
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+  uint64_t warmup_accesses = 0, simulation_accesses = std::numeric_limits<uint64_t>::max();
+
+  int c;
+  while ((c = getopt(argc, argv, "w:i:")) != -1) {
+    switch (c) {
+    case 'w':
+      warmup_accesses = atol(optarg);
+      break;
+    case 'i':
+      simulation_accesses = atol(optarg);
+      break;
+    default:
+      abort();
+    }
+  }
+
+  if (optind != argc - 1) {
+    std::cerr << "usage: " << argv[0] << " [-w warmup_accesses] [-i simulation_accesses] recording" << std::endl;
+    return 1;
+  }
+
+  std::ifstream recording{argv[optind], std::ios::binary};
+  champsim::access_recorder::header hdr;
+  if (!recording.read(reinterpret_cast<char*>(&hdr), sizeof(hdr)) || !std::equal(std::begin(hdr.magic), std::end(hdr.magic), champsim::access_recorder::MAGIC)) {
+    std::cerr << argv[optind] << " is not a cache access recording" << std::endl;
+    return 1;
+  }
+
+  auto found = std::find_if(std::begin(caches), std::end(caches), [&hdr](CACHE* x) { return x->NAME == hdr.name; });
+  if (found == std::end(caches) || (*found)->NUM_SET != hdr.sets || (*found)->NUM_WAY != hdr.ways || (*found)->OFFSET_BITS != hdr.offset_bits
+      || (*found)->virtual_prefetch != static_cast<bool>(hdr.virtual_prefetch)) {
+    std::cerr << "The configuration has no cache " << hdr.name << " with " << hdr.sets << " sets and " << hdr.ways << " ways, as recorded" << std::endl;
+    return 1;
+  }
+
+  CACHE& cache = **found;
+  cache.impl_prefetcher_initialize();
+  cache.impl_replacement_initialize();
+
+  replay_stats stats;
+  std::vector<record> buffer(1 << 16);
+  uint64_t count = 0, total = warmup_accesses + std::min(simulation_accesses, std::numeric_limits<uint64_t>::max() - warmup_accesses);
+
+  auto start = std::chrono::steady_clock::now();
+  while (count < total && recording) {
+    recording.read(reinterpret_cast<char*>(std::data(buffer)), std::size(buffer) * sizeof(record));
+    std::size_t n = recording.gcount() / sizeof(record);
+
+    for (std::size_t i = 0; i < n && count < total; ++i, ++count) {
+      if (count == warmup_accesses) {
+        std::fill(std::begin(warmup_complete), std::end(warmup_complete), 1);
+        all_warmup_complete = 1;
+        stats = {};
+        cache.pf_requested = cache.pf_issued = cache.pf_useful = cache.pf_useless = cache.pf_fill = 0;
+      }
+
+      access(cache, buffer[i], stats);
+    }
+  }
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+  std::cout << cache.NAME << " REPLAY ACCESS: " << std::setw(10) << stats.accesses << "  DEMAND ACCESS: " << std::setw(10) << stats.demand_accesses
+            << "  DEMAND MISS: " << std::setw(10) << stats.demand_misses << std::endl;
+  std::cout << cache.NAME << " MISS RATIO: " << (stats.demand_accesses ? 1.0 * stats.demand_misses / stats.demand_accesses : 0)
+            << "  RECORDED MISS RATIO: " << (stats.demand_accesses ? 1.0 * stats.recorded_demand_misses / stats.demand_accesses : 0) << std::endl;
+  std::cout << cache.NAME << " PREFETCH  REQUESTED: " << std::setw(10) << cache.pf_requested << "  ISSUED: " << std::setw(10) << cache.pf_issued;
+  std::cout << "  USEFUL: " << std::setw(10) << cache.pf_useful << "  USELESS: " << std::setw(10) << cache.pf_useless << std::endl;
+  std::cout << cache.NAME << " PREFETCH ACCURACY: " << (cache.pf_fill ? 1.0 * cache.pf_useful / cache.pf_fill : 0);
+  std::cout << "  COVERAGE: " << ((cache.pf_useful + stats.demand_misses) ? 1.0 * cache.pf_useful / (cache.pf_useful + stats.demand_misses) : 0) << std::endl;
+  std::cout << std::endl;
+
+  cache.impl_prefetcher_final_stats();
+  cache.impl_replacement_final_stats();
+
+  std::cout << "Replayed " << count << " accesses in " << elapsed.count() << " seconds (" << count / elapsed.count() / 1e6
+            << " million accesses per second)" << std::endl;
+
+  return 0;
+}
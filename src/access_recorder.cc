@@ -0,0 +1,48 @@
+#include "access_recorder.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace champsim
+{
+
+access_recorder::access_recorder(const std::string& fname, const std::string& name, uint32_t sets, uint32_t ways, uint32_t offset_bits,
+                                 bool virtual_prefetch)
+    : fname(fname)
+{
+  std::copy(std::begin(MAGIC), std::end(MAGIC), std::begin(hdr.magic));
+  std::strncpy(hdr.name, name.c_str(), sizeof(hdr.name) - 1);
+  hdr.sets = sets;
+  hdr.ways = ways;
+  hdr.offset_bits = offset_bits;
+  hdr.virtual_prefetch = virtual_prefetch;
+
+  buffer.reserve(BUFFER_SIZE);
+}
+
+void access_recorder::record_access(uint64_t address, uint64_t v_address, uint64_t ip, uint8_t type, uint32_t cpu, bool hit)
+{
+  buffer.push_back({address, v_address, ip, type, static_cast<uint8_t>(cpu), hit, {}});
+  if (std::size(buffer) == BUFFER_SIZE)
+    flush();
+}
+
+void access_recorder::flush()
+{
+  // the file is created on the first write, so that programs sharing the configuration, like the replay, do not truncate it
+  if (!file.is_open()) {
+    file.open(fname, std::ios::binary);
+    file.write(reinterpret_cast<const char*>(&hdr), sizeof(hdr));
+  }
+
+  file.write(reinterpret_cast<const char*>(std::data(buffer)), std::size(buffer) * sizeof(record));
+  buffer.clear();
+}
+
+void access_recorder::close()
+{
+  flush();
+  file.close();
+}
+
+} // namespace champsim
@@ -2,9 +2,11 @@
 
 #include <algorithm>
 #include <iterator>
+#include <utility>
 
 #include "champsim.h"
 #include "champsim_constants.h"
+#include "dram_controller.h"
 #include "util.h"
 #include "vmem.h"
 
@@ -13,6 +15,7 @@
 #endif
 
 extern VirtualMemory vmem;
+extern MEMORY_ROUTER DRAM;
 extern uint8_t warmup_complete[NUM_CPUS];
 
 void CACHE::handle_fill()
@@ -22,6 +25,17 @@ void CACHE::handle_fill()
     if (fill_mshr == std::end(MSHR) || fill_mshr->event_cycle > current_cycle)
       return;
 
+    if (fill_mshr->page_level > 0 && HUGE_WAY > 0) {
+      huge_page_fill(*fill_mshr);
+
+      for (auto ret : fill_mshr->to_return)
+        ret->return_data(&(*fill_mshr));
+
+      MSHR.erase(fill_mshr);
+      writes_available_this_cycle--;
+      continue;
+    }
+
     // find victim
     uint32_t set = get_set(fill_mshr->address);
 
@@ -29,7 +43,11 @@ void CACHE::handle_fill()
     auto set_end = std::next(set_begin, NUM_WAY);
     auto first_inv = std::find_if_not(set_begin, set_end, is_valid<BLOCK>());
     uint32_t way = std::distance(set_begin, first_inv);
-    if (way == NUM_WAY)
+
+    // an exclusive cache is filled only by victims from above, so data on its way up bypasses it
+    if (inclusion_policy == inclusion_t::EXCLUSIVE && !fill_mshr->to_return.empty())
+      way = NUM_WAY;
+    else if (way == NUM_WAY)
       way = impl_replacement_find_victim(fill_mshr->cpu, fill_mshr->instr_id, set, &block.data()[set * NUM_WAY], fill_mshr->ip, fill_mshr->address,
                                          fill_mshr->type);
 
@@ -40,11 +58,12 @@ void CACHE::handle_fill()
     if (way != NUM_WAY) {
       // update processed packets
       fill_mshr->data = block[set * NUM_WAY + way].data;
-
-      for (auto ret : fill_mshr->to_return)
-        ret->return_data(&(*fill_mshr));
+      fill_mshr->dirty = false; // this level now holds the modified data
     }
 
+    for (auto ret : fill_mshr->to_return)
+      ret->return_data(&(*fill_mshr));
+
     MSHR.erase(fill_mshr);
     writes_available_this_cycle--;
   }
@@ -59,22 +78,36 @@ void CACHE::handle_writeback()
     // handle the oldest entry
     PACKET& handle_pkt = WQ.front();
 
+    if (!is_sampled_set(handle_pkt.address)) {
+      if (!unsampled_access(handle_pkt))
+        return;
+
+      writes_available_this_cycle--;
+      WQ.pop_front();
+      continue;
+    }
+
     // access cache
     uint32_t set = get_set(handle_pkt.address);
     uint32_t way = get_way(handle_pkt.address, set);
 
-    BLOCK& fill_block = block[set * NUM_WAY + way];
-
     if (way < NUM_WAY) // HIT
     {
+      BLOCK& fill_block = block[set * NUM_WAY + way];
+
       impl_replacement_update_state(handle_pkt.cpu, set, way, fill_block.address, handle_pkt.ip, 0, handle_pkt.type, 1);
 
       // COLLECT STATS
       sim_hit[handle_pkt.cpu][handle_pkt.type]++;
       sim_access[handle_pkt.cpu][handle_pkt.type]++;
-
-      // mark dirty
-      fill_block.dirty = 1;
+      if (profiler)
+        profiler->record_access(set, handle_pkt.address >> OFFSET_BITS, handle_pkt.ip, handle_pkt.type, true);
+      if (recorder)
+        recorder->record_access(handle_pkt.address, handle_pkt.v_address, handle_pkt.ip, handle_pkt.type, handle_pkt.cpu, true);
+
+      // mark dirty, unless this is a clean victim sent to an exclusive cache
+      if (handle_pkt.type != WRITEBACK || handle_pkt.dirty)
+        fill_block.dirty = 1;
     } else // MISS
     {
       bool success;
@@ -91,6 +124,8 @@ void CACHE::handle_writeback()
                                              handle_pkt.type);
 
         success = filllike_miss(set, way, handle_pkt);
+        if (success && recorder)
+          recorder->record_access(handle_pkt.address, handle_pkt.v_address, handle_pkt.ip, handle_pkt.type, handle_pkt.cpu, false);
       }
 
       if (!success)
@@ -117,13 +152,22 @@ void CACHE::handle_read()
     // vaddr to the prefetcher
     ever_seen_data |= (handle_pkt.v_address != handle_pkt.ip);
 
+    if (!is_sampled_set(handle_pkt.address)) {
+      if (!unsampled_access(handle_pkt))
+        return;
+
+      RQ.pop_front();
+      reads_available_this_cycle--;
+      continue;
+    }
+
     uint32_t set = get_set(handle_pkt.address);
     uint32_t way = get_way(handle_pkt.address, set);
 
     if (way < NUM_WAY) // HIT
     {
       readlike_hit(set, way, handle_pkt);
-    } else {
+    } else if (!huge_page_hit(handle_pkt)) {
       bool success = readlike_miss(handle_pkt);
       if (!success)
         return;
@@ -144,13 +188,22 @@ void CACHE::handle_prefetch()
     // handle the oldest entry
     PACKET& handle_pkt = PQ.front();
 
+    if (!is_sampled_set(handle_pkt.address)) {
+      if (!unsampled_access(handle_pkt))
+        return;
+
+      PQ.pop_front();
+      reads_available_this_cycle--;
+      continue;
+    }
+
     uint32_t set = get_set(handle_pkt.address);
     uint32_t way = get_way(handle_pkt.address, set);
 
     if (way < NUM_WAY) // HIT
     {
       readlike_hit(set, way, handle_pkt);
-    } else {
+    } else if (!huge_page_hit(handle_pkt)) {
       bool success = readlike_miss(handle_pkt);
       if (!success)
         return;
@@ -162,6 +215,82 @@ void CACHE::handle_prefetch()
   }
 }
 
+void CACHE::handle_unsampled()
+{
+  while (UNSAMPLED.has_ready()) {
+    PACKET& handle_pkt = UNSAMPLED.front();
+    for (auto ret : handle_pkt.to_return)
+      ret->return_data(&handle_pkt);
+
+    UNSAMPLED.pop_front();
+  }
+}
+
+bool CACHE::unsampled_access(PACKET& handle_pkt)
+{
+  // Writes are absorbed. Reads are answered after a fixed latency, without touching the tag array, the modules, or the lower level.
+  if (!handle_pkt.to_return.empty()) {
+    if (UNSAMPLED.full())
+      return false;
+
+    if (warmup_complete[handle_pkt.cpu])
+      UNSAMPLED.push_back(handle_pkt);
+    else
+      UNSAMPLED.push_back_ready(handle_pkt);
+  }
+
+  UNSAMPLED_ACCESS++;
+  return true;
+}
+
+bool CACHE::huge_page_hit(PACKET& handle_pkt)
+{
+  if (HUGE_WAY == 0)
+    return false;
+
+  auto set_begin = std::next(std::begin(huge_block), ((handle_pkt.address >> LOG2_HUGE_PAGE_SIZE) & bitmask(lg2(HUGE_SET))) * HUGE_WAY);
+  auto set_end = std::next(set_begin, HUGE_WAY);
+  auto hit_block = std::find_if(set_begin, set_end, eq_addr<BLOCK>(handle_pkt.address, LOG2_HUGE_PAGE_SIZE));
+  if (hit_block == set_end)
+    return false;
+
+  std::for_each(set_begin, set_end, lru_updater<BLOCK>(hit_block));
+
+  handle_pkt.data = splice_bits(hit_block->data, handle_pkt.address, LOG2_HUGE_PAGE_SIZE);
+  handle_pkt.page_level = vmem.huge_page_level;
+
+  // COLLECT STATS
+  sim_hit[handle_pkt.cpu][handle_pkt.type]++;
+  sim_access[handle_pkt.cpu][handle_pkt.type]++;
+  HUGE_PAGE_HIT++;
+
+  for (auto ret : handle_pkt.to_return)
+    ret->return_data(&handle_pkt);
+
+  return true;
+}
+
+void CACHE::huge_page_fill(PACKET& handle_pkt)
+{
+  auto set_begin = std::next(std::begin(huge_block), ((handle_pkt.address >> LOG2_HUGE_PAGE_SIZE) & bitmask(lg2(HUGE_SET))) * HUGE_WAY);
+  auto set_end = std::next(set_begin, HUGE_WAY);
+  auto fill_block = std::max_element(set_begin, set_end, lru_comparator<BLOCK, BLOCK>());
+
+  fill_block->valid = true;
+  fill_block->address = handle_pkt.address;
+  fill_block->v_address = handle_pkt.v_address;
+  fill_block->data = handle_pkt.data;
+  fill_block->cpu = handle_pkt.cpu;
+  std::for_each(set_begin, set_end, lru_updater<BLOCK>(fill_block));
+
+  if (warmup_complete[handle_pkt.cpu] && (handle_pkt.cycle_enqueued != 0))
+    total_miss_latency += current_cycle - handle_pkt.cycle_enqueued;
+
+  // COLLECT STATS
+  sim_miss[handle_pkt.cpu][handle_pkt.type]++;
+  sim_access[handle_pkt.cpu][handle_pkt.type]++;
+}
+
 void CACHE::readlike_hit(std::size_t set, std::size_t way, PACKET& handle_pkt)
 {
   DP(if (warmup_complete[handle_pkt.cpu]) {
@@ -181,6 +310,8 @@ void CACHE::readlike_hit(std::size_t set, std::size_t way, PACKET& handle_pkt)
   if (should_activate_prefetcher(handle_pkt.type) && handle_pkt.pf_origin_level < fill_level) {
     cpu = handle_pkt.cpu;
     uint64_t pf_base_addr = (virtual_prefetch ? handle_pkt.v_address : handle_pkt.address) & ~bitmask(match_offset_bits ? 0 : OFFSET_BITS);
+    if (throttle)
+      throttle->begin_trigger(pf_base_addr >> LOG2_BLOCK_SIZE);
     handle_pkt.pf_metadata = impl_prefetcher_cache_operate(pf_base_addr, handle_pkt.ip, 1, handle_pkt.type, handle_pkt.pf_metadata);
   }
 
@@ -190,6 +321,17 @@ void CACHE::readlike_hit(std::size_t set, std::size_t way, PACKET& handle_pkt)
   // COLLECT STATS
   sim_hit[handle_pkt.cpu][handle_pkt.type]++;
   sim_access[handle_pkt.cpu][handle_pkt.type]++;
+  if (profiler)
+    profiler->record_access(set, handle_pkt.address >> OFFSET_BITS, handle_pkt.ip, handle_pkt.type, true);
+  if (recorder && (handle_pkt.type != PREFETCH || handle_pkt.pf_origin_level < fill_level))
+    recorder->record_access(handle_pkt.address, handle_pkt.v_address, handle_pkt.ip, handle_pkt.type, handle_pkt.cpu, true);
+
+  // an exclusive cache hands the block, and any modifications, to the level above
+  if (inclusion_policy == inclusion_t::EXCLUSIVE && !handle_pkt.to_return.empty()) {
+    handle_pkt.dirty = hit_block.dirty;
+    hit_block.valid = false;
+    hit_block.dirty = false;
+  }
 
   for (auto ret : handle_pkt.to_return)
     ret->return_data(&handle_pkt);
@@ -197,7 +339,13 @@ void CACHE::readlike_hit(std::size_t set, std::size_t way, PACKET& handle_pkt)
   // update prefetch stats and reset prefetch bit
   if (hit_block.prefetch) {
     pf_useful++;
+    if (throttle)
+      throttle->record_useful();
     hit_block.prefetch = 0;
+
+    if (!prefetch_listeners.empty())
+      notify_prefetch_listeners({prefetch_event::kind_t::PREFETCH_HIT, this, hit_block.address, handle_pkt.v_address, handle_pkt.ip, handle_pkt.cpu,
+                                 handle_pkt.type, true, false, 0});
   }
 }
 
@@ -226,10 +374,23 @@ bool CACHE::readlike_miss(PACKET& handle_pkt)
     packet_dep_merge(mshr_entry->instr_depend_on_me, handle_pkt.instr_depend_on_me);
     packet_dep_merge(mshr_entry->to_return, handle_pkt.to_return);
 
+    // a demand that merges with a metadata read is counted as the miss; the packet is kept, since the metadata is returned with it
+    if (mshr_entry->type == METADATA && handle_pkt.type != PREFETCH && handle_pkt.type != METADATA)
+      mshr_entry->type = handle_pkt.type;
+
     if (mshr_entry->type == PREFETCH && handle_pkt.type != PREFETCH) {
-      // Mark the prefetch as useful
-      if (mshr_entry->pf_origin_level == fill_level)
+      // Mark the prefetch as useful, though late
+      if (mshr_entry->pf_origin_level == fill_level) {
         pf_useful++;
+        if (throttle) {
+          throttle->record_useful();
+          throttle->record_late();
+        }
+
+        if (!prefetch_listeners.empty())
+          notify_prefetch_listeners({prefetch_event::kind_t::PREFETCH_HIT, this, mshr_entry->address, handle_pkt.v_address, handle_pkt.ip, handle_pkt.cpu,
+                                     handle_pkt.type, true, true, 0});
+      }
 
       uint64_t prior_event_cycle = mshr_entry->event_cycle;
       *mshr_entry = handle_pkt;
@@ -250,8 +411,9 @@ bool CACHE::readlike_miss(PACKET& handle_pkt)
       return false;
 
     // Allocate an MSHR
+    auto it = std::end(MSHR);
     if (handle_pkt.fill_level <= fill_level) {
-      auto it = MSHR.insert(std::end(MSHR), handle_pkt);
+      it = MSHR.insert(std::end(MSHR), handle_pkt);
       it->cycle_enqueued = current_cycle;
       it->event_cycle = std::numeric_limits<uint64_t>::max();
     }
@@ -261,19 +423,25 @@ bool CACHE::readlike_miss(PACKET& handle_pkt)
     else
       handle_pkt.to_return.clear();
 
-    if (!is_read)
+    if (!is_read) {
       lower_level->add_pq(&handle_pkt);
-    else
+    } else {
       lower_level->add_rq(&handle_pkt);
+    }
   }
 
   // update prefetcher on load instructions and prefetches from upper levels
   if (should_activate_prefetcher(handle_pkt.type) && handle_pkt.pf_origin_level < fill_level) {
     cpu = handle_pkt.cpu;
     uint64_t pf_base_addr = (virtual_prefetch ? handle_pkt.v_address : handle_pkt.address) & ~bitmask(match_offset_bits ? 0 : OFFSET_BITS);
+    if (throttle)
+      throttle->begin_trigger(pf_base_addr >> LOG2_BLOCK_SIZE);
     handle_pkt.pf_metadata = impl_prefetcher_cache_operate(pf_base_addr, handle_pkt.ip, 0, handle_pkt.type, handle_pkt.pf_metadata);
   }
 
+  if (recorder && (handle_pkt.type != PREFETCH || handle_pkt.pf_origin_level < fill_level))
+    recorder->record_access(handle_pkt.address, handle_pkt.v_address, handle_pkt.ip, handle_pkt.type, handle_pkt.cpu, false);
+
   return true;
 }
 
@@ -290,16 +458,23 @@ bool CACHE::filllike_miss(std::size_t set, std::size_t way, PACKET& handle_pkt)
 
   bool bypass = (way == NUM_WAY);
 #ifndef LLC_BYPASS
-  assert(!bypass);
+  assert(!bypass || inclusion_policy == inclusion_t::EXCLUSIVE);
 #endif
   assert(handle_pkt.type != WRITEBACK || !bypass);
 
-  BLOCK& fill_block = block[set * NUM_WAY + way];
-  bool evicting_dirty = !bypass && (lower_level != NULL) && fill_block.dirty;
   uint64_t evicting_address = 0;
 
   if (!bypass) {
-    if (evicting_dirty) {
+    BLOCK& fill_block = block[set * NUM_WAY + way];
+
+    // an inclusive cache removes its victim from every level above it, and takes ownership of any modifications there
+    if (inclusion_policy == inclusion_t::INCLUSIVE && fill_block.valid) {
+      for (auto ul : upper_levels)
+        fill_block.dirty = ul->back_invalidate(fill_block.address) || fill_block.dirty;
+    }
+
+    bool evicting = (lower_level != NULL) && fill_block.valid && (fill_block.dirty || send_clean_victims);
+    if (evicting) {
       PACKET writeback_packet;
 
       writeback_packet.fill_level = lower_level->fill_level;
@@ -309,6 +484,7 @@ bool CACHE::filllike_miss(std::size_t set, std::size_t way, PACKET& handle_pkt)
       writeback_packet.instr_id = handle_pkt.instr_id;
       writeback_packet.ip = 0;
       writeback_packet.type = WRITEBACK;
+      writeback_packet.dirty = fill_block.dirty;
 
       auto result = lower_level->add_wq(&writeback_packet);
       if (result == -2)
@@ -323,18 +499,35 @@ bool CACHE::filllike_miss(std::size_t set, std::size_t way, PACKET& handle_pkt)
     if (fill_block.prefetch)
       pf_useless++;
 
+    if (profiler && fill_block.valid)
+      profiler->record_eviction(set);
+
+    if (!prefetch_listeners.empty() && fill_block.valid)
+      notify_prefetch_listeners({prefetch_event::kind_t::EVICT, this, fill_block.address, fill_block.v_address, fill_block.ip, handle_pkt.cpu, handle_pkt.type,
+                                 fill_block.prefetch, false, 0});
+
+    if (throttle) {
+      bool demand = (handle_pkt.type != PREFETCH && handle_pkt.type != WRITEBACK && handle_pkt.type != METADATA);
+      bool prefetch = (handle_pkt.type == PREFETCH && handle_pkt.pf_origin_level == fill_level);
+      throttle->record_fill(handle_pkt.address >> OFFSET_BITS, demand, prefetch, fill_block.valid, fill_block.address >> OFFSET_BITS);
+    }
+
     if (handle_pkt.type == PREFETCH)
       pf_fill++;
 
     fill_block.valid = true;
     fill_block.prefetch = (handle_pkt.type == PREFETCH && handle_pkt.pf_origin_level == fill_level);
-    fill_block.dirty = (handle_pkt.type == WRITEBACK || (handle_pkt.type == RFO && handle_pkt.to_return.empty()));
+    fill_block.dirty = (handle_pkt.dirty || (handle_pkt.type == RFO && handle_pkt.to_return.empty()));
     fill_block.address = handle_pkt.address;
     fill_block.v_address = handle_pkt.v_address;
     fill_block.data = handle_pkt.data;
     fill_block.ip = handle_pkt.ip;
     fill_block.cpu = handle_pkt.cpu;
     fill_block.instr_id = handle_pkt.instr_id;
+
+    if (!prefetch_listeners.empty())
+      notify_prefetch_listeners({prefetch_event::kind_t::FILL, this, handle_pkt.address, handle_pkt.v_address, handle_pkt.ip, handle_pkt.cpu, handle_pkt.type,
+                                 fill_block.prefetch, false, handle_pkt.pf_metadata});
   }
 
   if (warmup_complete[handle_pkt.cpu] && (handle_pkt.cycle_enqueued != 0))
@@ -347,11 +540,14 @@ bool CACHE::filllike_miss(std::size_t set, std::size_t way, PACKET& handle_pkt)
                                  handle_pkt.type == PREFETCH, evicting_address, handle_pkt.pf_metadata);
 
   // update replacement policy
-  impl_replacement_update_state(handle_pkt.cpu, set, way, handle_pkt.address, handle_pkt.ip, 0, handle_pkt.type, 0);
+  if (!bypass)
+    impl_replacement_update_state(handle_pkt.cpu, set, way, handle_pkt.address, handle_pkt.ip, 0, handle_pkt.type, 0);
 
   // COLLECT STATS
   sim_miss[handle_pkt.cpu][handle_pkt.type]++;
   sim_access[handle_pkt.cpu][handle_pkt.type]++;
+  if (profiler)
+    profiler->record_access(set, handle_pkt.address >> OFFSET_BITS, handle_pkt.ip, handle_pkt.type, false);
 
   return true;
 }
@@ -361,6 +557,8 @@ void CACHE::operate()
   operate_writes();
   operate_reads();
 
+  if (throttle)
+    throttle->begin_cycle();
   impl_prefetcher_cycle_operate();
 }
 
@@ -370,8 +568,10 @@ void CACHE::operate_writes()
   writes_available_this_cycle = MAX_WRITE;
   handle_fill();
   handle_writeback();
+  handle_unsampled();
 
   WQ.operate();
+  UNSAMPLED.operate();
 }
 
 void CACHE::operate_reads()
@@ -387,7 +587,9 @@ void CACHE::operate_reads()
   VAPQ.operate();
 }
 
-uint32_t CACHE::get_set(uint64_t address) { return ((address >> OFFSET_BITS) & bitmask(lg2(NUM_SET))); }
+uint32_t CACHE::get_set(uint64_t address) { return ((address >> OFFSET_BITS) & bitmask(lg2(NUM_SET * SET_SAMPLE_RATE))) >> lg2(SET_SAMPLE_RATE); }
+
+bool CACHE::is_sampled_set(uint64_t address) { return ((address >> OFFSET_BITS) & bitmask(lg2(SET_SAMPLE_RATE))) == 0; }
 
 uint32_t CACHE::get_way(uint64_t address, uint32_t set)
 {
@@ -398,6 +600,9 @@ uint32_t CACHE::get_way(uint64_t address, uint32_t set)
 
 int CACHE::invalidate_entry(uint64_t inval_addr)
 {
+  if (!is_sampled_set(inval_addr))
+    return NUM_WAY;
+
   uint32_t set = get_set(inval_addr);
   uint32_t way = get_way(inval_addr, set);
 
@@ -407,6 +612,27 @@ int CACHE::invalidate_entry(uint64_t inval_addr)
   return way;
 }
 
+bool CACHE::back_invalidate(uint64_t inval_addr)
+{
+  bool dirty = false;
+  for (auto ul : upper_levels)
+    dirty = ul->back_invalidate(inval_addr) || dirty;
+
+  uint32_t way = invalidate_entry(inval_addr);
+  if (way < NUM_WAY) {
+    BLOCK& inval_block = block[get_set(inval_addr) * NUM_WAY + way];
+    dirty = inval_block.dirty || dirty;
+    inval_block.dirty = false;
+    if (!prefetch_listeners.empty())
+      notify_prefetch_listeners({prefetch_event::kind_t::EVICT, this, inval_block.address, inval_block.v_address, inval_block.ip,
+                                 static_cast<uint32_t>(inval_block.cpu), WRITEBACK, inval_block.prefetch, false, 0});
+    inval_block.prefetch = false;
+    BACK_INVAL++;
+  }
+
+  return dirty;
+}
+
 int CACHE::add_rq(PACKET* packet)
 {
   assert(packet->address != 0);
@@ -487,6 +713,7 @@ int CACHE::add_wq(PACKET* packet)
 
     DP(if (warmup_complete[packet->cpu]) std::cout << " MERGED" << std::endl;)
 
+    found_wq->dirty = found_wq->dirty || packet->dirty;
     WQ_MERGED++;
     return 0; // merged index
   }
@@ -515,8 +742,32 @@ int CACHE::add_wq(PACKET* packet)
 
 int CACHE::prefetch_line(uint64_t pf_addr, bool fill_this_level, uint32_t prefetch_metadata)
 {
+  // only a deferred prefetch is reported as not accepted, for the prefetcher to retry
+  return issue_prefetch(pf_addr, fill_this_level, prefetch_metadata) != prefetch_result::DEFERRED;
+}
+
+CACHE::prefetch_result CACHE::issue_prefetch(uint64_t pf_addr, bool fill_this_level, uint32_t prefetch_metadata)
+{
+  // prefetches to sets outside the sample are dropped
+  if (!virtual_prefetch && !is_sampled_set(pf_addr))
+    return prefetch_result::DROPPED;
+
   pf_requested++;
 
+  // a prefetch that a lower level would decline, such as a translation prefetch for an unmapped page, is dropped before any level
+  // holds an MSHR for it
+  if (lower_level != nullptr && lower_level->declines_prefetch(pf_addr))
+    return prefetch_result::DROPPED;
+
+  // the throttle drops prefetches beyond its current distance, and defers those beyond its current degree
+  if (throttle) {
+    auto verdict = throttle->allow(pf_addr >> LOG2_BLOCK_SIZE);
+    if (verdict == champsim::prefetch_throttle::verdict::DROP)
+      return prefetch_result::DROPPED;
+    if (verdict == champsim::prefetch_throttle::verdict::DEFER)
+      return prefetch_result::DEFERRED;
+  }
+
   PACKET pf_packet;
   pf_packet.type = PREFETCH;
   pf_packet.fill_level = (fill_this_level ? fill_level : lower_level->fill_level);
@@ -529,18 +780,23 @@ int CACHE::prefetch_line(uint64_t pf_addr, bool fill_this_level, uint32_t prefet
   if (virtual_prefetch) {
     if (!VAPQ.full()) {
       VAPQ.push_back(pf_packet);
-      return 1;
+      return prefetch_result::ENQUEUED;
     }
   } else {
     int result = add_pq(&pf_packet);
-    if (result != -2) {
-      if (result > 0)
-        pf_issued++;
-      return 1;
+    if (result > 0) {
+      pf_issued++;
+      if (throttle) {
+        throttle->record_issue();
+        throttle->sample_dram(DRAM.get_occupancy(1, pf_addr), DRAM.get_size(1, pf_addr));
+      }
+      return prefetch_result::ENQUEUED;
     }
+    if (result != -2)
+      return prefetch_result::DROPPED;
   }
 
-  return 0;
+  return prefetch_result::DEFERRED;
 }
 
 int CACHE::prefetch_line(uint64_t ip, uint64_t base_addr, uint64_t pf_addr, bool fill_this_level, uint32_t prefetch_metadata)
@@ -559,24 +815,104 @@ int CACHE::prefetch_line(uint64_t ip, uint64_t base_addr, uint64_t pf_addr, bool
   return prefetch_line(pf_addr, fill_this_level, prefetch_metadata);
 }
 
+CACHE::prefetch_result CACHE::prefetch_line_to(CACHE* target, uint64_t pf_addr, uint32_t prefetch_metadata)
+{
+  // the target issues the prefetch as its own, on behalf of this cache's current core
+  target->cpu = cpu;
+  return target->issue_prefetch(pf_addr, true, prefetch_metadata);
+}
+
+CACHE* CACHE::lower_cache() const { return dynamic_cast<CACHE*>(lower_level); }
+
+CACHE::prefetch_status CACHE::get_prefetch_status()
+{
+  uint64_t resolved = pf_useful + pf_useless;
+  double accuracy = (resolved > 0) ? static_cast<double>(pf_useful) / resolved : 1.0;
+  return {get_occupancy(3, 0), get_size(3, 0), get_occupancy(0, 0), get_size(0, 0), pf_issued, pf_useful, pf_useless, accuracy};
+}
+
+void CACHE::add_prefetch_listener(prefetch_listener listener) { prefetch_listeners.push_back(std::move(listener)); }
+
+void CACHE::notify_prefetch_listeners(const prefetch_event& event)
+{
+  for (auto& listener : prefetch_listeners)
+    listener(event);
+}
+
 void CACHE::va_translate_prefetches()
 {
-  // TEMPORARY SOLUTION: mark prefetches as translated after a fixed latency
-  if (VAPQ.has_ready()) {
-    VAPQ.front().address = vmem.va_to_pa(cpu, VAPQ.front().v_address).first;
+  // a translation is reused only within this cycle, since the translation cache may evict or remap the page afterwards
+  std::optional<std::pair<uint64_t, uint64_t>> last_va_translation; // virtual page, physical page
 
-    // move the translated prefetch over to the regular PQ
-    int result = add_pq(&VAPQ.front());
+  uint32_t lookups = 0;
+  while (VAPQ.has_ready()) {
+    PACKET& pf_packet = VAPQ.front();
+    uint64_t vpage = pf_packet.v_address >> LOG2_PAGE_SIZE;
 
-    // remove the prefetch from the VAPQ
-    if (result != -2)
+    if (last_va_translation.has_value() && last_va_translation->first == vpage) {
+      VA_MERGED++;
+    } else {
+      if (lookups == VA_TRANSLATE_WIDTH)
+        return;
+      lookups++;
+
+      auto paddr = (va_translator != nullptr) ? va_translator->probe_translation(pf_packet.v_address) : vmem.va_to_pa(cpu, pf_packet.v_address).first;
+      if (!paddr.has_value()) {
+        // the translation would need a page walk
+        VA_DROPPED++;
+        VAPQ.pop_front();
+        continue;
+      }
+
+      last_va_translation = {vpage, paddr.value() >> LOG2_PAGE_SIZE};
+      VA_TRANSLATED++;
+    }
+
+    pf_packet.address = splice_bits(last_va_translation->second << LOG2_PAGE_SIZE, pf_packet.v_address, LOG2_PAGE_SIZE);
+
+    // prefetches to sets outside the sample are dropped
+    if (!is_sampled_set(pf_packet.address)) {
       VAPQ.pop_front();
+      continue;
+    }
 
-    if (result > 0)
+    // move the translated prefetch over to the regular PQ
+    int result = add_pq(&pf_packet);
+    if (result == -2)
+      return;
+
+    if (result > 0) {
       pf_issued++;
+      if (throttle) {
+        throttle->record_issue();
+        throttle->sample_dram(DRAM.get_occupancy(1, pf_packet.address), DRAM.get_size(1, pf_packet.address));
+      }
+    }
+
+    VAPQ.pop_front();
   }
 }
 
+std::optional<uint64_t> CACHE::probe_translation(uint64_t vaddr)
+{
+  if (HUGE_WAY > 0) {
+    auto set_begin = std::next(std::begin(huge_block), ((vaddr >> LOG2_HUGE_PAGE_SIZE) & bitmask(lg2(HUGE_SET))) * HUGE_WAY);
+    auto set_end = std::next(set_begin, HUGE_WAY);
+    if (auto hit_block = std::find_if(set_begin, set_end, eq_addr<BLOCK>(vaddr, LOG2_HUGE_PAGE_SIZE)); hit_block != set_end)
+      return splice_bits(hit_block->data, vaddr, LOG2_HUGE_PAGE_SIZE);
+  }
+
+  if (!is_sampled_set(vaddr))
+    return std::nullopt;
+
+  uint32_t set = get_set(vaddr);
+  uint32_t way = get_way(vaddr, set);
+  if (way == NUM_WAY)
+    return std::nullopt;
+
+  return splice_bits(block[set * NUM_WAY + way].data, vaddr, LOG2_PAGE_SIZE);
+}
+
 int CACHE::add_pq(PACKET* packet)
 {
   assert(packet->address != 0);
@@ -636,6 +972,23 @@ int CACHE::add_pq(PACKET* packet)
   return PQ.occupancy();
 }
 
+void CACHE::shootdown(uint64_t vaddr, uint64_t huge_frame)
+{
+  auto in_region = [region = vaddr >> LOG2_HUGE_PAGE_SIZE](uint64_t addr) { return (addr >> LOG2_HUGE_PAGE_SIZE) == region; };
+
+  for (auto& blk : block) {
+    if (blk.valid && in_region(blk.address))
+      blk.valid = 0;
+  }
+
+  for (auto& entry : MSHR) {
+    if (entry.event_cycle != std::numeric_limits<uint64_t>::max() && in_region(entry.address)) {
+      entry.data = splice_bits(huge_frame, entry.address, LOG2_HUGE_PAGE_SIZE);
+      entry.page_level = vmem.huge_page_level;
+    }
+  }
+}
+
 void CACHE::return_data(PACKET* packet)
 {
   // check MSHR information
@@ -655,6 +1008,8 @@ void CACHE::return_data(PACKET* packet)
   // MSHR holds the most updated information about this request
   mshr_entry->data = packet->data;
   mshr_entry->pf_metadata = packet->pf_metadata;
+  mshr_entry->dirty = packet->dirty;
+  mshr_entry->page_level = packet->page_level;
   mshr_entry->event_cycle = current_cycle + (warmup_complete[cpu] ? FILL_LATENCY : 0);
 
   DP(if (warmup_complete[packet->cpu]) {
@@ -698,6 +1053,8 @@ uint32_t CACHE::get_size(uint8_t queue_type, uint64_t address)
   return 0;
 }
 
+bool CACHE::declines_prefetch(uint64_t address) { return lower_level != nullptr && lower_level->declines_prefetch(address); }
+
 bool CACHE::should_activate_prefetcher(int type) { return (1 << static_cast<int>(type)) & pref_activate_mask; }
 
 void CACHE::print_deadlock()
@@ -0,0 +1,157 @@
+#include "cache_profiler.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <iterator>
+
+#include "memory_class.h"
+
+namespace champsim
+{
+
+std::size_t count_min_sketch::index(std::size_t row, uint64_t key)
+{
+  // multiply-shift hashing, with one odd multiplier per row
+  static constexpr std::array<uint64_t, DEPTH> seeds{{0x9e3779b97f4a7c15ull, 0xc2b2ae3d27d4eb4full, 0x165667b19e3779f9ull, 0xd6e8feb86659fd93ull}};
+  return (key * seeds[row]) >> (64 - LOG2_WIDTH);
+}
+
+void count_min_sketch::increment(uint64_t key)
+{
+  for (std::size_t i = 0; i < DEPTH; ++i)
+    counters[i][index(i, key)]++;
+}
+
+uint64_t count_min_sketch::estimate(uint64_t key) const
+{
+  uint64_t result = counters[0][index(0, key)];
+  for (std::size_t i = 1; i < DEPTH; ++i)
+    result = std::min(result, counters[i][index(i, key)]);
+  return result;
+}
+
+void count_min_sketch::clear()
+{
+  for (auto& row : counters)
+    row.fill(0);
+}
+
+void space_saving::increment(uint64_t key)
+{
+  auto end = std::next(std::begin(entries), occupancy);
+  auto found = std::find_if(std::begin(entries), end, [key](const entry& x) { return x.key == key; });
+  if (found != end) {
+    found->count++;
+  } else if (occupancy < CAPACITY) {
+    *end = {key, 1, 0};
+    occupancy++;
+  } else {
+    // replace the least frequent key, which inherits its count as the error bound
+    auto victim = std::min_element(std::begin(entries), std::end(entries), [](const entry& x, const entry& y) { return x.count < y.count; });
+    *victim = {key, victim->count + 1, victim->count};
+  }
+}
+
+std::vector<space_saving::entry> space_saving::top() const
+{
+  std::vector<entry> result{std::begin(entries), std::next(std::begin(entries), occupancy)};
+  std::sort(std::begin(result), std::end(result), [](const entry& x, const entry& y) { return x.count > y.count; });
+  return result;
+}
+
+void space_saving::clear()
+{
+  entries.fill({});
+  occupancy = 0;
+}
+
+cache_profiler::cache_profiler(std::size_t sets, std::size_t ways)
+    : NUM_SET(sets), NUM_WAY(ways), REUSE_SAMPLE_STRIDE(std::max<std::size_t>(1, sets / REUSE_SAMPLE_TARGET)), REUSE_DEPTH(REUSE_DEPTH_FACTOR * ways),
+      set_access(sets), set_miss(sets), set_evict(sets), reuse_stacks((sets + REUSE_SAMPLE_STRIDE - 1) / REUSE_SAMPLE_STRIDE), reuse_hist(REUSE_DEPTH + 1)
+{
+  for (auto& stack : reuse_stacks)
+    stack.reserve(REUSE_DEPTH);
+}
+
+void cache_profiler::record_access(uint32_t set, uint64_t block_addr, uint64_t ip, uint8_t type, bool hit)
+{
+  set_access[set]++;
+  if (!hit) {
+    set_miss[set]++;
+    if (type != WRITEBACK && type != METADATA) {
+      miss_pc_counts.increment(ip);
+      miss_pc_top.increment(ip);
+    }
+  }
+
+  if (set % REUSE_SAMPLE_STRIDE == 0) {
+    auto& stack = reuse_stacks[set / REUSE_SAMPLE_STRIDE];
+    auto found = std::find(std::begin(stack), std::end(stack), block_addr);
+    reuse_hist[std::distance(std::begin(stack), found)]++;
+
+    // move the block to the most recently used position
+    if (found == std::end(stack)) {
+      if (std::size(stack) < REUSE_DEPTH)
+        stack.push_back(block_addr);
+      found = std::prev(std::end(stack));
+      *found = block_addr;
+    }
+    std::rotate(std::begin(stack), found, std::next(found));
+  }
+}
+
+void cache_profiler::record_eviction(uint32_t set) { set_evict[set]++; }
+
+void cache_profiler::clear()
+{
+  std::fill(std::begin(set_access), std::end(set_access), 0);
+  std::fill(std::begin(set_miss), std::end(set_miss), 0);
+  std::fill(std::begin(set_evict), std::end(set_evict), 0);
+  std::fill(std::begin(reuse_hist), std::end(reuse_hist), 0);
+  miss_pc_counts.clear();
+  miss_pc_top.clear();
+}
+
+namespace
+{
+void dump_array(std::ostream& os, const char* key, const std::vector<uint64_t>& values)
+{
+  os << "  \"" << key << "\": [";
+  for (auto it = std::begin(values); it != std::end(values); ++it)
+    os << (it == std::begin(values) ? "" : ", ") << *it;
+  os << "]";
+}
+} // namespace
+
+void cache_profiler::dump(std::ostream& os, const std::string& name, uint32_t set_sample_rate) const
+{
+  os << "{" << std::endl;
+  os << "  \"cache\": \"" << name << "\"," << std::endl;
+  os << "  \"sets\": " << NUM_SET << "," << std::endl;
+  os << "  \"ways\": " << NUM_WAY << "," << std::endl;
+  os << "  \"set_sample_rate\": " << set_sample_rate << "," << std::endl;
+
+  dump_array(os, "set_access", set_access);
+  os << "," << std::endl;
+  dump_array(os, "set_miss", set_miss);
+  os << "," << std::endl;
+  dump_array(os, "set_evict", set_evict);
+  os << "," << std::endl;
+
+  os << "  \"top_miss_pcs\": [";
+  auto top = miss_pc_top.top();
+  for (auto it = std::begin(top); it != std::end(top); ++it) {
+    os << (it == std::begin(top) ? "" : ",") << std::endl;
+    os << "    {\"ip\": \"0x" << std::hex << it->key << std::dec << "\", \"count\": " << it->count << ", \"max_error\": " << it->error;
+    os << ", \"count_min_estimate\": " << miss_pc_counts.estimate(it->key) << "}";
+  }
+  os << std::endl << "  ]," << std::endl;
+
+  os << "  \"reuse_sample_stride\": " << REUSE_SAMPLE_STRIDE << "," << std::endl;
+  dump_array(os, "reuse_distance", std::vector<uint64_t>{std::begin(reuse_hist), std::prev(std::end(reuse_hist))});
+  os << "," << std::endl;
+  os << "  \"reuse_beyond\": " << reuse_hist.back() << std::endl;
+  os << "}" << std::endl;
+}
+
+} // namespace champsim
@@ -7,12 +7,19 @@
 
 extern uint8_t all_warmup_complete;
 
-struct is_unscheduled {
-  bool operator()(const PACKET& lhs) { return !lhs.scheduled; }
-};
+bool MEMORY_CONTROLLER::schedules_before(std::vector<PACKET>::iterator lhs, std::vector<PACKET>::iterator rhs)
+{
+  return lhs->event_cycle < rhs->event_cycle || (lhs->event_cycle == rhs->event_cycle && lhs < rhs);
+}
 
-struct next_schedule : public invalid_is_maximal<PACKET, min_event_cycle<PACKET>, PACKET, is_unscheduled, is_unscheduled> {
-};
+void MEMORY_CONTROLLER::add_pending(DRAM_CHANNEL& channel, std::vector<PACKET>::iterator pkt, bool is_write)
+{
+  auto& pending = (is_write ? channel.wq_pending : channel.rq_pending)[dram_get_rank(pkt->address) * DRAM_BANKS + dram_get_bank(pkt->address)];
+
+  // most packets are the youngest in their bank, so search from the back
+  auto pos = std::find_if(std::rbegin(pending), std::rend(pending), [pkt](auto x) { return schedules_before(x, pkt); });
+  pending.insert(pos.base(), pkt);
+}
 
 void MEMORY_CONTROLLER::operate()
 {
@@ -24,13 +31,18 @@ void MEMORY_CONTROLLER::operate()
 
       channel.active_request->valid = false;
 
+      if (channel.active_request->is_write)
+        channel.wq_occupancy--;
+      else
+        channel.rq_occupancy--;
+
       *channel.active_request->pkt = {};
       channel.active_request = std::end(channel.bank_request);
     }
 
     // Check queue occupancy
-    std::size_t wq_occu = std::count_if(std::begin(channel.WQ), std::end(channel.WQ), is_valid<PACKET>());
-    std::size_t rq_occu = std::count_if(std::begin(channel.RQ), std::end(channel.RQ), is_valid<PACKET>());
+    std::size_t wq_occu = channel.wq_occupancy;
+    std::size_t rq_occu = channel.rq_occupancy;
 
     // Change modes if the queues are unbalanced
     if ((!channel.write_mode && (wq_occu >= DRAM_WRITE_HIGH_WM || (rq_occu == 0 && wq_occu > 0)))
@@ -47,6 +59,7 @@ void MEMORY_CONTROLLER::operate()
           it->valid = false;
           it->pkt->scheduled = false;
           it->pkt->event_cycle = current_cycle;
+          add_pending(channel, it->pkt, it->is_write);
         }
       }
 
@@ -88,32 +101,131 @@ void MEMORY_CONTROLLER::operate()
       }
     }
 
-    // Look for queued packets that have not been scheduled
-    std::vector<PACKET>::iterator iter_next_schedule;
-    if (channel.write_mode)
-      iter_next_schedule = std::min_element(std::begin(channel.WQ), std::end(channel.WQ), next_schedule());
-    else
-      iter_next_schedule = std::min_element(std::begin(channel.RQ), std::end(channel.RQ), next_schedule());
+    // Ask the scheduler module for the next packet to send to its bank
+    auto& queue = channel.write_mode ? channel.WQ : channel.RQ;
+    auto iter_next_schedule = impl_schedule_dram_request(channel);
+    if (iter_next_schedule != std::end(queue) && iter_next_schedule->event_cycle <= current_cycle) {
+      uint32_t op_row = dram_get_row(iter_next_schedule->address);
+      auto op_idx = dram_get_rank(iter_next_schedule->address) * DRAM_BANKS + dram_get_bank(iter_next_schedule->address);
 
-    if (is_valid<PACKET>()(*iter_next_schedule) && iter_next_schedule->event_cycle <= current_cycle) {
-      uint32_t op_rank = dram_get_rank(iter_next_schedule->address), op_bank = dram_get_bank(iter_next_schedule->address),
-               op_row = dram_get_row(iter_next_schedule->address);
+      if (!channel.bank_request[op_idx].valid) {
+        auto& bank = channel.bank_request[op_idx];
 
-      auto op_idx = op_rank * DRAM_BANKS + op_bank;
+        // a refresh since the last access to this bank has closed its row
+        if (DRAM_REFRESH != dram_refresh_t::NONE && refresh_count(current_cycle, op_idx) != bank.refreshes) {
+          bank.open_row = UINT32_MAX;
+          bank.refreshes = refresh_count(current_cycle, op_idx);
+        }
 
-      if (!channel.bank_request[op_idx].valid) {
-        bool row_buffer_hit = (channel.bank_request[op_idx].open_row == op_row);
+        bool row_buffer_hit = (bank.open_row == op_row);
 
         // this bank is now busy
-        channel.bank_request[op_idx] = {true, row_buffer_hit, op_row, current_cycle + tCAS + (row_buffer_hit ? 0 : tRP + tRCD), iter_next_schedule};
+        bank.valid = true;
+        bank.row_buffer_hit = row_buffer_hit;
+        bank.is_write = channel.write_mode;
+        bank.open_row = op_row;
+        bank.event_cycle = issue_commands(channel, op_idx, row_buffer_hit, channel.write_mode);
+        bank.pkt = iter_next_schedule;
 
         iter_next_schedule->scheduled = true;
         iter_next_schedule->event_cycle = std::numeric_limits<uint64_t>::max();
+
+        auto& pending = (channel.write_mode ? channel.wq_pending : channel.rq_pending)[op_idx];
+        pending.erase(std::find(std::begin(pending), std::end(pending), iter_next_schedule));
       }
     }
   }
 }
 
+uint64_t MEMORY_CONTROLLER::issue_commands(DRAM_CHANNEL& channel, std::size_t bank_idx, bool row_buffer_hit, bool is_write)
+{
+  auto& bank = channel.bank_request[bank_idx];
+  auto& rank = channel.rank_timing[bank_idx / DRAM_BANKS];
+  std::size_t group = (bank_idx % DRAM_BANKS) % DRAM_BANK_GROUPS;
+
+  // Each constraint applies only when its timing is configured. Constraints between banks are checked against the most recent
+  // command of each kind, which keeps the cost per packet constant.
+  uint64_t column = after_refresh(current_cycle, bank_idx);
+  if (!row_buffer_hit) {
+    // precharge the bank, then activate the row
+    uint64_t activate = after_refresh(std::max(column, bank.precharge_ready) + tRP, bank_idx);
+
+    uint64_t rrd = (group == rank.last_activate_group) ? tRRD_L : tRRD_S;
+    if (rrd > 0 && activate + rrd > rank.last_activate && activate < rank.last_activate + rrd)
+      activate = rank.last_activate + rrd;
+
+    auto oldest_activate = std::min_element(std::begin(rank.activate_window), std::end(rank.activate_window));
+    if (tFAW > 0)
+      activate = std::max(activate, *oldest_activate + tFAW);
+
+    if (activate >= rank.last_activate) {
+      rank.last_activate = activate;
+      rank.last_activate_group = group;
+    }
+    *oldest_activate = activate;
+
+    bank.precharge_ready = (tRAS > 0) ? activate + tRAS : 0;
+    column = activate + tRCD;
+  }
+
+  uint64_t ccd = (group == rank.last_column_group) ? tCCD_L : tCCD_S;
+  if (ccd > 0 && column + ccd > rank.last_column && column < rank.last_column + ccd)
+    column = rank.last_column + ccd;
+
+  if (!is_write)
+    column = std::max(column, rank.read_ready);
+
+  if (column >= rank.last_column) {
+    rank.last_column = column;
+    rank.last_column_group = group;
+  }
+
+  uint64_t data_ready = column + tCAS;
+
+  // write recovery, before the row may be closed or the rank may be read
+  if (is_write) {
+    uint64_t write_done = data_ready + DRAM_DBUS_RETURN_TIME;
+    if (tWR > 0)
+      bank.precharge_ready = std::max(bank.precharge_ready, write_done + tWR);
+    if (tWTR > 0)
+      rank.read_ready = std::max(rank.read_ready, write_done + tWTR);
+  }
+
+  return data_ready;
+}
+
+// all banks refresh together, or each bank of a rank in turn, once every tREFI
+uint64_t MEMORY_CONTROLLER::refresh_offset(std::size_t bank_idx)
+{
+  return (DRAM_REFRESH == dram_refresh_t::PER_BANK) ? (bank_idx % DRAM_BANKS) * (tREFI / DRAM_BANKS) : 0;
+}
+
+uint64_t MEMORY_CONTROLLER::refresh_count(uint64_t cycle, std::size_t bank_idx) const
+{
+  if (DRAM_REFRESH == dram_refresh_t::NONE || cycle < refresh_offset(bank_idx) + tREFI)
+    return 0;
+
+  return (cycle - refresh_offset(bank_idx)) / std::max<uint64_t>(tREFI, 1); // tREFI may be zero when refresh is disabled
+}
+
+uint64_t MEMORY_CONTROLLER::after_refresh(uint64_t cycle, std::size_t bank_idx) const
+{
+  auto count = refresh_count(cycle, bank_idx);
+  uint64_t refresh_end = refresh_offset(bank_idx) + count * tREFI + tRFC;
+  return (count > 0 && cycle < refresh_end) ? refresh_end : cycle;
+}
+
+uint64_t MEMORY_CONTROLLER::arrival_cycle(uint32_t cpu)
+{
+  if (cpu >= NUM_CPUS || champsim::cpu_memory_node[cpu] == node)
+    return current_cycle;
+
+  REMOTE_ACCESS++;
+  uint64_t depart = std::max(current_cycle, remote_link_available);
+  remote_link_available = depart + REMOTE_TRANSFER_TIME;
+  return depart + REMOTE_LATENCY;
+}
+
 int MEMORY_CONTROLLER::add_rq(PACKET* packet)
 {
   if (all_warmup_complete < NUM_CPUS) {
@@ -153,7 +265,9 @@ int MEMORY_CONTROLLER::add_rq(PACKET* packet)
   }
 
   *rq_it = *packet;
-  rq_it->event_cycle = current_cycle;
+  rq_it->event_cycle = arrival_cycle(packet->cpu);
+  channel.rq_occupancy++;
+  add_pending(channel, rq_it, false);
 
   return get_occupancy(1, packet->address);
 }
@@ -178,55 +292,22 @@ int MEMORY_CONTROLLER::add_wq(PACKET* packet)
   }
 
   *wq_it = *packet;
-  wq_it->event_cycle = current_cycle;
+  wq_it->event_cycle = arrival_cycle(packet->cpu);
+  channel.wq_occupancy++;
+  add_pending(channel, wq_it, true);
 
   return get_occupancy(2, packet->address);
 }
 
 int MEMORY_CONTROLLER::add_pq(PACKET* packet) { return add_rq(packet); }
 
-/*
- * | row address | rank index | column address | bank index | channel | block
- * offset |
- */
-
-uint32_t MEMORY_CONTROLLER::dram_get_channel(uint64_t address)
-{
-  int shift = LOG2_BLOCK_SIZE;
-  return (address >> shift) & bitmask(lg2(DRAM_CHANNELS));
-}
-
-uint32_t MEMORY_CONTROLLER::dram_get_bank(uint64_t address)
-{
-  int shift = lg2(DRAM_CHANNELS) + LOG2_BLOCK_SIZE;
-  return (address >> shift) & bitmask(lg2(DRAM_BANKS));
-}
-
-uint32_t MEMORY_CONTROLLER::dram_get_column(uint64_t address)
-{
-  int shift = lg2(DRAM_BANKS) + lg2(DRAM_CHANNELS) + LOG2_BLOCK_SIZE;
-  return (address >> shift) & bitmask(lg2(DRAM_COLUMNS));
-}
-
-uint32_t MEMORY_CONTROLLER::dram_get_rank(uint64_t address)
-{
-  int shift = lg2(DRAM_BANKS) + lg2(DRAM_COLUMNS) + lg2(DRAM_CHANNELS) + LOG2_BLOCK_SIZE;
-  return (address >> shift) & bitmask(lg2(DRAM_RANKS));
-}
-
-uint32_t MEMORY_CONTROLLER::dram_get_row(uint64_t address)
-{
-  int shift = lg2(DRAM_RANKS) + lg2(DRAM_BANKS) + lg2(DRAM_COLUMNS) + lg2(DRAM_CHANNELS) + LOG2_BLOCK_SIZE;
-  return (address >> shift) & bitmask(lg2(DRAM_ROWS));
-}
-
 uint32_t MEMORY_CONTROLLER::get_occupancy(uint8_t queue_type, uint64_t address)
 {
   uint32_t channel = dram_get_channel(address);
   if (queue_type == 1)
-    return std::count_if(std::begin(channels[channel].RQ), std::end(channels[channel].RQ), is_valid<PACKET>());
+    return channels[channel].rq_occupancy;
   else if (queue_type == 2)
-    return std::count_if(std::begin(channels[channel].WQ), std::end(channels[channel].WQ), is_valid<PACKET>());
+    return channels[channel].wq_occupancy;
   else if (queue_type == 3)
     return get_occupancy(1, address);
 
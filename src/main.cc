@@ -14,6 +14,7 @@
 #include "dram_controller.h"
 #include "ooo_cpu.h"
 #include "operable.h"
+#include "ptw.h"
 #include "tracereader.h"
 #include "vmem.h"
 
@@ -27,10 +28,11 @@ auto start_time = time(NULL);
 // For backwards compatibility with older module source.
 champsim::deprecated_clock_cycle current_core_cycle;
 
-extern MEMORY_CONTROLLER DRAM;
+extern std::array<MEMORY_CONTROLLER*, NUM_MEMORY_CONTROLLERS> memory_controllers;
 extern VirtualMemory vmem;
 extern std::array<O3_CPU*, NUM_CPUS> ooo_cpu;
 extern std::array<CACHE*, NUM_CACHES> caches;
+extern std::array<PageTableWalker*, NUM_CPUS> ptws;
 extern std::array<champsim::operable*, NUM_OPERABLES> operables;
 
 std::vector<tracereader*> traces;
@@ -58,43 +60,80 @@ void record_roi_stats(uint32_t cpu, CACHE* cache)
 void print_roi_stats(uint32_t cpu, CACHE* cache)
 {
   uint64_t TOTAL_ACCESS = 0, TOTAL_HIT = 0, TOTAL_MISS = 0;
+  uint64_t scale = cache->SET_SAMPLE_RATE; // statistics from sampled sets stand in for the whole cache
 
   for (uint32_t i = 0; i < NUM_TYPES; i++) {
     TOTAL_ACCESS += cache->roi_access[cpu][i];
     TOTAL_HIT += cache->roi_hit[cpu][i];
     TOTAL_MISS += cache->roi_miss[cpu][i];
   }
+  TOTAL_ACCESS *= scale;
+  TOTAL_HIT *= scale;
+  TOTAL_MISS *= scale;
 
   if (TOTAL_ACCESS > 0) {
     cout << cache->NAME;
     cout << " TOTAL     ACCESS: " << setw(10) << TOTAL_ACCESS << "  HIT: " << setw(10) << TOTAL_HIT << "  MISS: " << setw(10) << TOTAL_MISS << endl;
 
     cout << cache->NAME;
-    cout << " LOAD      ACCESS: " << setw(10) << cache->roi_access[cpu][0] << "  HIT: " << setw(10) << cache->roi_hit[cpu][0] << "  MISS: " << setw(10)
-         << cache->roi_miss[cpu][0] << endl;
+    cout << " LOAD      ACCESS: " << setw(10) << scale * cache->roi_access[cpu][0] << "  HIT: " << setw(10) << scale * cache->roi_hit[cpu][0]
+         << "  MISS: " << setw(10) << scale * cache->roi_miss[cpu][0] << endl;
 
     cout << cache->NAME;
-    cout << " RFO       ACCESS: " << setw(10) << cache->roi_access[cpu][1] << "  HIT: " << setw(10) << cache->roi_hit[cpu][1] << "  MISS: " << setw(10)
-         << cache->roi_miss[cpu][1] << endl;
+    cout << " RFO       ACCESS: " << setw(10) << scale * cache->roi_access[cpu][1] << "  HIT: " << setw(10) << scale * cache->roi_hit[cpu][1]
+         << "  MISS: " << setw(10) << scale * cache->roi_miss[cpu][1] << endl;
 
     cout << cache->NAME;
-    cout << " PREFETCH  ACCESS: " << setw(10) << cache->roi_access[cpu][2] << "  HIT: " << setw(10) << cache->roi_hit[cpu][2] << "  MISS: " << setw(10)
-         << cache->roi_miss[cpu][2] << endl;
+    cout << " PREFETCH  ACCESS: " << setw(10) << scale * cache->roi_access[cpu][2] << "  HIT: " << setw(10) << scale * cache->roi_hit[cpu][2]
+         << "  MISS: " << setw(10) << scale * cache->roi_miss[cpu][2] << endl;
 
     cout << cache->NAME;
-    cout << " WRITEBACK ACCESS: " << setw(10) << cache->roi_access[cpu][3] << "  HIT: " << setw(10) << cache->roi_hit[cpu][3] << "  MISS: " << setw(10)
-         << cache->roi_miss[cpu][3] << endl;
+    cout << " WRITEBACK ACCESS: " << setw(10) << scale * cache->roi_access[cpu][3] << "  HIT: " << setw(10) << scale * cache->roi_hit[cpu][3]
+         << "  MISS: " << setw(10) << scale * cache->roi_miss[cpu][3] << endl;
 
     cout << cache->NAME;
-    cout << " TRANSLATION ACCESS: " << setw(10) << cache->roi_access[cpu][4] << "  HIT: " << setw(10) << cache->roi_hit[cpu][4] << "  MISS: " << setw(10)
-         << cache->roi_miss[cpu][4] << endl;
+    cout << " TRANSLATION ACCESS: " << setw(10) << scale * cache->roi_access[cpu][4] << "  HIT: " << setw(10) << scale * cache->roi_hit[cpu][4]
+         << "  MISS: " << setw(10) << scale * cache->roi_miss[cpu][4] << endl;
+
+    if (cache->roi_access[cpu][METADATA] > 0) {
+      cout << cache->NAME;
+      cout << " METADATA  ACCESS: " << setw(10) << scale * cache->roi_access[cpu][METADATA] << "  HIT: " << setw(10) << scale * cache->roi_hit[cpu][METADATA]
+           << "  MISS: " << setw(10) << scale * cache->roi_miss[cpu][METADATA] << endl;
+    }
 
     cout << cache->NAME;
-    cout << " PREFETCH  REQUESTED: " << setw(10) << cache->pf_requested << "  ISSUED: " << setw(10) << cache->pf_issued;
-    cout << "  USEFUL: " << setw(10) << cache->pf_useful << "  USELESS: " << setw(10) << cache->pf_useless << endl;
+    cout << " PREFETCH  REQUESTED: " << setw(10) << scale * cache->pf_requested << "  ISSUED: " << setw(10) << scale * cache->pf_issued;
+    cout << "  USEFUL: " << setw(10) << scale * cache->pf_useful << "  USELESS: " << setw(10) << scale * cache->pf_useless << endl;
 
     cout << cache->NAME;
-    cout << " AVERAGE MISS LATENCY: " << (1.0 * (cache->total_miss_latency)) / TOTAL_MISS << " cycles" << endl;
+    cout << " AVERAGE MISS LATENCY: " << (1.0 * scale * (cache->total_miss_latency)) / TOTAL_MISS << " cycles" << endl;
+
+    if (scale > 1) {
+      cout << cache->NAME;
+      cout << " SET SAMPLING: 1 in " << scale << " sets simulated, statistics scaled by " << scale << endl;
+    }
+
+    if (cache->throttle) {
+      cout << cache->NAME;
+      cout << " PREFETCH  THROTTLED: " << setw(10) << cache->throttle->throttled << "  EPOCHS: " << setw(10) << cache->throttle->epochs;
+      cout << "  FINAL DEGREE: " << cache->throttle->current().degree << "  FINAL DISTANCE: " << cache->throttle->current().distance << endl;
+    }
+
+    if (cache->BACK_INVAL > 0) {
+      cout << cache->NAME;
+      cout << " BACK-INVALIDATED: " << setw(10) << scale * cache->BACK_INVAL << endl;
+    }
+
+    if (cache->HUGE_WAY > 0) {
+      cout << cache->NAME;
+      cout << " HUGE PAGE HIT: " << setw(10) << cache->HUGE_PAGE_HIT << endl;
+    }
+
+    if (cache->VA_TRANSLATED > 0 || cache->VA_MERGED > 0 || cache->VA_DROPPED > 0) {
+      cout << cache->NAME;
+      cout << " VA PREFETCH TRANSLATED: " << setw(10) << cache->VA_TRANSLATED << "  MERGED: " << setw(10) << cache->VA_MERGED;
+      cout << "  DROPPED: " << setw(10) << cache->VA_DROPPED << endl;
+    }
     // cout << " AVERAGE MISS LATENCY: " <<
     // (cache->total_miss_latency)/TOTAL_MISS << " cycles " <<
     // cache->total_miss_latency << "/" << TOTAL_MISS<< endl;
@@ -104,32 +143,42 @@ void print_roi_stats(uint32_t cpu, CACHE* cache)
 void print_sim_stats(uint32_t cpu, CACHE* cache)
 {
   uint64_t TOTAL_ACCESS = 0, TOTAL_HIT = 0, TOTAL_MISS = 0;
+  uint64_t scale = cache->SET_SAMPLE_RATE; // statistics from sampled sets stand in for the whole cache
 
   for (uint32_t i = 0; i < NUM_TYPES; i++) {
     TOTAL_ACCESS += cache->sim_access[cpu][i];
     TOTAL_HIT += cache->sim_hit[cpu][i];
     TOTAL_MISS += cache->sim_miss[cpu][i];
   }
+  TOTAL_ACCESS *= scale;
+  TOTAL_HIT *= scale;
+  TOTAL_MISS *= scale;
 
   if (TOTAL_ACCESS > 0) {
     cout << cache->NAME;
     cout << " TOTAL     ACCESS: " << setw(10) << TOTAL_ACCESS << "  HIT: " << setw(10) << TOTAL_HIT << "  MISS: " << setw(10) << TOTAL_MISS << endl;
 
     cout << cache->NAME;
-    cout << " LOAD      ACCESS: " << setw(10) << cache->sim_access[cpu][0] << "  HIT: " << setw(10) << cache->sim_hit[cpu][0] << "  MISS: " << setw(10)
-         << cache->sim_miss[cpu][0] << endl;
+    cout << " LOAD      ACCESS: " << setw(10) << scale * cache->sim_access[cpu][0] << "  HIT: " << setw(10) << scale * cache->sim_hit[cpu][0]
+         << "  MISS: " << setw(10) << scale * cache->sim_miss[cpu][0] << endl;
 
     cout << cache->NAME;
-    cout << " RFO       ACCESS: " << setw(10) << cache->sim_access[cpu][1] << "  HIT: " << setw(10) << cache->sim_hit[cpu][1] << "  MISS: " << setw(10)
-         << cache->sim_miss[cpu][1] << endl;
+    cout << " RFO       ACCESS: " << setw(10) << scale * cache->sim_access[cpu][1] << "  HIT: " << setw(10) << scale * cache->sim_hit[cpu][1]
+         << "  MISS: " << setw(10) << scale * cache->sim_miss[cpu][1] << endl;
 
     cout << cache->NAME;
-    cout << " PREFETCH  ACCESS: " << setw(10) << cache->sim_access[cpu][2] << "  HIT: " << setw(10) << cache->sim_hit[cpu][2] << "  MISS: " << setw(10)
-         << cache->sim_miss[cpu][2] << endl;
+    cout << " PREFETCH  ACCESS: " << setw(10) << scale * cache->sim_access[cpu][2] << "  HIT: " << setw(10) << scale * cache->sim_hit[cpu][2]
+         << "  MISS: " << setw(10) << scale * cache->sim_miss[cpu][2] << endl;
 
     cout << cache->NAME;
-    cout << " WRITEBACK ACCESS: " << setw(10) << cache->sim_access[cpu][3] << "  HIT: " << setw(10) << cache->sim_hit[cpu][3] << "  MISS: " << setw(10)
-         << cache->sim_miss[cpu][3] << endl;
+    cout << " WRITEBACK ACCESS: " << setw(10) << scale * cache->sim_access[cpu][3] << "  HIT: " << setw(10) << scale * cache->sim_hit[cpu][3]
+         << "  MISS: " << setw(10) << scale * cache->sim_miss[cpu][3] << endl;
+
+    if (cache->sim_access[cpu][METADATA] > 0) {
+      cout << cache->NAME;
+      cout << " METADATA  ACCESS: " << setw(10) << scale * cache->sim_access[cpu][METADATA] << "  HIT: " << setw(10) << scale * cache->sim_hit[cpu][METADATA]
+           << "  MISS: " << setw(10) << scale * cache->sim_miss[cpu][METADATA] << endl;
+    }
   }
 }
 
@@ -180,40 +229,76 @@ void print_branch_stats()
   }
 }
 
-void print_dram_stats()
+void print_ptw_stats(PageTableWalker* ptw)
 {
-  uint64_t total_congested_cycle = 0;
-  uint64_t total_congested_count = 0;
-
-  std::cout << std::endl;
-  std::cout << "DRAM Statistics" << std::endl;
-  for (uint32_t i = 0; i < DRAM_CHANNELS; i++) {
-    std::cout << " CHANNEL " << i << std::endl;
+  cout << ptw->NAME << " WALKS: " << setw(10) << ptw->WALKS << "  AVERAGE LATENCY: ";
+  if (ptw->WALKS > 0)
+    cout << (1.0 * ptw->total_miss_latency) / ptw->WALKS << " cycles" << endl;
+  else
+    cout << "-" << endl;
 
-    auto& channel = DRAM.channels[i];
-    std::cout << " RQ ROW_BUFFER_HIT: " << std::setw(10) << channel.RQ_ROW_BUFFER_HIT << " ";
-    std::cout << " ROW_BUFFER_MISS: " << std::setw(10) << channel.RQ_ROW_BUFFER_MISS;
-    std::cout << std::endl;
+  if (ptw->PREFETCH_WALKS > 0 || ptw->PREFETCH_DECLINED > 0)
+    cout << ptw->NAME << " PREFETCH WALKS: " << setw(10) << ptw->PREFETCH_WALKS << "  DECLINED: " << setw(10) << ptw->PREFETCH_DECLINED << endl;
 
-    std::cout << " DBUS AVG_CONGESTED_CYCLE: ";
-    if (channel.dbus_count_congested)
-      std::cout << std::setw(10) << ((double)channel.dbus_cycle_congested / channel.dbus_count_congested);
+  for (auto pscl : {&ptw->PSCL5, &ptw->PSCL4, &ptw->PSCL3, &ptw->PSCL2}) {
+    cout << ptw->NAME << " " << pscl->NAME << " ACCESS: " << setw(10) << pscl->ACCESS << "  HIT: " << setw(10) << pscl->HIT << "  HIT RATE: ";
+    if (pscl->ACCESS > 0)
+      cout << (1.0 * pscl->HIT) / pscl->ACCESS << endl;
     else
-      std::cout << "-";
-    std::cout << std::endl;
+      cout << "-" << endl;
+  }
 
-    std::cout << " WQ ROW_BUFFER_HIT: " << std::setw(10) << channel.WQ_ROW_BUFFER_HIT << " ";
-    std::cout << " ROW_BUFFER_MISS: " << std::setw(10) << channel.WQ_ROW_BUFFER_MISS << " ";
-    std::cout << " FULL: " << std::setw(10) << channel.WQ_FULL;
-    std::cout << std::endl;
+  for (std::size_t i = 0; i < std::size(ptw->walk_latency_histogram); ++i) {
+    if (ptw->walk_latency_histogram[i] > 0) {
+      cout << ptw->NAME << " WALK LATENCY " << setw(6) << (1ull << i) << "-";
+      if (i + 1 < std::size(ptw->walk_latency_histogram))
+        cout << setw(6) << (1ull << (i + 1)) - 1;
+      else
+        cout << setw(6) << "";
+      cout << " cycles: " << setw(10) << ptw->walk_latency_histogram[i] << endl;
+    }
+  }
+}
 
-    std::cout << std::endl;
+void print_dram_stats()
+{
+  uint64_t total_congested_cycle = 0;
+  uint64_t total_congested_count = 0;
 
-    total_congested_cycle += channel.dbus_cycle_congested;
-    total_congested_count += channel.dbus_count_congested;
+  std::cout << std::endl;
+  std::cout << "DRAM Statistics" << std::endl;
+  for (auto controller : memory_controllers) {
+    if (NUM_MEMORY_CONTROLLERS > 1)
+      std::cout << " CONTROLLER " << controller->node << " REMOTE_ACCESS: " << std::setw(10) << controller->REMOTE_ACCESS << std::endl << std::endl;
+
+    for (uint32_t i = 0; i < DRAM_CHANNELS; i++) {
+      std::cout << " CHANNEL " << i << std::endl;
+
+      auto& channel = controller->channels[i];
+      std::cout << " RQ ROW_BUFFER_HIT: " << std::setw(10) << channel.RQ_ROW_BUFFER_HIT << " ";
+      std::cout << " ROW_BUFFER_MISS: " << std::setw(10) << channel.RQ_ROW_BUFFER_MISS;
+      std::cout << std::endl;
+
+      std::cout << " DBUS AVG_CONGESTED_CYCLE: ";
+      if (channel.dbus_count_congested)
+        std::cout << std::setw(10) << ((double)channel.dbus_cycle_congested / channel.dbus_count_congested);
+      else
+        std::cout << "-";
+      std::cout << std::endl;
+
+      std::cout << " WQ ROW_BUFFER_HIT: " << std::setw(10) << channel.WQ_ROW_BUFFER_HIT << " ";
+      std::cout << " ROW_BUFFER_MISS: " << std::setw(10) << channel.WQ_ROW_BUFFER_MISS << " ";
+      std::cout << " FULL: " << std::setw(10) << channel.WQ_FULL;
+      std::cout << std::endl;
+
+      std::cout << std::endl;
+
+      total_congested_cycle += channel.dbus_cycle_congested;
+      total_congested_count += channel.dbus_count_congested;
+    }
   }
 
-  if (DRAM_CHANNELS > 1) {
+  if (DRAM_CHANNELS * NUM_MEMORY_CONTROLLERS > 1) {
     std::cout << " DBUS AVG_CONGESTED_CYCLE: ";
     if (total_congested_count)
       std::cout << std::setw(10) << ((double)total_congested_cycle / total_congested_count);
@@ -239,6 +324,19 @@ void reset_cache_stats(uint32_t cpu, CACHE* cache)
   cache->pf_fill = 0;
 
   cache->total_miss_latency = 0;
+  cache->BACK_INVAL = 0;
+  cache->HUGE_PAGE_HIT = 0;
+  cache->VA_TRANSLATED = 0;
+  cache->VA_MERGED = 0;
+  cache->VA_DROPPED = 0;
+
+  if (cache->profiler)
+    cache->profiler->clear();
+
+  if (cache->throttle) {
+    cache->throttle->throttled = 0;
+    cache->throttle->epochs = 0;
+  }
 
   cache->RQ_ACCESS = 0;
   cache->RQ_MERGED = 0;
@@ -285,15 +383,29 @@ void finish_warmup()
 
     for (auto it = caches.rbegin(); it != caches.rend(); ++it)
       reset_cache_stats(i, *it);
+
+    // reset page walk stats
+    ptws[i]->total_miss_latency = 0;
+    ptws[i]->WALKS = 0;
+    ptws[i]->PREFETCH_WALKS = 0;
+    ptws[i]->PREFETCH_DECLINED = 0;
+    ptws[i]->walk_latency_histogram = {};
+    for (auto pscl : {&ptws[i]->PSCL5, &ptws[i]->PSCL4, &ptws[i]->PSCL3, &ptws[i]->PSCL2}) {
+      pscl->ACCESS = 0;
+      pscl->HIT = 0;
+    }
   }
   cout << endl;
 
   // reset DRAM stats
-  for (uint32_t i = 0; i < DRAM_CHANNELS; i++) {
-    DRAM.channels[i].WQ_ROW_BUFFER_HIT = 0;
-    DRAM.channels[i].WQ_ROW_BUFFER_MISS = 0;
-    DRAM.channels[i].RQ_ROW_BUFFER_HIT = 0;
-    DRAM.channels[i].RQ_ROW_BUFFER_MISS = 0;
+  for (auto controller : memory_controllers) {
+    controller->REMOTE_ACCESS = 0;
+    for (auto& channel : controller->channels) {
+      channel.WQ_ROW_BUFFER_HIT = 0;
+      channel.WQ_ROW_BUFFER_MISS = 0;
+      channel.RQ_ROW_BUFFER_HIT = 0;
+      channel.RQ_ROW_BUFFER_MISS = 0;
+    }
   }
 }
 
@@ -353,18 +465,22 @@ int main(int argc, char** argv)
   cout << "Simulation Instructions: " << simulation_instructions << endl;
   cout << "Number of CPUs: " << NUM_CPUS << endl;
 
-  long long int dram_size = DRAM_CHANNELS * DRAM_RANKS * DRAM_BANKS * DRAM_ROWS * DRAM_COLUMNS * BLOCK_SIZE / 1024 / 1024; // in MiB
+  long long int dram_size = NUM_MEMORY_CONTROLLERS * DRAM_CHANNELS * DRAM_RANKS * DRAM_BANKS * DRAM_ROWS * DRAM_COLUMNS * BLOCK_SIZE / 1024 / 1024; // in MiB
   std::cout << "Off-chip DRAM Size: ";
   if (dram_size > 1024)
     std::cout << dram_size / 1024 << " GiB";
   else
     std::cout << dram_size << " MiB";
+  if (NUM_MEMORY_CONTROLLERS > 1)
+    std::cout << " Controllers: " << NUM_MEMORY_CONTROLLERS;
   std::cout << " Channels: " << DRAM_CHANNELS << " Width: " << 8 * DRAM_CHANNEL_WIDTH << "-bit Data Rate: " << DRAM_IO_FREQ << " MT/s" << std::endl;
 
   std::cout << std::endl;
-  std::cout << "VirtualMemory physical capacity: " << std::size(vmem.ppage_free_list) * vmem.page_size;
-  std::cout << " num_ppages: " << std::size(vmem.ppage_free_list) << std::endl;
+  std::cout << "VirtualMemory physical capacity: " << vmem.available_ppages() * vmem.page_size;
+  std::cout << " num_ppages: " << vmem.available_ppages() << std::endl;
   std::cout << "VirtualMemory page size: " << PAGE_SIZE << " log2_page_size: " << LOG2_PAGE_SIZE << std::endl;
+  if (vmem.huge_pages != VirtualMemory::huge_page_t::NONE)
+    std::cout << "VirtualMemory huge page size: " << HUGE_PAGE_SIZE << " page table level: " << vmem.huge_page_level << std::endl;
 
   std::cout << std::endl;
   for (int i = optind; i < argc; i++) {
@@ -389,11 +505,32 @@ int main(int argc, char** argv)
     cpu->initialize_core();
   }
 
+  // link each cache to the caches above it
+  for (CACHE* ul : caches) {
+    for (CACHE* ll : caches) {
+      if (ul->lower_level == ll) {
+        ll->upper_levels.push_back(ul);
+        ul->send_clean_victims = (ll->inclusion_policy == CACHE::inclusion_t::EXCLUSIVE);
+      }
+    }
+  }
+
+  // a region promoted to a huge page is shot down from the translation caches between the core and its page table walker
+  vmem.shootdown_listeners.push_back([](uint32_t cpu_num, uint64_t vaddr, uint64_t frame) {
+    for (auto ll : {ooo_cpu[cpu_num]->ITLB_bus.lower_level, ooo_cpu[cpu_num]->DTLB_bus.lower_level}) {
+      for (auto tlb = dynamic_cast<CACHE*>(ll); tlb != nullptr; tlb = dynamic_cast<CACHE*>(tlb->lower_level))
+        tlb->shootdown(vaddr, frame);
+    }
+  });
+
   for (auto it = caches.rbegin(); it != caches.rend(); ++it) {
     (*it)->impl_prefetcher_initialize();
     (*it)->impl_replacement_initialize();
   }
 
+  for (auto controller : memory_controllers)
+    controller->impl_dram_scheduler_initialize();
+
   // simulation entry point
   while (std::any_of(std::begin(simulation_complete), std::end(simulation_complete), std::logical_not<uint8_t>())) {
 
@@ -419,6 +556,9 @@ int main(int argc, char** argv)
     std::sort(std::begin(operables), std::end(operables), champsim::by_next_operate());
 
     for (std::size_t i = 0; i < ooo_cpu.size(); ++i) {
+      // move predicted instructions from the FTQ to the fetch buffer, if the core has one
+      ooo_cpu[i]->fetch_from_ftq();
+
       // read from trace
       while (ooo_cpu[i]->fetch_stall == 0 && ooo_cpu[i]->instrs_to_read_this_cycle > 0) {
         ooo_cpu[i]->init_instruction(traces[i]->get());
@@ -495,6 +635,21 @@ int main(int argc, char** argv)
     cout << " instructions: " << ooo_cpu[i]->finish_sim_instr << " cycles: " << ooo_cpu[i]->finish_sim_cycle << endl;
     for (auto it = caches.rbegin(); it != caches.rend(); ++it)
       print_roi_stats(i, *it);
+    print_ptw_stats(ptws[i]);
+  }
+
+  for (auto it = caches.rbegin(); it != caches.rend(); ++it) {
+    if ((*it)->profiler) {
+      std::string fname = (*it)->NAME + ".profile.json";
+      std::ofstream profile_file{fname};
+      (*it)->profiler->dump(profile_file, (*it)->NAME, (*it)->SET_SAMPLE_RATE);
+      cout << (*it)->NAME << " profile written to " << fname << endl;
+    }
+
+    if ((*it)->recorder) {
+      (*it)->recorder->close();
+      cout << (*it)->NAME << " accesses recorded to " << (*it)->recorder->fname << endl;
+    }
   }
 
   for (auto it = caches.rbegin(); it != caches.rend(); ++it)
@@ -505,6 +660,10 @@ int main(int argc, char** argv)
 
 #ifndef CRC2_COMPILE
   print_dram_stats();
+  for (auto controller : memory_controllers)
+    controller->impl_dram_scheduler_final_stats();
+  if (vmem.huge_pages != VirtualMemory::huge_page_t::NONE)
+    std::cout << std::endl << "VirtualMemory HUGE PAGES: " << vmem.huge_pages_mapped << " PROMOTIONS: " << vmem.promotions << std::endl;
   print_branch_stats();
 #endif
 
@@ -14,7 +14,11 @@ extern uint8_t MAX_INSTR_DESTINATIONS;
 
 void O3_CPU::operate()
 {
-  instrs_to_read_this_cycle = std::min((std::size_t)FETCH_WIDTH, IFETCH_BUFFER.size() - IFETCH_BUFFER.occupancy());
+  instrs_to_fetch_this_cycle = std::min((std::size_t)FETCH_WIDTH, IFETCH_BUFFER.size() - IFETCH_BUFFER.occupancy());
+  if (FTQ_SIZE == 0)
+    instrs_to_read_this_cycle = instrs_to_fetch_this_cycle;
+  else
+    instrs_to_read_this_cycle = (ftq_targets < FTQ_SIZE) ? FETCH_WIDTH : 0;
 
   retire_rob();                    // retire
   complete_inflight_instruction(); // finalize execution
@@ -42,33 +46,113 @@ void O3_CPU::initialize_core()
   impl_btb_initialize();
 }
 
-void O3_CPU::init_instruction(ooo_model_instr arch_instr)
+register_usage get_register_usage(const ooo_model_instr& instr)
 {
-  instrs_to_read_this_cycle--;
-
-  arch_instr.instr_id = instr_unique_id;
-
-  bool reads_sp = false;
-  bool writes_sp = false;
-  bool reads_flags = false;
-  bool reads_ip = false;
-  bool writes_ip = false;
-  bool reads_other = false;
-
+  register_usage regs;
   for (uint32_t i = 0; i < MAX_INSTR_DESTINATIONS; i++) {
-    switch (arch_instr.destination_registers[i]) {
+    switch (instr.destination_registers[i]) {
+    case 0:
+      break;
+    case REG_STACK_POINTER:
+      regs.writes_sp = true;
+      break;
+    case REG_INSTRUCTION_POINTER:
+      regs.writes_ip = true;
+      break;
+    default:
+      break;
+    }
+  }
+
+  for (auto reg : instr.source_registers) {
+    switch (reg) {
     case 0:
       break;
     case REG_STACK_POINTER:
-      writes_sp = true;
+      regs.reads_sp = true;
+      break;
+    case REG_FLAGS:
+      regs.reads_flags = true;
       break;
     case REG_INSTRUCTION_POINTER:
-      writes_ip = true;
+      regs.reads_ip = true;
       break;
     default:
+      regs.reads_other = true;
       break;
     }
+  }
+
+  return regs;
+}
+
+void decode_branch(ooo_model_instr& instr, const register_usage& regs)
+{
+  if (!regs.reads_sp && !regs.reads_flags && regs.writes_ip && !regs.reads_other) {
+    // direct jump
+    instr.is_branch = 1;
+    instr.branch_taken = 1;
+    instr.branch_type = BRANCH_DIRECT_JUMP;
+  } else if (!regs.reads_sp && !regs.reads_flags && regs.writes_ip && regs.reads_other) {
+    // indirect branch
+    instr.is_branch = 1;
+    instr.branch_taken = 1;
+    instr.branch_type = BRANCH_INDIRECT;
+  } else if (!regs.reads_sp && regs.reads_ip && !regs.writes_sp && regs.writes_ip && regs.reads_flags && !regs.reads_other) {
+    // conditional branch
+    instr.is_branch = 1;
+    instr.branch_taken = instr.branch_taken; // don't change this
+    instr.branch_type = BRANCH_CONDITIONAL;
+  } else if (regs.reads_sp && regs.reads_ip && regs.writes_sp && regs.writes_ip && !regs.reads_flags && !regs.reads_other) {
+    // direct call
+    instr.is_branch = 1;
+    instr.branch_taken = 1;
+    instr.branch_type = BRANCH_DIRECT_CALL;
+  } else if (regs.reads_sp && regs.reads_ip && regs.writes_sp && regs.writes_ip && !regs.reads_flags && regs.reads_other) {
+    // indirect call
+    instr.is_branch = 1;
+    instr.branch_taken = 1;
+    instr.branch_type = BRANCH_INDIRECT_CALL;
+  } else if (regs.reads_sp && !regs.reads_ip && regs.writes_sp && regs.writes_ip) {
+    // return
+    instr.is_branch = 1;
+    instr.branch_taken = 1;
+    instr.branch_type = BRANCH_RETURN;
+  } else if (regs.writes_ip) {
+    // some other branch type that doesn't fit the above categories
+    instr.is_branch = 1;
+    instr.branch_taken = instr.branch_taken; // don't change this
+    instr.branch_type = BRANCH_OTHER;
+  }
 
+  if ((instr.is_branch != 1) || (instr.branch_taken != 1)) {
+    // clear the branch target for this instruction
+    instr.branch_target = 0;
+  }
+}
+
+uint64_t O3_CPU::get_predicted_target(const ooo_model_instr& instr)
+{
+  std::pair<uint64_t, uint8_t> btb_result = impl_btb_prediction(instr.ip, instr.branch_type);
+  uint64_t predicted_branch_target = btb_result.first;
+  uint8_t always_taken = btb_result.second;
+  uint8_t branch_prediction = impl_predict_branch(instr.ip, predicted_branch_target, always_taken, instr.branch_type);
+  if ((branch_prediction == 0) && (always_taken == 0)) {
+    predicted_branch_target = 0;
+  }
+
+  return predicted_branch_target;
+}
+
+void O3_CPU::init_instruction(ooo_model_instr arch_instr)
+{
+  instrs_to_read_this_cycle--;
+
+  arch_instr.instr_id = instr_unique_id;
+
+  register_usage regs = get_register_usage(arch_instr);
+
+  for (uint32_t i = 0; i < MAX_INSTR_DESTINATIONS; i++) {
     /*
        if((arch_instr.is_branch) && (arch_instr.destination_registers[i] > 24)
        && (arch_instr.destination_registers[i] < 28))
@@ -94,23 +178,6 @@ void O3_CPU::init_instruction(ooo_model_instr arch_instr)
   }
 
   for (int i = 0; i < NUM_INSTR_SOURCES; i++) {
-    switch (arch_instr.source_registers[i]) {
-    case 0:
-      break;
-    case REG_STACK_POINTER:
-      reads_sp = true;
-      break;
-    case REG_FLAGS:
-      reads_flags = true;
-      break;
-    case REG_INSTRUCTION_POINTER:
-      reads_ip = true;
-      break;
-    default:
-      reads_other = true;
-      break;
-    }
-
     /*
        if((!arch_instr.is_branch) && (arch_instr.source_registers[i] > 25) &&
        (arch_instr.source_registers[i] < 28))
@@ -129,63 +196,22 @@ void O3_CPU::init_instruction(ooo_model_instr arch_instr)
     arch_instr.is_memory = 1;
 
   // determine what kind of branch this is, if any
-  if (!reads_sp && !reads_flags && writes_ip && !reads_other) {
-    // direct jump
-    arch_instr.is_branch = 1;
-    arch_instr.branch_taken = 1;
-    arch_instr.branch_type = BRANCH_DIRECT_JUMP;
-  } else if (!reads_sp && !reads_flags && writes_ip && reads_other) {
-    // indirect branch
-    arch_instr.is_branch = 1;
-    arch_instr.branch_taken = 1;
-    arch_instr.branch_type = BRANCH_INDIRECT;
-  } else if (!reads_sp && reads_ip && !writes_sp && writes_ip && reads_flags && !reads_other) {
-    // conditional branch
-    arch_instr.is_branch = 1;
-    arch_instr.branch_taken = arch_instr.branch_taken; // don't change this
-    arch_instr.branch_type = BRANCH_CONDITIONAL;
-  } else if (reads_sp && reads_ip && writes_sp && writes_ip && !reads_flags && !reads_other) {
-    // direct call
-    arch_instr.is_branch = 1;
-    arch_instr.branch_taken = 1;
-    arch_instr.branch_type = BRANCH_DIRECT_CALL;
-  } else if (reads_sp && reads_ip && writes_sp && writes_ip && !reads_flags && reads_other) {
-    // indirect call
-    arch_instr.is_branch = 1;
-    arch_instr.branch_taken = 1;
-    arch_instr.branch_type = BRANCH_INDIRECT_CALL;
-  } else if (reads_sp && !reads_ip && writes_sp && writes_ip) {
-    // return
-    arch_instr.is_branch = 1;
-    arch_instr.branch_taken = 1;
-    arch_instr.branch_type = BRANCH_RETURN;
-  } else if (writes_ip) {
-    // some other branch type that doesn't fit the above categories
-    arch_instr.is_branch = 1;
-    arch_instr.branch_taken = arch_instr.branch_taken; // don't change this
-    arch_instr.branch_type = BRANCH_OTHER;
-  }
-
+  decode_branch(arch_instr, regs);
   total_branch_types[arch_instr.branch_type]++;
 
-  if ((arch_instr.is_branch != 1) || (arch_instr.branch_taken != 1)) {
-    // clear the branch target for this instruction
-    arch_instr.branch_target = 0;
-  }
-
   // Stack Pointer Folding
   // The exact, true value of the stack pointer for any given instruction can
   // usually be determined immediately after the instruction is decoded without
   // waiting for the stack pointer's dependency chain to be resolved.
   // We're doing it here because we already have writes_sp and reads_other
   // handy, and in ChampSim it doesn't matter where before execution you do it.
-  if (writes_sp) {
+  if (regs.writes_sp) {
     // Avoid creating register dependencies on the stack pointer for calls,
     // returns, pushes, and pops, but not for variable-sized changes in the
     // stack pointer position. reads_other indicates that the stack pointer is
     // being changed by a variable amount, which can't be determined before
     // execution.
-    if ((arch_instr.is_branch != 0) || (arch_instr.num_mem_ops > 0) || (!reads_other)) {
+    if ((arch_instr.is_branch != 0) || (arch_instr.num_mem_ops > 0) || (!regs.reads_other)) {
       for (uint32_t i = 0; i < MAX_INSTR_DESTINATIONS; i++) {
         if (arch_instr.destination_registers[i] == REG_STACK_POINTER) {
           arch_instr.destination_registers[i] = 0;
@@ -206,13 +232,7 @@ void O3_CPU::init_instruction(ooo_model_instr arch_instr)
 
     num_branch++;
 
-    std::pair<uint64_t, uint8_t> btb_result = impl_btb_prediction(arch_instr.ip, arch_instr.branch_type);
-    uint64_t predicted_branch_target = btb_result.first;
-    uint8_t always_taken = btb_result.second;
-    uint8_t branch_prediction = impl_predict_branch(arch_instr.ip, predicted_branch_target, always_taken, arch_instr.branch_type);
-    if ((branch_prediction == 0) && (always_taken == 0)) {
-      predicted_branch_target = 0;
-    }
+    uint64_t predicted_branch_target = get_predicted_target(arch_instr);
 
     // call code prefetcher every time the branch predictor is used
     impl_prefetcher_branch_operate(arch_instr.ip, arch_instr.branch_type, predicted_branch_target);
@@ -252,12 +272,50 @@ void O3_CPU::init_instruction(ooo_model_instr arch_instr)
     arch_instr.num_reg_ops = 0;
   }
 
-  // Add to IFETCH_BUFFER
-  IFETCH_BUFFER.push_back(arch_instr);
+  if (FTQ_SIZE == 0) {
+    // Add to IFETCH_BUFFER
+    IFETCH_BUFFER.push_back(arch_instr);
+  } else {
+    // Add to the FTQ, and prefetch each new block as it is predicted
+    uint64_t block = arch_instr.ip >> LOG2_BLOCK_SIZE;
+    if (std::empty(FTQ) || starts_fetch_target(FTQ.back(), arch_instr))
+      ftq_targets++;
+    if (std::empty(FTQ) || (FTQ.back().ip >> LOG2_BLOCK_SIZE) != block)
+      prefetch_code_line(block << LOG2_BLOCK_SIZE);
+    FTQ.push_back(arch_instr);
+
+    if (ftq_targets >= FTQ_SIZE)
+      instrs_to_read_this_cycle = 0;
+  }
 
   instr_unique_id++;
 }
 
+// A new fetch target begins at a block boundary, after a taken branch, or wherever the instruction pointer does not advance, so that
+// a loop within one block is still limited by the size of the queue
+bool O3_CPU::starts_fetch_target(const ooo_model_instr& prev, const ooo_model_instr& next)
+{
+  return (prev.is_branch && prev.branch_taken) || next.ip <= prev.ip || (next.ip >> LOG2_BLOCK_SIZE) != (prev.ip >> LOG2_BLOCK_SIZE);
+}
+
+void O3_CPU::fetch_from_ftq()
+{
+  while (instrs_to_fetch_this_cycle > 0 && !std::empty(FTQ)) {
+    ooo_model_instr& instr = FTQ.front();
+    instr.event_cycle = current_cycle;
+    IFETCH_BUFFER.push_back(instr);
+    instrs_to_fetch_this_cycle--;
+
+    // a taken branch ends the fetch block
+    if (instr.is_branch && instr.branch_taken)
+      instrs_to_fetch_this_cycle = 0;
+
+    if (std::size(FTQ) == 1 || starts_fetch_target(FTQ[0], FTQ[1]))
+      ftq_targets--;
+    FTQ.pop_front();
+  }
+}
+
 void O3_CPU::check_dib()
 {
   // scan through IFETCH_BUFFER to find instructions that hit in the decoded
@@ -483,7 +541,7 @@ void O3_CPU::dispatch_instruction()
     throw champsim::deadlock{cpu};
 }
 
-int O3_CPU::prefetch_code_line(uint64_t pf_v_addr) { return static_cast<CACHE*>(L1I_bus.lower_level)->prefetch_line(0, pf_v_addr, pf_v_addr, true, 0); }
+int O3_CPU::prefetch_code_line(uint64_t pf_v_addr) { return static_cast<CACHE*>(L1I_bus.lower_level)->prefetch_line(pf_v_addr, true, 0); }
 
 void O3_CPU::schedule_instruction()
 {
@@ -0,0 +1,109 @@
+#include "prefetch_throttle.h"
+
+#include <algorithm>
+#include <iterator>
+
+namespace champsim
+{
+
+std::size_t prefetch_throttle::filter_index(uint64_t block)
+{
+  return (block ^ (block >> LOG2_POLLUTION_FILTER_SIZE)) & ((1ull << LOG2_POLLUTION_FILTER_SIZE) - 1);
+}
+
+void prefetch_throttle::begin_trigger(uint64_t trigger_block)
+{
+  triggers[next_trigger] = trigger_block;
+  next_trigger = (next_trigger + 1) % std::size(triggers);
+  num_triggers = std::min(num_triggers + 1, std::size(triggers));
+  issued_this_trigger = 0;
+}
+
+prefetch_throttle::verdict prefetch_throttle::allow(uint64_t pf_block)
+{
+  auto near = [pf_block, limit = current().distance](uint64_t trigger) {
+    return ((pf_block > trigger) ? (pf_block - trigger) : (trigger - pf_block)) <= limit;
+  };
+
+  if (num_triggers > 0 && std::none_of(std::begin(triggers), std::next(std::begin(triggers), num_triggers), near)) {
+    throttled++;
+    return verdict::DROP;
+  }
+
+  if (issued_this_trigger >= current().degree) {
+    throttled++;
+    return verdict::DEFER;
+  }
+
+  issued_this_trigger++;
+  return verdict::ISSUE;
+}
+
+void prefetch_throttle::record_fill(uint64_t fill_block, bool demand, bool prefetch, bool evicting, uint64_t evicted_block)
+{
+  // a demand miss to a block that a prefetch evicted is pollution
+  if (demand) {
+    epoch.demand_miss++;
+    if (pollution_filter.test(filter_index(fill_block)))
+      epoch.polluting++;
+    pollution_filter.reset(filter_index(fill_block));
+  }
+
+  if (prefetch && evicting)
+    pollution_filter.set(filter_index(evicted_block));
+
+  if (++fills >= EPOCH_LENGTH)
+    end_epoch();
+}
+
+void prefetch_throttle::end_epoch()
+{
+  history.issued = history.issued / 2 + epoch.issued;
+  history.useful = history.useful / 2 + epoch.useful;
+  history.late = history.late / 2 + epoch.late;
+  history.demand_miss = history.demand_miss / 2 + epoch.demand_miss;
+  history.polluting = history.polluting / 2 + epoch.polluting;
+  history.dram_occupancy = history.dram_occupancy / 2 + epoch.dram_occupancy;
+  history.dram_size = history.dram_size / 2 + epoch.dram_size;
+
+  epoch = {};
+  fills = 0;
+  epochs++;
+
+  // an idle prefetcher gives no feedback
+  if (history.issued == 0)
+    return;
+
+  double accuracy = 1.0 * history.useful / history.issued;
+  bool late = history.useful > 0 && (1.0 * history.late / history.useful) > LATENESS_THRESHOLD;
+  bool polluting = history.demand_miss > 0 && (1.0 * history.polluting / history.demand_miss) > POLLUTION_THRESHOLD;
+  bool bandwidth_bound = history.dram_size > 0 && (1.0 * history.dram_occupancy / history.dram_size) > BANDWIDTH_THRESHOLD;
+
+  // Table 2 of the FDP paper
+  int direction = 0;
+  if (accuracy >= ACCURACY_HIGH) {
+    if (late)
+      direction = 1;
+    else if (polluting)
+      direction = -1;
+  } else if (accuracy >= ACCURACY_LOW) {
+    if (late && !polluting)
+      direction = 1;
+    else if (polluting)
+      direction = -1;
+  } else {
+    if (late || polluting)
+      direction = -1;
+  }
+
+  // when memory bandwidth is scarce, only highly accurate prefetchers keep their aggressiveness
+  if (bandwidth_bound)
+    direction = (accuracy >= ACCURACY_HIGH) ? std::min(direction, 0) : -1;
+
+  if (direction > 0 && level + 1 < std::size(LEVELS))
+    level++;
+  else if (direction < 0 && level > 0)
+    level--;
+}
+
+} // namespace champsim
@@ -1,5 +1,8 @@
 #include "ptw.h"
 
+#include <algorithm>
+#include <functional>
+
 #include "champsim.h"
 #include "util.h"
 #include "vmem.h"
@@ -22,7 +25,7 @@ void PageTableWalker::handle_read()
 {
   int reads_this_cycle = MAX_READ;
 
-  while (reads_this_cycle > 0 && RQ.has_ready() && std::size(MSHR) != MSHR_SIZE) {
+  while (reads_this_cycle > 0 && RQ.has_ready() && mshr_occupancy != MSHR_SIZE) {
     PACKET& handle_pkt = RQ.front();
 
     DP(if (warmup_complete[packet->cpu]) {
@@ -36,8 +39,10 @@ void PageTableWalker::handle_read()
 
     auto ptw_addr = splice_bits(CR3_addr, vmem.get_offset(handle_pkt.address, vmem.pt_levels - 1) * PTE_BYTES, LOG2_PAGE_SIZE);
     auto ptw_level = vmem.pt_levels - 1;
+    auto leaf_level = vmem.page_level(cpu, handle_pkt.address);
     for (auto pscl : {&PSCL5, &PSCL4, &PSCL3, &PSCL2}) {
-      if (auto check_addr = pscl->check_hit(handle_pkt.address); check_addr.has_value()) {
+      // an entry that points below the leaf of a huge page is stale, left from before the region was promoted
+      if (auto check_addr = pscl->check_hit(handle_pkt.address); check_addr.has_value() && pscl->level - 1 >= leaf_level) {
         ptw_addr = check_addr.value();
         ptw_level = pscl->level - 1;
       }
@@ -60,9 +65,11 @@ void PageTableWalker::handle_read()
     packet.to_return = handle_pkt.to_return; // Set the return for MSHR packet same as read packet.
     packet.type = handle_pkt.type;
 
-    auto it = MSHR.insert(std::end(MSHR), packet);
+    auto it = std::find_if_not(std::begin(MSHR), std::end(MSHR), is_valid<PACKET>());
+    *it = packet;
     it->cycle_enqueued = current_cycle;
     it->event_cycle = std::numeric_limits<uint64_t>::max();
+    mshr_occupancy++;
 
     RQ.pop_front();
     reads_this_cycle--;
@@ -73,19 +80,24 @@ void PageTableWalker::handle_fill()
 {
   int fill_this_cycle = MAX_FILL;
 
-  while (fill_this_cycle > 0 && !std::empty(MSHR) && MSHR.front().event_cycle <= current_cycle) {
-    auto fill_mshr = MSHR.begin();
-    if (fill_mshr->translation_level == 0) // If translation complete
+  while (fill_this_cycle > 0 && !std::empty(mshr_ready) && std::get<0>(mshr_ready.front()) <= current_cycle) {
+    auto ready = mshr_ready.front();
+    std::pop_heap(std::begin(mshr_ready), std::end(mshr_ready), std::greater<>{});
+    mshr_ready.pop_back();
+
+    auto idx = std::get<2>(ready);
+    auto fill_mshr = std::next(std::begin(MSHR), idx);
+    if (fill_mshr->translation_level <= vmem.page_level(cpu, fill_mshr->v_address)) // If translation complete, which is early for huge pages
     {
       // Return the translated physical address to STLB. Does not contain last
       // 12 bits
       auto [addr, fault] = vmem.va_to_pa(cpu, fill_mshr->v_address);
       if (warmup_complete[cpu] && fault) {
-        fill_mshr->event_cycle = current_cycle + vmem.minor_fault_penalty;
-        MSHR.sort(ord_event_cycle<PACKET>{});
+        schedule_mshr(idx, current_cycle + vmem.minor_fault_penalty);
       } else {
         fill_mshr->data = addr;
         fill_mshr->address = fill_mshr->v_address;
+        fill_mshr->page_level = vmem.page_level(cpu, fill_mshr->v_address);
 
         DP(if (warmup_complete[packet->cpu]) {
           std::cout << "[" << NAME << "] " << __func__ << " instr_id: " << fill_mshr->instr_id;
@@ -93,23 +105,29 @@ void PageTableWalker::handle_fill()
           std::cout << " full_v_addr: " << fill_mshr->v_address;
           std::cout << " data: " << fill_mshr->data << std::dec;
           std::cout << " translation_level: " << +fill_mshr->translation_level;
-          std::cout << " index: " << std::distance(MSHR.begin(), fill_mshr) << " occupancy: " << get_occupancy(0, 0);
+          std::cout << " index: " << idx << " occupancy: " << get_occupancy(0, 0);
           std::cout << " event: " << fill_mshr->event_cycle << " current: " << current_cycle << std::endl;
         });
 
         for (auto ret : fill_mshr->to_return)
           ret->return_data(&(*fill_mshr));
 
-        if (warmup_complete[cpu])
-          total_miss_latency += current_cycle - fill_mshr->cycle_enqueued;
+        if (warmup_complete[cpu]) {
+          uint64_t latency = current_cycle - fill_mshr->cycle_enqueued;
+          total_miss_latency += latency;
+          WALKS++;
+          if (fill_mshr->type == PREFETCH)
+            PREFETCH_WALKS++;
+          walk_latency_histogram[std::min<std::size_t>(lg2(latency), std::size(walk_latency_histogram) - 1)]++;
+        }
 
-        MSHR.erase(fill_mshr);
+        *fill_mshr = {};
+        mshr_occupancy--;
       }
     } else {
       auto [addr, fault] = vmem.get_pte_pa(cpu, fill_mshr->v_address, fill_mshr->translation_level);
       if (warmup_complete[cpu] && fault) {
-        fill_mshr->event_cycle = current_cycle + vmem.minor_fault_penalty;
-        MSHR.sort(ord_event_cycle<PACKET>{});
+        schedule_mshr(idx, current_cycle + vmem.minor_fault_penalty);
       } else {
         if (fill_mshr->translation_level == PSCL5.level)
           PSCL5.fill_cache(addr, fill_mshr->v_address);
@@ -126,7 +144,7 @@ void PageTableWalker::handle_fill()
           std::cout << " full_v_addr: " << fill_mshr->v_address;
           std::cout << " data: " << fill_mshr->data << std::dec;
           std::cout << " translation_level: " << +fill_mshr->translation_level;
-          std::cout << " index: " << std::distance(MSHR.begin(), fill_mshr) << " occupancy: " << get_occupancy(0, 0);
+          std::cout << " index: " << idx << " occupancy: " << get_occupancy(0, 0);
           std::cout << " event: " << fill_mshr->event_cycle << " current: " << current_cycle << std::endl;
         });
 
@@ -138,13 +156,16 @@ void PageTableWalker::handle_fill()
         packet.translation_level = fill_mshr->translation_level - 1;
 
         int rq_index = lower_level->add_rq(&packet);
-        if (rq_index != -2) {
-          fill_mshr->event_cycle = std::numeric_limits<uint64_t>::max();
-          fill_mshr->address = packet.address;
-          fill_mshr->translation_level--;
-
-          MSHR.splice(std::end(MSHR), MSHR, fill_mshr);
+        if (rq_index == -2) {
+          // try again next cycle, in the same order
+          mshr_ready.push_back(ready);
+          std::push_heap(std::begin(mshr_ready), std::end(mshr_ready), std::greater<>{});
+          return;
         }
+
+        fill_mshr->event_cycle = std::numeric_limits<uint64_t>::max();
+        fill_mshr->address = packet.address;
+        fill_mshr->translation_level--;
       }
     }
 
@@ -165,7 +186,16 @@ int PageTableWalker::add_rq(PACKET* packet)
 
   // check for duplicates in the read queue
   auto found_rq = std::find_if(RQ.begin(), RQ.end(), eq_addr<PACKET>(packet->address, LOG2_PAGE_SIZE));
-  assert(found_rq == RQ.end()); // Duplicate request should not be sent.
+  assert(found_rq == RQ.end() || found_rq->type == PREFETCH); // Duplicate request should not be sent.
+
+  // a demand miss takes over a prefetch walk that has not yet started
+  if (found_rq != RQ.end()) {
+    packet_dep_merge(found_rq->to_return, packet->to_return);
+    found_rq->type = packet->type;
+    found_rq->instr_id = packet->instr_id;
+    found_rq->ip = packet->ip;
+    return RQ.occupancy();
+  }
 
   // check occupancy
   if (RQ.full()) {
@@ -178,11 +208,62 @@ int PageTableWalker::add_rq(PACKET* packet)
   return RQ.occupancy();
 }
 
+bool PageTableWalker::declines_prefetch(uint64_t address)
+{
+  // a prefetch may not take a page fault
+  if (vmem.is_mapped(cpu, address))
+    return false;
+
+  PREFETCH_DECLINED++;
+  return true;
+}
+
+int PageTableWalker::add_pq(PACKET* packet)
+{
+  assert(packet->address != 0);
+
+  // prefetches for unmapped pages are dropped when they are issued, see declines_prefetch()
+  assert(vmem.is_mapped(cpu, packet->address));
+
+  // a walk for the same page is already waiting or in flight
+  auto found_rq = std::find_if(RQ.begin(), RQ.end(), eq_addr<PACKET>(packet->address, LOG2_PAGE_SIZE));
+  if (found_rq != RQ.end()) {
+    packet_dep_merge(found_rq->to_return, packet->to_return);
+    return 0;
+  }
+  auto found_mshr = std::find_if(std::begin(MSHR), std::end(MSHR), [addr = packet->address](const PACKET& x) {
+    return is_valid<PACKET>{}(x) && (x.v_address >> LOG2_PAGE_SIZE) == (addr >> LOG2_PAGE_SIZE);
+  });
+  if (found_mshr != std::end(MSHR)) {
+    packet_dep_merge(found_mshr->to_return, packet->to_return);
+    return 0;
+  }
+
+  if (RQ.full())
+    return -2;
+
+  PACKET walk = *packet;
+  walk.type = PREFETCH;
+  RQ.push_back(walk);
+
+  return RQ.occupancy();
+}
+
+void PageTableWalker::schedule_mshr(std::size_t idx, uint64_t cycle)
+{
+  MSHR[idx].event_cycle = cycle;
+  mshr_ready.emplace_back(cycle, mshr_order++, idx);
+  std::push_heap(std::begin(mshr_ready), std::end(mshr_ready), std::greater<>{});
+}
+
 void PageTableWalker::return_data(PACKET* packet)
 {
-  for (auto& mshr_entry : MSHR) {
-    if (eq_addr<PACKET>{packet->address, LOG2_BLOCK_SIZE}(mshr_entry)) {
-      mshr_entry.event_cycle = current_cycle;
+  for (std::size_t idx = 0; idx < std::size(MSHR); ++idx) {
+    auto& mshr_entry = MSHR[idx];
+
+    // only walks waiting on the memory system are woken; a walk already in the heap keeps its place
+    if (mshr_entry.event_cycle == std::numeric_limits<uint64_t>::max() && eq_addr<PACKET>{packet->address, LOG2_BLOCK_SIZE}(mshr_entry)) {
+      schedule_mshr(idx, current_cycle);
 
       DP(if (warmup_complete[cpu]) {
         std::cout << "[" << NAME << "_MSHR] " << __func__ << " instr_id: " << mshr_entry.instr_id;
@@ -195,15 +276,13 @@ void PageTableWalker::return_data(PACKET* packet)
       });
     }
   }
-
-  MSHR.sort(ord_event_cycle<PACKET>());
 }
 
 uint32_t PageTableWalker::get_occupancy(uint8_t queue_type, uint64_t address)
 {
   if (queue_type == 0)
-    return std::count_if(MSHR.begin(), MSHR.end(), is_valid<PACKET>());
-  else if (queue_type == 1)
+    return mshr_occupancy;
+  else if (queue_type == 1 || queue_type == 3)
     return RQ.occupancy();
   return 0;
 }
@@ -212,7 +291,7 @@ uint32_t PageTableWalker::get_size(uint8_t queue_type, uint64_t address)
 {
   if (queue_type == 0)
     return MSHR_SIZE;
-  else if (queue_type == 1)
+  else if (queue_type == 1 || queue_type == 3)
     return RQ.size();
   return 0;
 }
@@ -235,18 +314,24 @@ std::optional<uint64_t> PagingStructureCache::check_hit(uint64_t address)
   auto set_end = std::next(set_begin, NUM_WAY);
   auto hit_block = std::find_if(set_begin, set_end, eq_addr<block_t>{address, vmem.shamt(level + 1)});
 
-  if (hit_block != set_end)
+  ACCESS++;
+  if (hit_block != set_end) {
+    HIT++;
     return splice_bits(hit_block->data, vmem.get_offset(address, level) * PTE_BYTES, LOG2_PAGE_SIZE);
+  }
 
   return {};
 }
 
 void PageTableWalker::print_deadlock()
 {
-  if (!std::empty(MSHR)) {
+  if (mshr_occupancy > 0) {
     std::cout << NAME << " MSHR Entry" << std::endl;
     std::size_t j = 0;
     for (PACKET entry : MSHR) {
+      if (!is_valid<PACKET>{}(entry))
+        continue;
+
       std::cout << "[" << NAME << " MSHR] entry: " << j++ << " instr_id: " << entry.instr_id;
       std::cout << " address: " << std::hex << entry.address << " v_address: " << entry.v_address << std::dec << " type: " << +entry.type;
       std::cout << " translation_level: " << +entry.translation_level;
@@ -4,27 +4,147 @@
 #include <cassert>
 #include <iostream>
 #include <numeric>
-#include <random>
 
 #include "champsim.h"
 #include "util.h"
 
-VirtualMemory::VirtualMemory(uint64_t capacity, uint64_t pg_size, uint32_t page_table_levels, uint64_t random_seed, uint64_t minor_fault_penalty)
-    : minor_fault_penalty(minor_fault_penalty), pt_levels(page_table_levels), page_size(pg_size),
-      ppage_free_list((capacity - VMEM_RESERVE_CAPACITY) / PAGE_SIZE, PAGE_SIZE)
+VirtualMemory::VirtualMemory(uint64_t capacity, uint64_t pg_size, uint32_t page_table_levels, uint64_t random_seed, uint64_t minor_fault_penalty,
+                             placement_t placement, std::vector<uint32_t> affinity, huge_page_t huge_pages, double huge_page_fraction,
+                             uint32_t promotion_threshold)
+    : minor_fault_penalty(minor_fault_penalty), pt_levels(page_table_levels), page_size(pg_size), placement(placement), affinity(affinity),
+      huge_pages(huge_pages), huge_page_fraction(huge_page_fraction), promotion_threshold(promotion_threshold),
+      huge_page_level((LOG2_HUGE_PAGE_SIZE - LOG2_PAGE_SIZE) / lg2(pg_size / PTE_BYTES))
 {
   assert(capacity % PAGE_SIZE == 0);
   assert(pg_size == (1ul << lg2(pg_size)) && pg_size > 1024);
+  assert(std::size(affinity) == NUM_CPUS);
+  assert(shamt(huge_page_level) == LOG2_HUGE_PAGE_SIZE && huge_page_level > 0 && huge_page_level < pt_levels);
 
-  // populate the free list
-  ppage_free_list.front() = VMEM_RESERVE_CAPACITY;
-  std::partial_sum(std::cbegin(ppage_free_list), std::cend(ppage_free_list), std::begin(ppage_free_list));
+  // Each node hands out the pages it owns, above the reserved space. When huge pages are enabled, the top huge_page_fraction of
+  // each node is set aside for huge page frames.
+  for (std::size_t node = 0; node < NUM_MEMORY_CONTROLLERS; ++node) {
+    uint64_t begin_addr = std::max<uint64_t>(node * MEMORY_NODE_SIZE, VMEM_RESERVE_CAPACITY);
+    uint64_t end_addr = std::max<uint64_t>(begin_addr, (node == NUM_MEMORY_CONTROLLERS - 1) ? capacity : (node + 1) * MEMORY_NODE_SIZE);
+    uint64_t huge_begin = end_addr;
+    if (huge_pages != huge_page_t::NONE) {
+      auto huge_bytes = static_cast<uint64_t>(huge_page_fraction * (end_addr - begin_addr));
+      huge_begin = std::max<uint64_t>(begin_addr, end_addr - huge_bytes);
+      huge_begin = std::min<uint64_t>(end_addr, (huge_begin + HUGE_PAGE_SIZE - 1) & ~bitmask(LOG2_HUGE_PAGE_SIZE));
+    }
+
+    ppage_free_list.emplace_back(begin_addr, huge_begin, random_seed + node);
+    huge_frame_free_list.emplace_back(huge_begin, end_addr, random_seed + node, HUGE_PAGE_SIZE);
+  }
+
+  next_pte_page = allocate_ppage(0);
+}
+
+std::size_t VirtualMemory::available_ppages() const
+{
+  auto count = [](auto acc, const auto& x) { return acc + x.size(); };
+  auto huge_ppages = std::accumulate(std::cbegin(huge_frame_free_list), std::cend(huge_frame_free_list), std::size_t{0}, count) * (HUGE_PAGE_SIZE / PAGE_SIZE);
+  return std::accumulate(std::cbegin(ppage_free_list), std::cend(ppage_free_list), huge_ppages, count);
+}
+
+std::size_t VirtualMemory::home_node(uint32_t cpu_num)
+{
+  if (placement == placement_t::INTERLEAVE)
+    return next_interleave_node++ % NUM_MEMORY_CONTROLLERS;
+  else if (placement == placement_t::AFFINITY)
+    return affinity.at(cpu_num);
+  else
+    return champsim::cpu_memory_node.at(cpu_num);
+}
+
+std::optional<uint64_t> VirtualMemory::allocate_huge_frame(uint32_t cpu_num)
+{
+  auto node = home_node(cpu_num);
+  for (std::size_t i = 0; i < NUM_MEMORY_CONTROLLERS; ++i) {
+    auto& free_list = huge_frame_free_list[(node + i) % NUM_MEMORY_CONTROLLERS];
+    if (!free_list.empty()) {
+      huge_pages_mapped++;
+      return free_list.next();
+    }
+  }
 
-  // then shuffle it
-  std::shuffle(std::begin(ppage_free_list), std::end(ppage_free_list), std::mt19937_64{random_seed});
+  return std::nullopt;
+}
+
+// a fixed, pseudo-random choice for each region, so that a run is reproducible
+bool VirtualMemory::backed_by_huge_page(uint32_t cpu_num, uint64_t region) const
+{
+  uint64_t hash = (region ^ (uint64_t{cpu_num} << 48)) + 0x9e3779b97f4a7c15ull;
+  hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ull;
+  hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebull;
+  hash ^= hash >> 31;
+  return (hash >> 11) * 0x1.0p-53 < huge_page_fraction;
+}
 
-  next_pte_page = ppage_free_list.front();
-  ppage_free_list.pop_front();
+uint32_t VirtualMemory::page_level(uint32_t cpu_num, uint64_t vaddr) const
+{
+  if (huge_pages == huge_page_t::NONE)
+    return 0;
+
+  std::pair region{cpu_num, vaddr >> LOG2_HUGE_PAGE_SIZE};
+  bool frames_available = std::any_of(std::cbegin(huge_frame_free_list), std::cend(huge_frame_free_list), [](const auto& x) { return !x.empty(); });
+  if (huge_page_map.count(region) > 0 || (huge_pages == huge_page_t::FRACTION && frames_available && backed_by_huge_page(cpu_num, region.second)))
+    return huge_page_level;
+
+  return 0;
+}
+
+uint64_t VirtualMemory::allocate_ppage(uint32_t cpu_num)
+{
+  auto node = home_node(cpu_num);
+
+  // fall back to the following nodes when this one is full
+  for (std::size_t i = 0; i < NUM_MEMORY_CONTROLLERS; ++i) {
+    auto& free_list = ppage_free_list[(node + i) % NUM_MEMORY_CONTROLLERS];
+    if (!free_list.empty())
+      return free_list.next();
+  }
+
+  std::cerr << "VirtualMemory: out of physical pages" << std::endl;
+  assert(0);
+  return 0;
+}
+
+ppage_permutation::ppage_permutation(uint64_t begin_addr, uint64_t end_addr, uint64_t seed, uint64_t frame_size)
+    : first(begin_addr), frame_size(frame_size), count((end_addr - begin_addr) / frame_size), rng(seed)
+{
+}
+
+uint64_t ppage_permutation::at(uint64_t idx) const
+{
+  auto found = swapped.find(idx);
+  return (found != std::end(swapped)) ? found->second : idx;
+}
+
+uint64_t ppage_permutation::next()
+{
+  assert(!empty());
+
+  if (!std::empty(released)) {
+    auto result = released.back();
+    released.pop_back();
+    return result;
+  }
+
+  // swap a random undrawn position into the next position, and draw it
+  auto idx = std::uniform_int_distribution<uint64_t>{drawn, count - 1}(rng);
+  auto result = at(idx);
+  if (idx != drawn)
+    swapped.insert_or_assign(idx, at(drawn));
+  swapped.erase(drawn);
+  ++drawn;
+
+  return first + result * frame_size;
+}
+
+void ppage_permutation::release(uint64_t addr)
+{
+  assert(contains(addr));
+  released.push_back(addr);
 }
 
 uint64_t VirtualMemory::shamt(uint32_t level) const { return LOG2_PAGE_SIZE + lg2(page_size / PTE_BYTES) * (level); }
@@ -33,15 +153,64 @@ uint64_t VirtualMemory::get_offset(uint64_t vaddr, uint32_t level) const { retur
 
 std::pair<uint64_t, bool> VirtualMemory::va_to_pa(uint32_t cpu_num, uint64_t vaddr)
 {
-  auto [ppage, fault] = vpage_to_ppage_map.insert({{cpu_num, vaddr >> LOG2_PAGE_SIZE}, ppage_free_list.front()});
+  std::pair region{cpu_num, vaddr >> LOG2_HUGE_PAGE_SIZE};
+  if (huge_pages != huge_page_t::NONE) {
+    if (auto huge_page = huge_page_map.find(region); huge_page != std::end(huge_page_map))
+      return {splice_bits(huge_page->second, vaddr, LOG2_HUGE_PAGE_SIZE), false};
+
+    if (huge_pages == huge_page_t::FRACTION && backed_by_huge_page(cpu_num, region.second)) {
+      if (auto frame = allocate_huge_frame(cpu_num); frame.has_value()) {
+        huge_page_map.insert({region, frame.value()});
+        return {splice_bits(frame.value(), vaddr, LOG2_HUGE_PAGE_SIZE), true};
+      }
+    }
+  }
+
+  std::pair key{cpu_num, vaddr >> LOG2_PAGE_SIZE};
+  auto ppage = vpage_to_ppage_map.find(key);
 
   // this vpage doesn't yet have a ppage mapping
-  if (fault)
-    ppage_free_list.pop_front();
+  bool fault = (ppage == std::end(vpage_to_ppage_map));
+  if (fault) {
+    // a region in which enough base pages have been touched is remapped with a huge page. Its base pages are unmapped and their
+    // frames freed, and their translations are shot down from the translation caches.
+    if (huge_pages == huge_page_t::PROMOTE && ++region_touches[region] >= promotion_threshold) {
+      if (auto frame = allocate_huge_frame(cpu_num); frame.has_value()) {
+        huge_page_map.insert({region, frame.value()});
+        region_touches.erase(region);
+        promotions++;
+
+        uint64_t first_vpage = region.second << (LOG2_HUGE_PAGE_SIZE - LOG2_PAGE_SIZE);
+        for (auto vpage = first_vpage; vpage < first_vpage + HUGE_PAGE_SIZE / PAGE_SIZE; ++vpage) {
+          if (auto base_page = vpage_to_ppage_map.find({cpu_num, vpage}); base_page != std::end(vpage_to_ppage_map)) {
+            auto owns_frame = [addr = base_page->second](const auto& x) { return x.contains(addr); };
+            auto free_list = std::find_if(std::begin(ppage_free_list), std::end(ppage_free_list), owns_frame);
+            assert(free_list != std::end(ppage_free_list));
+            free_list->release(base_page->second);
+            vpage_to_ppage_map.erase(base_page);
+          }
+        }
+
+        for (auto& listener : shootdown_listeners)
+          listener(cpu_num, vaddr, frame.value());
+
+        return {splice_bits(frame.value(), vaddr, LOG2_HUGE_PAGE_SIZE), true};
+      }
+    }
+
+    ppage = vpage_to_ppage_map.insert({key, allocate_ppage(cpu_num)}).first;
+  }
 
   return {splice_bits(ppage->second, vaddr, LOG2_PAGE_SIZE), fault};
 }
 
+bool VirtualMemory::is_mapped(uint32_t cpu_num, uint64_t vaddr) const
+{
+  if (huge_pages != huge_page_t::NONE && huge_page_map.count({cpu_num, vaddr >> LOG2_HUGE_PAGE_SIZE}) > 0)
+    return true;
+  return vpage_to_ppage_map.count({cpu_num, vaddr >> LOG2_PAGE_SIZE}) > 0;
+}
+
 std::pair<uint64_t, bool> VirtualMemory::get_pte_pa(uint32_t cpu_num, uint64_t vaddr, uint32_t level)
 {
   std::tuple key{cpu_num, vaddr >> shamt(level + 1), level};
@@ -50,10 +219,8 @@ std::pair<uint64_t, bool> VirtualMemory::get_pte_pa(uint32_t cpu_num, uint64_t v
   // this PTE doesn't yet have a mapping
   if (fault) {
     next_pte_page += page_size;
-    if (next_pte_page % PAGE_SIZE) {
-      next_pte_page = ppage_free_list.front();
-      ppage_free_list.pop_front();
-    }
+    if (next_pte_page % PAGE_SIZE)
+      next_pte_page = allocate_ppage(cpu_num);
   }
 
   return {splice_bits(ppage->second, get_offset(vaddr, level) * PTE_BYTES, lg2(page_size)), fault};
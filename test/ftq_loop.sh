@@ -0,0 +1,57 @@
+#!/bin/bash
+# A loop that stays inside one cache block must not grow the fetch target queue without bound. This builds a core with an
+# eight-entry FTQ and runs it over the first half of a synthetic trace of such loops. With the queue bounded, the trace is read
+# only a few hundred instructions ahead of retirement, so its end is never reached.
+#
+# The simulator is configured with test/ftq_loop.json and built in a temporary copy of the working tree, so the configuration
+# and binary of the checkout are left alone.
+set -e
+
+ROOT=$(git -C "$(dirname "$0")" rev-parse --show-toplevel)
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+TRACE="$WORK/ftq_loop.champsimtrace.xz"
+
+# the tracked and untracked files, so that uncommitted changes are tested too
+mkdir "$WORK/tree"
+(cd "$ROOT" && git ls-files -z --cached --others --exclude-standard | xargs -0 cp --parents -t "$WORK/tree")
+
+# Two loops of three instructions, each within one block: the first closed by a taken branch, the second (like a trace of a loop
+# whose branch was not recorded) by the instruction pointer moving backwards. Each iteration has a dependent load to a random
+# address, so that the core retires far more slowly than the branch predictor runs ahead.
+python3 - "$TRACE" <<'PYEOF'
+import lzma, random, struct, sys
+
+fmt = '<QBB2B4B2Q4Q'  # input_instr
+
+def instr(ip, load=0):
+    reg = 1 if load else 0  # each load depends on the one before it
+    return struct.pack(fmt, ip, 0, 0, reg, 0, reg, 0, 0, 0, 0, 0, load, 0, 0, 0)
+
+def branch(ip, taken):
+    return struct.pack(fmt, ip, 1, taken, 26, 0, 26, 25, 0, 0, 0, 0, 0, 0, 0, 0)  # conditional: writes IP, reads IP and flags
+
+random.seed(1)
+records = []
+for i in range(40000):
+    load = random.randrange(1 << 30) & ~63
+    if i < 10000:
+        records += [instr(0x400000, load), instr(0x400004), branch(0x400008, 1)]
+    else:
+        records += [instr(0x400100, load), instr(0x400104), instr(0x400108)]
+
+with lzma.open(sys.argv[1], 'wb') as f:
+    f.write(b''.join(records))
+PYEOF
+
+cd "$WORK/tree"
+./config.sh test/ftq_loop.json >/dev/null
+make -j"$(nproc)" >/dev/null
+
+# without a bound, the queue takes in the whole trace, and it is read again and again
+OUTPUT=$(ulimit -v 2000000; timeout 300 bin/champsim_ftq_loop --warmup_instructions 10000 --simulation_instructions 50000 "$TRACE")
+if grep -q "Reached end of trace" <<< "$OUTPUT"; then
+  echo "ftq_loop: FAILED, the trace was read ahead of the core without bound"
+  exit 1
+fi
+echo "ftq_loop: passed"